@@ -52,67 +52,95 @@ const u32 crc32_table[256] = {
     0xB3667A2E, 0xC4614AB8, 0x5D681B02, 0x2A6F2B94, 0xB40BBE37, 0xC30C8EA1, 0x5A05DF1B, 0x2D02EF8D,  // 248 [0xF8 .. 0xFF]
 };
 
+#define CRC_CHUNK   4096            // Files are read a few whole sectors at a time
+#define CRC_MAX     (1024*1024)     // Files up to a megabyte (any .C10) are CRC'd whole - longer .wav recordings in part
+
+static u8 crc_chunk[CRC_CHUNK];
+
+// --------------------------------------------------
+// Carry the CRC on over another piece of a buffer.
+// Start with 0xFFFFFFFF and invert it at the end.
+// --------------------------------------------------
+u32 crc32_update(u32 crc, const u8 *buf, u32 size)
+{
+    for (u32 i=0; i < size; i++)
+    {
+        crc = (crc >> 8) ^ crc32_table[(crc & 0xFF) ^ buf[i]];
+    }
+
+    return crc;
+}
+
 // --------------------------------------------------
 // Compute the CRC of a memory buffer of any size...
 // --------------------------------------------------
 u32 getCRC32(u8 *buf, u32 size)
+{
+    return ~crc32_update(0xFFFFFFFF, buf, size);
+}
+
+// ------------------------------------------------------------------------------
+// The CRC of a file (0 if it can't be read). A file up to CRC_MAX is CRC'd whole.
+// For a longer one (a .wav recording) the first CRC_MAX and the last CRC_CHUNK
+// bytes are CRC'd and the file size folded in - so two recordings that only
+// differ after the first megabyte still get their own configuration and saves
+// without reading the whole of a long recording twice at load.
+// ------------------------------------------------------------------------------
+static u32 crc32_file(const char *filename)
 {
     u32 crc = 0xFFFFFFFF;
+    u32 total = 0;
+    int bytesRead = 0;
 
-    for (int i=0; i < size; i++)
+    FILE* file = fopen(filename, "rb");
+    if (!file) return 0;
+
+    while ((total < CRC_MAX) && ((bytesRead = fread(crc_chunk, 1, CRC_CHUNK, file)) > 0))
     {
-        crc = (crc >> 8) ^ crc32_table[(crc & 0xFF) ^ (u8)buf[i]]; 
+        crc = crc32_update(crc, crc_chunk, bytesRead);
+        total += bytesRead;
     }
-    
+
+    if ((total >= CRC_MAX) && (fseek(file, 0, SEEK_END) == 0))
+    {
+        u32 size = ftell(file);
+        if (size > total)
+        {
+            u32 tail = (size - total > CRC_CHUNK) ? (size - CRC_CHUNK) : total;
+            fseek(file, tail, SEEK_SET);
+            while ((bytesRead = fread(crc_chunk, 1, CRC_CHUNK, file)) > 0)
+            {
+                crc = crc32_update(crc, crc_chunk, bytesRead);
+            }
+
+            u8 size_bytes[4] = {size & 0xFF, (size >> 8) & 0xFF, (size >> 16) & 0xFF, (size >> 24) & 0xFF};
+            crc = crc32_update(crc, size_bytes, sizeof(size_bytes));
+        }
+    }
+    fclose(file);
+
     return ~crc;
 }
 
-
 // ------------------------------------------------------------------------------------
-// Read the file in and compute CRC... it's a bit slow but good enough and accurate!
-// When this routine finishes, the file will be read into TapeBuffer[]
+// Read the file in and compute CRC. The tape itself is read as it plays (see tape.c)
+// so this only needs a small buffer to read it through - tapes can be any size.
 // ------------------------------------------------------------------------------------
 u32 getFileCrc(const char* filename)
 {
     u32 crc1 = 0;
     u32 crc2 = 1;
-    int bytesRead1 = 0;
-    int bytesRead2 = 1;
 
     // --------------------------------------------------------------------------------------------
     // I've seen some rare issues with reading files from the SD card on a DSi so we're doing
-    // this slow and careful - we will read twice and ensure that we get the same CRC both 
-    // times in order for us to declare that this is a valid read. When we're done, the game
-    // ROM will be placed in the TapeBuffer[] and will be ready for use by the rest of the system.
+    // this slow and careful - we will read twice and ensure that we get the same CRC both
+    // times in order for us to declare that this is a valid read.
     // --------------------------------------------------------------------------------------------
     do
     {
-        // Read #1
-        file_size = 0;
-        crc1 = 0xFFFFFFFF;
-        FILE* file = fopen(filename, "rb");
-        while ((bytesRead1 = fread(TapeBuffer, 1, MAX_FILE_SIZE, file)) > 0)
-        {
-            file_size += bytesRead1;
-            for (int i=0; i < bytesRead1; i++)
-            {
-                crc1 = (crc1 >> 8) ^ crc32_table[(crc1 & 0xFF) ^ (u8)TapeBuffer[i]]; 
-            }
-        }
-        fclose(file);
-
-        // Read #2
-        crc2 = 0xFFFFFFFF;
-        FILE* file2 = fopen(filename, "rb");
-        while ((bytesRead2 = fread(TapeBuffer, 1, MAX_FILE_SIZE, file2)) > 0)
-        {
-            for (int i=0; i < bytesRead2; i++)
-            {
-                crc2 = (crc2 >> 8) ^ crc32_table[(crc2 & 0xFF) ^ (u8)TapeBuffer[i]]; 
-            }
-        }
-        fclose(file2);
-   } while (crc1 != crc2);
+        crc1 = crc32_file(filename);
+        crc2 = crc32_file(filename);
+    } while (crc1 != crc2);
 
-    return ~crc1;
+    return crc1;
 }
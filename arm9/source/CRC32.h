@@ -15,6 +15,7 @@
 
 u32 getFileCrc(const char* filename);
 u32 getCRC32(u8 *buf, u32 size);
+u32 crc32_update(u32 crc, const u8 *buf, u32 size);
 
 #endif
 
@@ -35,6 +35,10 @@
 #include "cpu.h"
 #include "mem.h"
 #include "tape.h"
+#include "audio.h"
+#include "vdg.h"
+#include "rewind.h"
+#include "capture.h"
 #include "printf.h"
 
 // -----------------------------------------------------------------
@@ -51,8 +55,6 @@ u8 MC10BASIC[0x2000]          = {0};  // We keep the Tandy MC-10 BASIC/BIOS here
 u8 MCXBASIC[0x4000]           = {0};  // We keep the homebrew MCXBASIC here (16K ROM)
 u8 ALICE4K[0x2000]            = {0};  // We keep the Alice4K BASIC/BIOS here (8K ROM)
 
-u8 TapeBuffer[MAX_FILE_SIZE];     // This is where we keep the raw untouched tape file as read from the SD card
-
 // ----------------------------------------------------------------------------
 // We track the most recent directory and file loaded... both the initial one
 // (for the CRC32) and subsequent additional tape loads (Side 2, Side B, etc)
@@ -98,6 +100,8 @@ u16 vusCptVBL        __attribute__((section(".dtcm"))) = 0;       // We use this
 u8 bStartSoundEngine = 0;      // Set to true to unmute sound after 1 frame of rendering...
 int bg0, bg1, bg0b, bg1b;      // Some vars for NDS background screen handling
 
+u16 rewind_ticks = 0;         // TIMER2 ticks spent adding rewind points this second
+u8 warm_start_saved = 0;      // Set once this game has a warm start (restored at launch or just saved)
 u8 touch_debounce = 0;         // A bit of touch-screen debounce
 u8 key_debounce = 0;           // A bit of key debounce to ensure the key is held pressed for a minimum amount of time
 
@@ -127,30 +131,20 @@ void SoundUnPause(void)
 // We were using the normal ARM7 sound core but it sounded "scratchy" and so with the help
 // of FluBBa, we've swiched over to the maxmod sound core which performs much better.
 // --------------------------------------------------------------------------------------------
-#define SAMPLE_RATE_NTSC    15580       // To roughly match how many samples (262 scanlines x 60 frames = 15720). We purposely undershoot to keep buffer full.
+#define SAMPLE_RATE         15720       // 262 scanlines x 60 frames - audio.c resamples to hold the buffer level with the emulation
 #define buffer_size         (512+16)    // Enough buffer that we don't have to fill it too often. Must be multiple of 16.
 
 mm_ds_system sys   __attribute__((section(".dtcm")));
 mm_stream myStream __attribute__((section(".dtcm")));
 
-#define WAVE_DIRECT_BUF_SIZE 2047
-u16 mixer_read      __attribute__((section(".dtcm"))) = 0;
-u16 mixer_write     __attribute__((section(".dtcm"))) = 0;
-s16 mixer[WAVE_DIRECT_BUF_SIZE+1];
-
 // The games normally run at the proper 100% speed, but user can override from 80% to 130%
 u16 GAME_SPEED_NTSC[] __attribute__((section(".dtcm"))) = {546, 497, 455, 416, 420, 607 };
 
-u16 catch_up        __attribute__((section(".dtcm"))) = 0;
-
 // -------------------------------------------------------------------------------------------
 // maxmod will call this routine when the buffer is half-empty and requests that
 // we fill the sound buffer with more samples. They will request 'len' samples and
 // we will fill exactly that many. If the sound is paused, we fill with 'mute' samples.
 // -------------------------------------------------------------------------------------------
-s16 last_sample __attribute__((section(".dtcm"))) = 0;
-int breather    __attribute__((section(".dtcm"))) = 0;
-extern u16 dac_output;
 ITCM_CODE mm_word OurSoundMixer(mm_word len, mm_addr dest, mm_stream_formats format)
 {
     if (soundEmuPause)  // If paused, just "mix" in mute sound chip... all channels are OFF
@@ -164,74 +158,20 @@ ITCM_CODE mm_word OurSoundMixer(mm_word len, mm_addr dest, mm_stream_formats for
     }
     else
     {
-        s16 *p = (s16*)dest;
-        for (int i=0; i<len*2; i++)
-        {
-            if (mixer_read == mixer_write)
-            {
-                // Just use the last_sample and ask processDirectAudio() to catch-up
-                catch_up = 255;
-            }
-            else
-            {
-                last_sample = mixer[mixer_read];
-                mixer_read = (mixer_read + 1) & WAVE_DIRECT_BUF_SIZE;
-            }
-            *p++ = last_sample;
-        }
-        if (breather) {breather -= (len*2); if (breather < 0) breather = 0;}
+        audio_fill_stream((s16*)dest, len);
     }
 
     return  len;
 }
 
-// --------------------------------------------------------------------------------------------
-// This is called when we want to sample the audio directly - we grab 4x sound samples.
-// --------------------------------------------------------------------------------------------
-s16 mixbuf[4]    __attribute__((section(".dtcm")));
-s16 beeper_vol   __attribute__((section(".dtcm"))) = 0x0000;
-s16 last_dac     __attribute__((section(".dtcm"))) = 0;
-ITCM_CODE void processDirectAudio(void)
-{
-    u8 num_samples = 2;
-
-    if (breather) return;
-
-    if (catch_up) {catch_up--; num_samples=6;} // Queue nearly empty... catch up
-
-    for (u8 i=0; i<num_samples; i++)
-    {
-        mixer[mixer_write] = beeper_vol;
-        mixer_write++; mixer_write &= WAVE_DIRECT_BUF_SIZE;
-        if (((mixer_write+1)&WAVE_DIRECT_BUF_SIZE) == mixer_read) {breather = 1024; break;} // Let the buffer drain a bit...
-    }
-}
-
 // -----------------------------------------------------------------------------------------------
 // The user can override the core emulation speed from 80% to 130% to make games play faster/slow
-// than normal. We must adjust the MaxMode sample frequency to match or else we will not have the
-// proper number of samples in our sound buffer... this isn't perfect but it's reasonably good!
+// than normal. The stream keeps playing at the same rate - we just tell the resampler how many
+// scanlines a second are now coming its way and it takes care of the rest.
 // -----------------------------------------------------------------------------------------------
-static u8 last_game_speed = 99;
-static u32 sample_rate_adjust[] = {100, 110, 120, 130, 90, 80};
 void newStreamSampleRate(void)
 {
-    if (last_game_speed != myConfig.gameSpeed)
-    {
-        last_game_speed = myConfig.gameSpeed;
-        mmStreamClose();
-
-        // Adjust the sample rate to match the core emulation speed... user can override from 80% to 130%
-        int sample_rate = (SAMPLE_RATE_NTSC * sample_rate_adjust[myConfig.gameSpeed]) / 100;
-
-        myStream.sampling_rate  = sample_rate;            // sample_rate to match the scanline emulation
-        myStream.buffer_length  = buffer_size;            // buffer length = (512+16)
-        myStream.callback       = OurSoundMixer;          // set callback function
-        myStream.format         = MM_STREAM_16BIT_STEREO; // format = stereo 16-bit
-        myStream.timer          = MM_TIMER0;              // use hardware timer 0
-        myStream.manual         = false;                  // use automatic filling
-        mmStreamOpen(&myStream);
-    }
+    audio_set_rate(SAMPLE_RATE, (262 * 32728) / GAME_SPEED_NTSC[myConfig.gameSpeed]);   // 262 scanlines per frame
 }
 
 // -------------------------------------------------------------------------------------------
@@ -251,7 +191,7 @@ void setupStream(void)
     //----------------------------------------------------------------
     //  open stream
     //----------------------------------------------------------------
-    myStream.sampling_rate  = SAMPLE_RATE_NTSC;       // sample_rate for the MC-10 emulation
+    myStream.sampling_rate  = SAMPLE_RATE;            // sample_rate for the MC-10 emulation
     myStream.buffer_length  = buffer_size;            // buffer length = (512+16)
     myStream.callback       = OurSoundMixer;          // set callback function
     myStream.format         = MM_STREAM_16BIT_STEREO; // format = stereo 16-bit
@@ -273,15 +213,6 @@ void setupStream(void)
     //----------------------------------------------------------------
 }
 
-void sound_chip_reset()
-{
-    memset(mixer, 0x00, sizeof(mixer));
-    mixer_read=0;
-    mixer_write=0;
-    catch_up = 0;
-    breather = 0;
-}
-
 // -----------------------------------------------------------------------
 // We setup the sound chips - disabling all volumes to start.
 // -----------------------------------------------------------------------
@@ -391,12 +322,16 @@ void MiniMenuShow(bool bClearScreen, u8 sel)
     DSPrint(8,7,6,                                           " DS MINI MENU  ");
     DSPrint(8,9+mini_menu_items,(sel==mini_menu_items)?2:0,  " RESET  GAME   ");  mini_menu_items++;
     DSPrint(8,9+mini_menu_items,(sel==mini_menu_items)?2:0,  " QUIT   GAME   ");  mini_menu_items++;
+    DSPrint(8,9+mini_menu_items,(sel==mini_menu_items)?2:0,  " QUICK  SAVE   ");  mini_menu_items++;
+    DSPrint(8,9+mini_menu_items,(sel==mini_menu_items)?2:0,  " QUICK  LOAD   ");  mini_menu_items++;
     DSPrint(8,9+mini_menu_items,(sel==mini_menu_items)?2:0,  " SAVE   STATE  ");  mini_menu_items++;
     DSPrint(8,9+mini_menu_items,(sel==mini_menu_items)?2:0,  " LOAD   STATE  ");  mini_menu_items++;
+    DSPrint(8,9+mini_menu_items,(sel==mini_menu_items)?2:0,  " MARK   START  ");  mini_menu_items++;
     DSPrint(8,9+mini_menu_items,(sel==mini_menu_items)?2:0,  " GAME   OPTIONS");  mini_menu_items++;
     DSPrint(8,9+mini_menu_items,(sel==mini_menu_items)?2:0,  " DEFINE KEYS   ");  mini_menu_items++;
     DSPrint(8,9+mini_menu_items,(sel==mini_menu_items)?2:0,  " TAPE   REWIND ");  mini_menu_items++;
     DSPrint(8,9+mini_menu_items,(sel==mini_menu_items)?2:0,  " TAPE   STOP   ");  mini_menu_items++;
+    DSPrint(8,9+mini_menu_items,(sel==mini_menu_items)?2:0,  capture_on ? " STOP   RECORD ":" RECORD AUDIO  ");  mini_menu_items++;
     DSPrint(8,9+mini_menu_items,(sel==mini_menu_items)?2:0,  " EXIT   MENU   ");  mini_menu_items++;
 }
 
@@ -432,13 +367,17 @@ u8 MiniMenu(void)
             {
                 if      (menuSelection == 0) retVal = MENU_CHOICE_RESET_GAME;
                 else if (menuSelection == 1) retVal = MENU_CHOICE_END_GAME;
-                else if (menuSelection == 2) retVal = MENU_CHOICE_SAVE_GAME;
-                else if (menuSelection == 3) retVal = MENU_CHOICE_LOAD_GAME;
-                else if (menuSelection == 4) retVal = MENU_CHOICE_GAME_OPTION;
-                else if (menuSelection == 5) retVal = MENU_CHOICE_DEFINE_KEYS;
-                else if (menuSelection == 6) retVal = MENU_CHOICE_TAPE_REWIND;
-                else if (menuSelection == 7) retVal = MENU_CHOICE_TAPE_STOP;
-                else if (menuSelection == 8) retVal = MENU_CHOICE_NONE;
+                else if (menuSelection == 2) retVal = MENU_CHOICE_QUICK_SAVE;
+                else if (menuSelection == 3) retVal = MENU_CHOICE_QUICK_LOAD;
+                else if (menuSelection == 4) retVal = MENU_CHOICE_SAVE_GAME;
+                else if (menuSelection == 5) retVal = MENU_CHOICE_LOAD_GAME;
+                else if (menuSelection == 6) retVal = MENU_CHOICE_MARK_START;
+                else if (menuSelection == 7) retVal = MENU_CHOICE_GAME_OPTION;
+                else if (menuSelection == 8) retVal = MENU_CHOICE_DEFINE_KEYS;
+                else if (menuSelection == 9) retVal = MENU_CHOICE_TAPE_REWIND;
+                else if (menuSelection == 10) retVal = MENU_CHOICE_TAPE_STOP;
+                else if (menuSelection == 11) retVal = MENU_CHOICE_RECORD;
+                else if (menuSelection == 12) retVal = MENU_CHOICE_NONE;
                 else retVal = MENU_CHOICE_NONE;
                 break;
             }
@@ -467,6 +406,164 @@ u8 MiniMenu(void)
 }
 
 
+// ------------------------------------------------------------------------
+// Pick one of the in-memory quicksave slots. Returns the slot or 0xFF if
+// the user backed out. The chosen slot is also the one the L+R+A (save)
+// and L+R+B (load) shortcuts use from then on.
+// ------------------------------------------------------------------------
+u8 quick_slot = 0;
+void QuickSlotMenuShow(const char *title, u8 sel)
+{
+    DSPrint(8,7,6,(char *)title);
+    for (u8 slot=0; slot < QUICK_SLOTS; slot++)
+    {
+        sprintf(tmp, " SLOT %d  %-6s", slot+1, MicroQuickUsed(slot) ? "USED":"EMPTY");
+        DSPrint(8,9+slot,(sel==slot)?2:0, tmp);
+    }
+}
+
+u8 QuickSlotMenu(const char *title)
+{
+    u8 menuSelection = quick_slot;
+
+    BottomScreenOptions();
+    QuickSlotMenuShow(title, menuSelection);
+
+    while ((keysCurrent() & (KEY_UP | KEY_DOWN | KEY_A ))!=0);
+
+    while (true)
+    {
+        nds_key = keysCurrent();
+        if (nds_key)
+        {
+            if (nds_key & KEY_UP)
+            {
+                menuSelection = (menuSelection > 0) ? (menuSelection-1):(QUICK_SLOTS-1);
+                QuickSlotMenuShow(title, menuSelection);
+            }
+            if (nds_key & KEY_DOWN)
+            {
+                menuSelection = (menuSelection+1) % QUICK_SLOTS;
+                QuickSlotMenuShow(title, menuSelection);
+            }
+            if (nds_key & KEY_A)
+            {
+                quick_slot = menuSelection;
+                break;
+            }
+            if (nds_key & KEY_B)
+            {
+                menuSelection = 0xFF;
+                break;
+            }
+
+            while ((keysCurrent() & (KEY_UP | KEY_DOWN | KEY_A ))!=0);
+            WAITVBL;WAITVBL;
+        }
+    }
+
+    while ((keysCurrent() & (KEY_UP | KEY_DOWN | KEY_A | KEY_B ))!=0);
+    WAITVBL;WAITVBL;
+
+    return menuSelection;
+}
+
+// ------------------------------------------------------------------------
+// Rewind points take memory so they are only kept if they can be used -
+// REWIND is on in the global options and mapped to a DS button for this
+// game. The DSi has room for a lot more of them. Called as a game starts
+// (which starts with no rewind points) and again once its keys have been
+// redefined.
+// ------------------------------------------------------------------------
+static u8 bRewindOn = 0;    // rewind_init() has the memory
+
+void RewindSetup(u8 bNewGame)
+{
+    u8 bWanted = 0;
+
+    for (u8 i=0; i<10; i++)
+    {
+        if (myGlobalConfig.rewind && (myConfig.keymap[i] == KBD_REWIND)) bWanted = 1;
+    }
+
+    if (bNewGame || !bWanted)
+    {
+        rewind_free();
+        bRewindOn = 0;
+    }
+
+    if (bWanted && !bRewindOn) bRewindOn = rewind_init(isDSiMode() ? REWIND_DSI_MEMORY : REWIND_DS_MEMORY);
+}
+
+// ------------------------------------------------------------------------
+// The REWIND key is held - step back one rewind point each frame until it
+// is let go (or we run out of rewind points) and carry on from there.
+// ------------------------------------------------------------------------
+void RewindMicroComputer(void)
+{
+    u16 rewind_keys = 0;
+    for (u8 i=0; i<10; i++)
+    {
+        if (myConfig.keymap[i] == KBD_REWIND) rewind_keys |= NDS_keyMap[i];
+    }
+
+    SoundPause();
+    DSPrint(0,0,0,"REWIND");
+    while (keysCurrent() & rewind_keys)
+    {
+        rewind_step();
+        vdg_render();
+        swiWaitForVBlank();
+    }
+    DSPrint(0,0,0,"      ");
+
+    // Start the frame timing over so we don't race to catch up
+    TIMER2_CR=0;
+    TIMER2_DATA=0;
+    TIMER2_CR=TIMER_ENABLE | TIMER_DIV_1024;
+    timingFrames = 0;
+
+    SoundUnPause();
+}
+
+// Quicksave into (or load from) the current slot and show it on the status line
+void QuickSlotAction(u8 bLoad)
+{
+    if (bLoad)
+    {
+        sprintf(tmp, (MicroQuickLoad(quick_slot) ? "LOADED %d":"EMPTY %d "), quick_slot+1);
+    }
+    else
+    {
+        MicroQuickSave(quick_slot);
+        sprintf(tmp, "SAVED %d ", quick_slot+1);
+    }
+    DSPrint(0,0,0,tmp);
+    WAITVBL;WAITVBL;WAITVBL;WAITVBL;WAITVBL;WAITVBL;
+    DSPrint(0,0,0,"         ");
+}
+
+// Start recording the sound to a new .wav file (named like the screenshots) or stop if recording
+void AudioCaptureToggle(void)
+{
+    if (capture_on)
+    {
+        capture_stop();
+        DSPrint(0,0,0,"STOPPED  ");
+    }
+    else
+    {
+        time_t unixTime = time(NULL);
+        struct tm* timeStruct = gmtime((const time_t *)&unixTime);
+
+        sprintf(tmp, "AUDIO-%02d-%02d-%04d-%02d-%02d-%02d.wav", timeStruct->tm_mday, timeStruct->tm_mon+1, timeStruct->tm_year+1900, timeStruct->tm_hour, timeStruct->tm_min, timeStruct->tm_sec);
+        DSPrint(0,0,0,(capture_start(tmp, (262 * 32728) / GAME_SPEED_NTSC[myConfig.gameSpeed]) ? "RECORDING":"NO RECORD"));
+    }
+    WAITVBL;WAITVBL;WAITVBL;WAITVBL;WAITVBL;WAITVBL;
+    DSPrint(0,0,0,"         ");
+}
+
+
 // -------------------------------------------------------------------------
 // Keyboard handler - mapping DS touch screen virtual keys to keyboard keys
 // that we can feed into the key processing handler in mem.c when the
@@ -476,6 +573,7 @@ u8 MiniMenu(void)
 u8 shift_key = 0;
 u8 ctrl_key = 0;
 u8 last_kbd_key = 0;
+u8 quick_slot_held = 0;     // L+R+A/B has been acted on - not again until A and B are let go
 
 u8 handle_keyboard_press(u16 iTx, u16 iTy)  // Tandy MC-10 keyboard mapping
 {
@@ -570,6 +668,7 @@ u8 __attribute__((noinline)) handle_meta_key(u8 meta_key)
               //  Ask for verification
               if  (showMessage("DO YOU REALLY WANT TO","QUIT THE CURRENT GAME ?") == ID_SHM_YES)
               {
+                  capture_stop();
                   memset((u8*)0x06000000, 0x00, 0x20000);    // Reset VRAM to 0x00 to clear any potential display garbage on way out
                   return 1;
               }
@@ -578,6 +677,28 @@ u8 __attribute__((noinline)) handle_meta_key(u8 meta_key)
               SoundUnPause();
             break;
 
+        case MENU_CHOICE_QUICK_SAVE:
+            SoundPause();
+            if (QuickSlotMenu(" QUICK SAVE    ") != 0xFF)
+            {
+                BottomScreenKeyboard();
+                QuickSlotAction(0);
+            }
+            else BottomScreenKeyboard();
+            SoundUnPause();
+            break;
+
+        case MENU_CHOICE_QUICK_LOAD:
+            SoundPause();
+            if (QuickSlotMenu(" QUICK LOAD    ") != 0xFF)
+            {
+                BottomScreenKeyboard();
+                QuickSlotAction(1);
+            }
+            else BottomScreenKeyboard();
+            SoundUnPause();
+            break;
+
         case MENU_CHOICE_SAVE_GAME:
             SoundPause();
             if  (showMessage("DO YOU REALLY WANT TO","SAVE GAME STATE ?") == ID_SHM_YES)
@@ -598,9 +719,21 @@ u8 __attribute__((noinline)) handle_meta_key(u8 meta_key)
             SoundUnPause();
             break;
 
+        case MENU_CHOICE_MARK_START:
+            SoundPause();
+            if (showMessage("DO YOU REALLY WANT TO", "WARM START FROM HERE ?") == ID_SHM_YES)
+            {
+                MicroSaveWarmState(1);
+                warm_start_saved = 1;
+            }
+            BottomScreenKeyboard();
+            SoundUnPause();
+            break;
+
         case MENU_CHOICE_DEFINE_KEYS:
             SoundPause();
             MicroDSChangeKeymap();
+            RewindSetup(0);         // REWIND may have been mapped (or unmapped)
             BottomScreenKeyboard();
             SoundUnPause();
             break;
@@ -621,6 +754,11 @@ u8 __attribute__((noinline)) handle_meta_key(u8 meta_key)
             tape_rewind();
             BottomScreenKeyboard();
             break;
+
+        case MENU_CHOICE_RECORD:
+            BottomScreenKeyboard();
+            AudioCaptureToggle();
+            break;
     }
 
     return 0;
@@ -653,6 +791,17 @@ ITCM_CODE void MicroDS_main(void)
   MC10SetPalette();
   RunMicroComputer();
 
+  // If we kept this game once it had loaded before, pick up from there
+  int warm_frames = WARM_START_FRAMES;
+  warm_start_saved = myConfig.warmStart && MicroLoadWarmState();
+
+  // The quicksave slots are per game - bring back any kept on the SD card
+  quick_slot = 0;
+  MicroQuickReadSlots();
+
+  RewindSetup(1);
+  rewind_ticks = 0;
+
   // Frame-to-frame timing...
   TIMER1_CR = 0;
   TIMER1_DATA=0;
@@ -708,6 +857,15 @@ ITCM_CODE void MicroDS_main(void)
             }
             DisplayStatusLine();
             emuActFrames = 0;
+
+            // How often the sound ran dry or had to be thrown away
+            debug[4] = audio_underruns;
+            debug[5] = audio_overruns;
+
+            // What adding rewind points cost over the last second (in tenths of a percent)
+            debug[6] = rewind_points;
+            debug[7] = (rewind_ticks * 1000) / 32728;
+            rewind_ticks = 0;
         }
         emuActFrames++;
 
@@ -722,6 +880,9 @@ ITCM_CODE void MicroDS_main(void)
             timingFrames = 0;
         }
 
+        // Any of the sound recording that's ready goes out in what's left of this frame
+        capture_flush();
+
         // ----------------------------------------------------------------------
         // 32,728.5 ticks of TIMER2 = 1 second
         // 1 frame = 1/50 or 655 ticks of TIMER2
@@ -735,6 +896,28 @@ ITCM_CODE void MicroDS_main(void)
         }
 
 
+        // ---------------------------------------------------------------------
+        // Once the tape has loaded and stopped for a second, keep the machine
+        // as it is now so the next launch of this game can start from here.
+        // ---------------------------------------------------------------------
+        if (myConfig.warmStart && !warm_start_saved)
+        {
+            if (tape_motor || (tape_pos == 0)) warm_frames = WARM_START_FRAMES;
+            else if (--warm_frames == 0)
+            {
+                MicroSaveWarmState(0);
+                warm_start_saved = 1;
+            }
+        }
+
+        // Any quicksave slot that changed goes out to the SD card a bit at a time
+        MicroQuickFlush();
+
+        // Add a rewind point every few frames (and keep track of the time that takes)
+        u16 rewind_start = TIMER2_DATA;
+        rewind_frame();
+        rewind_ticks += (u16)(TIMER2_DATA - rewind_start);
+
         // If the Z80 Debugger is enabled, call it
         if (myGlobalConfig.debugger)
         {
@@ -749,8 +932,9 @@ ITCM_CODE void MicroDS_main(void)
         // --------------------------------------------------------------------------
         if (myConfig.autoLoad && (BufferedKeysReadIdx == BufferedKeysWriteIdx))
         {
-            // START key is special...
-            if (keys_current & KEY_START)
+            // START key is special... the tape's program is put straight into memory (and a machine
+            // language one started) if we can (just the once) otherwise CLOAD or CLOADM:EXEC is typed in.
+            if ((keys_current & KEY_START) && !tape_injected && !((tape_pos == 0) && tape_inject()))
             {
                 BufferKey(KBD_C);    // C
                 BufferKey(KBD_L);    // L
@@ -868,6 +1052,8 @@ ITCM_CODE void MicroDS_main(void)
               // ---------------------------------------------------------------------------
               nds_key  = keys_current;     // Get any current keys pressed on the NDS
 
+              if (!(nds_key & (KEY_A | KEY_B))) quick_slot_held = 0;
+
               // -----------------------------------------
               // Check various key combinations first...
               // -----------------------------------------
@@ -876,6 +1062,11 @@ ITCM_CODE void MicroDS_main(void)
                     lcdSwap();
                     WAITVBL;WAITVBL;WAITVBL;WAITVBL;WAITVBL;WAITVBL;
               }
+              else if ((nds_key & KEY_L) && (nds_key & KEY_R) && (nds_key & (KEY_A | KEY_B)))
+              {
+                    if (!quick_slot_held) QuickSlotAction((nds_key & KEY_B) ? 1:0);
+                    quick_slot_held = 1;    // Once per press - holding the keys doesn't save (or load) again and again
+              }
               else if ((nds_key & KEY_L) && (nds_key & KEY_R) && (nds_key & KEY_Y))
               {
                     DSPrint(2,0,0,"SNAPSHOT");
@@ -944,10 +1135,18 @@ ITCM_CODE void MicroDS_main(void)
                   // ------------------------------------------------------------------------------------------------------
                   // There are 10 NDS buttons that can be mapped (D-Pad, XYAB, L/R) - we allow mapping these to MC-10 keys.
                   // ------------------------------------------------------------------------------------------------------
+                  u8 bRewind = 0;
                   for (u8 i=0; i<10; i++)
                   {
                       if (nds_key & NDS_keyMap[i])
                       {
+                          // The REWIND key isn't passed on to the MC-10...
+                          if (myConfig.keymap[i] == KBD_REWIND)
+                          {
+                              bRewind = 1;
+                              continue;
+                          }
+
                           // This is a keyboard maping... handle that here... just set the appopriate kbd_key
                           kbd_key = myConfig.keymap[i];
                           
@@ -965,6 +1164,8 @@ ITCM_CODE void MicroDS_main(void)
                           kbd_keys[kbd_keys_pressed++] = kbd_key;
                       }
                   }
+
+                  if (bRewind) RewindMicroComputer();
               }
               else // No NDS keys pressed...
               {
@@ -983,6 +1184,9 @@ ITCM_CODE void MicroDS_main(void)
           // ------------------------------------------------------------------------------------------
           ProcessBufferedKeys();
       }
+
+      // And turn this frame's keys into the keyboard matrix the MC-10 will scan
+      kbd_build_matrix();
     }
   }
 }
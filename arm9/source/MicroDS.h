@@ -28,9 +28,15 @@ extern u32 DX, DY;
 #define MENU_CHOICE_GAME_OPTION 0x06
 #define MENU_CHOICE_TAPE_REWIND 0x07
 #define MENU_CHOICE_TAPE_STOP   0x08
+#define MENU_CHOICE_MARK_START  0x09
+#define MENU_CHOICE_QUICK_SAVE  0x0A
+#define MENU_CHOICE_QUICK_LOAD  0x0B
+#define MENU_CHOICE_RECORD      0x0C
 #define MENU_CHOICE_MENU        0xFF        // Special brings up a mini-menu of choices
 
-#define MAX_KEY_OPTIONS     49
+#define MAX_KEY_OPTIONS     50
+
+#define WARM_START_FRAMES   60      // Frames the tape must sit stopped after loading before the warm start is kept
 
 #define WAITVBL swiWaitForVBlank(); swiWaitForVBlank(); swiWaitForVBlank(); swiWaitForVBlank(); swiWaitForVBlank();
 
@@ -63,7 +69,6 @@ extern void ResetStatusFlags(void);
 extern void ReadFileCRCAndConfig(void);
 extern void DisplayStatusLine(void);
 extern void ResetMicroComputer(void);
-extern void processDirectAudio(void);
 extern void newStreamSampleRate(void);
 extern void debug_init();
 extern void debug_save();
@@ -25,6 +25,7 @@
 #include "splash_bot.h"
 #include "tape.h"
 #include "CRC32.h"
+#include "hle.h"
 #include "printf.h"
 
 short int   fileCount=0;
@@ -97,6 +98,7 @@ const char szKeyName[MAX_KEY_OPTIONS][18] = {
   "KEYBOARD SHIFT",  // 46
   "KEYBOARD CTRL"   ,// 47
   "KEYBOARD BREAK",  // 48
+  "REWIND",          // 49
 };
 
 
@@ -304,7 +306,7 @@ void MicroDSFindFiles(void)
     else {
       if ((strlen(szFile)>4) && (strlen(szFile)<(MAX_FILENAME_LEN-4)) && (szFile[0] != '.') && (szFile[0] != '_'))  // For MAC don't allow files starting with an underscore
       {
-        if ( (strcasecmp(strrchr(szFile, '.'), ".c10") == 0) )  {
+        if ( (strcasecmp(strrchr(szFile, '.'), ".c10") == 0) || (strcasecmp(strrchr(szFile, '.'), ".cas") == 0) || (strcasecmp(strrchr(szFile, '.'), ".wav") == 0) )  {
           strcpy(gpFic[uNbFile].szName,szFile);
           gpFic[uNbFile].uType = MICRO_FILE;
           uNbFile++;
@@ -687,6 +689,8 @@ void SetDefaultGlobalConfig(void)
     myGlobalConfig.showFPS        = 0;    // Don't show FPS counter by default
     myGlobalConfig.debugger       = 0;    // Debugger is not shown by default
     myGlobalConfig.defMachine     = 0;    // Set to standard MC-10 by default
+    myGlobalConfig.quickFlush     = 0;    // Quicksave slots are only kept in memory
+    myGlobalConfig.rewind         = 0;    // No rewind points unless asked for (and the REWIND key is mapped)
 }
 
 void SetDefaultGameConfig(void)
@@ -699,10 +703,10 @@ void SetDefaultGameConfig(void)
     myConfig.dpad        = DPAD_NORMAL;                 // Normal DPAD use - mapped to cursor keys
     myConfig.autoLoad    = tape_guess_type();           // Default is to to auto-load games - try to autodetect
     myConfig.gameSpeed   = 0;                           // Default is 100% game speed
-    myConfig.reserved0   = 0;
-    myConfig.reserved1   = 0;
-    myConfig.reserved2   = 0;
-    myConfig.reserved3   = 0;
+    myConfig.hleMath     = HLE_OFF;                     // Run the ROM floating point routines as-is
+    myConfig.fastLoad    = 1;                           // Load tape blocks directly when the ROM is known
+    myConfig.warmStart   = 0;                           // Don't keep a snapshot of the game once loaded
+    myConfig.runAhead    = 0;                           // Show each frame as it happens (no run-ahead)
     myConfig.reserved4   = 0;
     myConfig.reserved5   = 0;
     myConfig.reserved6   = 0;
@@ -800,6 +804,10 @@ const struct options_t Option_Table[2][20] =
         {"AUTO LOAD",      {"NO", "CLOAD [RUN]", "CLOADM [EXEC]"},                          &myConfig.autoLoad,          3},
         {"GAME SPEED",     {"100%", "110%", "120%", "130%", "90%", "80%"},                  &myConfig.gameSpeed,         6},
         {"NDS D-PAD",      {"NORMAL", "SLIDE-N-GLIDE", "DIAGONALS"},                        &myConfig.dpad,              3},
+        {"FAST LOAD",      {"NO", "YES"},                                                   &myConfig.fastLoad,          2},
+        {"FAST MATH",      {"OFF", "STRICT", "TURBO"},                                      &myConfig.hleMath,           3},
+        {"WARM START",     {"NO", "YES"},                                                   &myConfig.warmStart,         2},
+        {"RUN AHEAD",      {"OFF", "1 FRAME", "2 FRAMES", "3 FRAMES"},                      &myConfig.runAhead,          4},
         {NULL,             {"",      ""},                                                   NULL,                        1},
     },
     // Global Options
@@ -807,6 +815,8 @@ const struct options_t Option_Table[2][20] =
         {"MACHINE TYPE",   {"MC10 (20K RAM)", "MC10 (32K RAM)", "MCX-128", "ALICE (20K)"},  &myGlobalConfig.defMachine,  4},
         {"FPS",            {"OFF", "ON", "ON FULLSPEED"},                                   &myGlobalConfig.showFPS,     3},
         {"DEBUGGER",       {"OFF", "ON"},                                                   &myGlobalConfig.debugger,    2},
+        {"QUICKSAVE SD",   {"NO", "YES"},                                                   &myGlobalConfig.quickFlush,  2},
+        {"REWIND",         {"OFF", "ON"},                                                   &myGlobalConfig.rewind,      2},
         {NULL,             {"",      ""},                                                   NULL,                        1},
     }
 };
@@ -1168,18 +1178,13 @@ void ReadFileCRCAndConfig(void)
 {
     keyMapType = 0;
 
-    // ----------------------------------------------------------------------------------
-    // Clear the entire ROM buffer[] - fill with 0xFF to emulate non-responsive memory
-    // ----------------------------------------------------------------------------------
-    memset(TapeBuffer, 0xFF, MAX_FILE_SIZE);
-
     // Save the initial filename and file - we need it for save/restore of state
     strcpy(initial_file, gpFic[ucGameChoice].szName);
     strcpy(last_file, gpFic[ucGameChoice].szName);
     getcwd(initial_path, MAX_FILENAME_LEN);
     getcwd(last_path, MAX_FILENAME_LEN);
 
-    // Grab the all-important file CRC - this also loads the file into TapeBuffer[]
+    // Grab the all-important file CRC
     getfile_crc(gpFic[ucGameChoice].szName);
 
     loadgame(gpFic[ucGameChoice].szName);
@@ -1620,24 +1625,13 @@ void getfile_crc(const char *filename)
 
 
 /** loadgame() ******************************************************************/
-/* Open a tape file from file system and load it into the TapeBuffer[] buffer   */
+/* Open a tape file from file system - it is read from as the tape plays        */
 /********************************************************************************/
 u8 loadgame(const char *filename)
 {
   u8 bOK = 0;
-  int romSize = 0;
-
-  FILE* handle = fopen(filename, "rb");
-  if (handle != NULL)
-  {
-    // Get file size the 'fast' way - use fstat() instead of fseek() or ftell()
-    struct stat stbuf;
-    (void)fstat(fileno(handle), &stbuf);
-    romSize = stbuf.st_size;
-    fclose(handle); // We only need to close the file - the game ROM is now sitting in TapeBuffer[] from the getFileCrc() handler
 
-    file_size = (u32)romSize;
-  }
+  tape_open(filename);
 
   return bOK;
 }
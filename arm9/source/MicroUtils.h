@@ -18,7 +18,7 @@
 
 #define MAX_FILES                   1048
 #define MAX_FILENAME_LEN            160
-#define MAX_FILE_SIZE               (64*1024) // 64K is big enough for any .C10 file
+#define QUICK_SLOTS                 4         // In-memory quicksave slots
 
 #define MAX_CONFIGS                 1000
 #define CONFIG_VERSION              0x0003
@@ -51,6 +51,9 @@ extern char last_path[MAX_FILENAME_LEN];
 extern char last_file[MAX_FILENAME_LEN];
 
 extern u32 micro_line;
+extern u8 *boot_snapshot;
+extern u32 boot_snapshot_crc;
+extern u32 boot_rom_crc;
 extern u32 file_size;
 extern u32 tape_pos;
 extern u8  tape_motor;
@@ -74,8 +77,8 @@ struct __attribute__((__packed__)) GlobalConfig_t
     char reserved2[MAX_FILENAME_LEN+1];
     u8  showFPS;
     u8  defMachine;
-    u8  global_01;
-    u8  global_02;
+    u8  quickFlush;
+    u8  rewind;
     u8  global_03;
     u8  global_04;
     u8  global_05;
@@ -97,11 +100,11 @@ struct __attribute__((__packed__)) Config_t
     u8  machine;
     u8  autoLoad;
     u8  gameSpeed;
-    u8  reserved0;
+    u8  hleMath;
     u8  dpad;
-    u8  reserved1;
-    u8  reserved2;
-    u8  reserved3;
+    u8  fastLoad;
+    u8  warmStart;
+    u8  runAhead;
     u8  reserved4;
     u8  reserved5;
     u8  reserved6;
@@ -162,7 +165,8 @@ typedef enum
   KBD_SPACE,
   KBD_SHIFT,
   KBD_CTRL,
-  KBD_BREAK
+  KBD_BREAK,
+  KBD_REWIND        // Not an MC-10 key - held to rewind the game
 } kbd_t;
 
 extern struct Config_t       myConfig;
@@ -174,8 +178,6 @@ extern u8 BufferedKeys[32];
 extern u8 BufferedKeysWriteIdx;
 extern u8 BufferedKeysReadIdx;
 
-extern u8 TapeBuffer[MAX_FILE_SIZE];
-
 extern FIMicro gpFic[MAX_FILES];
 extern short int ucGameAct;
 extern short int ucGameChoice;
@@ -196,10 +198,24 @@ extern u8   MC10Init(char *szGame);
 extern void MC10SetPalette(void);
 extern void RunMicroComputer(void);
 extern void micro_reset(void);
+extern void micro_boot_cancel(void);
+extern void micro_boot_frame(void);
+extern u16  micro_basic_pointers(void);
 extern u32  micro_run(void);
+extern void micro_run_ahead(int frames);
+extern void micro_run_ahead_free(void);
 extern void getfile_crc(const char *path);
 extern void MicroLoadState();
 extern void MicroSaveState();
+extern void MicroReadBootSnapshot(void);
+extern void MicroWriteBootSnapshot(void);
+extern u8   MicroLoadWarmState(void);
+extern void MicroSaveWarmState(u8 bShowStatus);
+extern void MicroQuickSave(u8 slot);
+extern u8   MicroQuickLoad(u8 slot);
+extern u8   MicroQuickUsed(u8 slot);
+extern void MicroQuickReadSlots(void);
+extern void MicroQuickFlush(void);
 extern void intro_logo(void);
 extern void BufferKey(u8 key);
 extern void ProcessBufferedKeys(void);
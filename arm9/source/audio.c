@@ -0,0 +1,266 @@
+// =====================================================================================
+// Copyright (c) 2025 Dave Bernazzani (wavemotion-dave)
+//
+// Copying and distribution of this emulator, its source code and associated
+// readme files, with or without modification, are permitted in any medium without
+// royalty provided this copyright notice is used and wavemotion-dave and eyalabraham
+// (Dragon 32 emu core) are thanked profusely.
+//
+// The Micro-DS emulator is offered as-is, without any warranty. Please see readme.md
+// =====================================================================================
+#include    <nds.h>
+#include    <string.h>
+
+#include    "audio.h"
+#include    "capture.h"
+
+// ------------------------------------------------------------------------
+// The MC-10 sound is a single 1-bit beeper (bit 7 of the 0xBFFF port).
+// Each time it flips, the CPU cycle it flipped on is queued (see
+// beeper_edge() in audio.h) and once per scanline the edges are turned
+// into a sample. Those are resampled to the rate of the sound stream
+// (maxmod on the DS) into the mixer ring buffer which the stream drains
+// as it needs more. Nothing in here knows about maxmod so the host build
+// can run it too.
+// ------------------------------------------------------------------------
+
+u16 mixer_read      __attribute__((section(".dtcm"))) = 0;
+u16 mixer_write     __attribute__((section(".dtcm"))) = 0;
+s16 mixer[WAVE_DIRECT_BUF_SIZE+1];
+
+s16 last_sample     __attribute__((section(".dtcm"))) = 0;
+s16 beeper_vol      __attribute__((section(".dtcm"))) = 0x0000;
+
+u32 audio_underruns = 0;    // Times the stream found the mixer ring empty
+u32 audio_overruns  = 0;    // Times samples were thrown away with the mixer ring too full
+
+// ------------------------------------------------------------------------
+// Dynamic rate control. The scanline samples are resampled to the stream
+// rate by stepping through them audio_step (16.16) scanlines per stream
+// sample. The nominal step comes from the two rates but neither clock is
+// exact (and the frame pacing wobbles) so once a frame the step is nudged
+// to keep the mixer ring half full: by up to 1/AUDIO_MAX_ADJUST for how
+// far off the fill is right now plus a slow trim that soaks up whatever
+// the two clocks steadily differ by. That's far too small a change in
+// pitch to hear and the ring never runs dry or overflows unless the
+// emulation can't keep up or runs flat out (tape turbo, full speed).
+// ------------------------------------------------------------------------
+#define AUDIO_FRAC          16
+#define AUDIO_TARGET_FILL   ((WAVE_DIRECT_BUF_SIZE+1) / 2)      // Entries (two per stereo sample)
+#define AUDIO_RESYNC_FILL   ((WAVE_DIRECT_BUF_SIZE+1) * 7 / 8)  // Too far behind - skip back to the target
+#define AUDIO_MAX_ADJUST    200     // Most the fill can nudge the step by (0.5%)
+#define AUDIO_MAX_TRIM      50      // Most the trim can move the step by (2%)
+#define AUDIO_TRIM_FRAMES   64      // Frames for the trim to take up a steady error
+
+static u32 audio_nominal    __attribute__((section(".dtcm"))) = 1 << AUDIO_FRAC;   // Scanlines per stream sample at the nominal rates
+static u32 audio_step       __attribute__((section(".dtcm"))) = 1 << AUDIO_FRAC;   // ...as adjusted to keep the ring level
+static u32 audio_pos        __attribute__((section(".dtcm"))) = 0;                 // Where the next stream sample is past the last scanline sample
+static s16 audio_prev       __attribute__((section(".dtcm"))) = 0;                 // The last scanline sample
+static s32 audio_trim       = 0;                                                    // Steady correction to the step (16.16 scaled by AUDIO_TRIM_FRAMES)
+static s32 audio_fill       = AUDIO_TARGET_FILL << 4;                              // Ring fill averaged over a few frames (12.4)
+
+u8  beeper_edges                    __attribute__((section(".dtcm"))) = 0;  // Edges queued since the last scanline
+u8  beeper_edge_cycle[BEEPER_EDGES] __attribute__((section(".dtcm")));      // Cycle within that scanline
+s16 beeper_edge_level[BEEPER_EDGES] __attribute__((section(".dtcm")));      // Level from then on
+
+// ------------------------------------------------------------------------
+// Band-limited steps. A sample per scanline is far too slow to catch a
+// beeper that flips part way through a scanline (music routines do this
+// all the time) so rather than the level at each sample, every edge is
+// added as a step already smoothed to what the sample rate can carry -
+// spread over BLEP_TAPS samples and nudged to where in the scanline it
+// fell. Only the edges cost anything. The steps are the running sum of a
+// Blackman windowed sinc (cut off at 0.45 of the sample rate) for each
+// of BLEP_PHASES positions between two samples, in 1/32768ths - each row
+// adds up to exactly 32768 so the level always settles where it should.
+// ------------------------------------------------------------------------
+#define BLEP_TAPS       8
+#define BLEP_PHASES     16
+#define BLEP_RING       16          // Must be a power of 2 and more than BLEP_TAPS+1
+#define BLEP_SHIFT      15
+
+static const s16 blep_step[BLEP_PHASES][BLEP_TAPS] =
+{
+    {    18,    183,  -2017,  18199,  18199,  -2017,    183,     20},
+    {     8,    247,  -2179,  16468,  19831,  -1732,     93,     32},
+    {     1,    288,  -2235,  14674,  21328,  -1312,    -25,     49},
+    {    -3,    308,  -2200,  12852,  22658,   -745,   -171,     69},
+    {    -6,    312,  -2093,  11037,  23790,    -22,   -345,     95},
+    {    -7,    302,  -1928,   9263,  24699,    862,   -544,    121},
+    {    -7,    281,  -1723,   7558,  25364,   1906,   -765,    154},
+    {    -6,    254,  -1492,   5951,  25770,   3109,  -1002,    184},
+    {    -5,    222,  -1248,   4462,  25906,   4462,  -1248,    217},
+    {    -4,    188,  -1002,   3109,  25770,   5951,  -1492,    248},
+    {    -2,    155,   -765,   1906,  25364,   7558,  -1723,    275},
+    {    -1,    124,   -544,    862,  24699,   9263,  -1928,    293},
+    {    -1,     95,   -345,    -22,  23790,  11037,  -2093,    307},
+    {     0,     70,   -171,   -745,  22658,  12852,  -2200,    304},
+    {     0,     49,    -25,  -1312,  21328,  14674,  -2235,    289},
+    {     0,     32,     93,  -1732,  19831,  16468,  -2179,    255},
+};
+
+static s32 blep_ring[BLEP_RING]  __attribute__((section(".dtcm")));        // Steps still to come for each of the next few samples
+static u8  blep_pos              __attribute__((section(".dtcm"))) = 0;    // The next sample out of the ring
+static s32 blep_sum              __attribute__((section(".dtcm"))) = 0;    // Output level (in 1/32768ths)
+static s16 blep_level            __attribute__((section(".dtcm"))) = 0;    // Beeper level the steps so far add up to
+
+// -------------------------------------------------------------------------------------------
+// Called by the sound stream when it wants 'len' more stereo samples. We fill exactly that
+// many from the mixer ring and if we run dry we just repeat the last sample.
+// -------------------------------------------------------------------------------------------
+ITCM_CODE void audio_fill_stream(s16 *dest, int len)
+{
+    // Way too much queued up (the emulation ran flat out or the stream was paused)? Skip back to the target
+    if (((mixer_write - mixer_read) & WAVE_DIRECT_BUF_SIZE) > AUDIO_RESYNC_FILL)
+    {
+        mixer_read = (mixer_write - AUDIO_TARGET_FILL) & WAVE_DIRECT_BUF_SIZE;
+        audio_overruns++;
+    }
+
+    s16 *p = dest;
+    u8 dry = 0;
+    for (int i=0; i<len*2; i++)
+    {
+        if (mixer_read == mixer_write)
+        {
+            // Just use the last_sample - the rate control will put more in the ring
+            dry = 1;
+        }
+        else
+        {
+            last_sample = mixer[mixer_read];
+            mixer_read = (mixer_read + 1) & WAVE_DIRECT_BUF_SIZE;
+        }
+        *p++ = last_sample;
+    }
+
+    if (dry) audio_underruns++;
+}
+
+/*------------------------------------------------
+ * audio_set_rate()
+ *
+ *  Set the nominal rates the scanline samples are
+ *  made at and the sound stream plays at.
+ *
+ *  param:  Stream samples per second, scanlines per second
+ *  return: Nothing
+ */
+void audio_set_rate(u32 stream_rate, u32 line_rate)
+{
+    audio_nominal = ((u64)line_rate << AUDIO_FRAC) / stream_rate;
+    audio_step    = audio_nominal;
+    audio_trim    = 0;
+}
+
+/*------------------------------------------------
+ * audio_frame()
+ *
+ *  Called at the end of each frame to nudge the
+ *  resampling step to keep the mixer ring level.
+ *
+ *  param:  Nothing
+ *  return: Nothing
+ */
+void audio_frame(void)
+{
+    s32 fill = (mixer_write - mixer_read) & WAVE_DIRECT_BUF_SIZE;
+
+    // The stream drains the ring in big bites so go by the average
+    audio_fill += ((fill << 4) - audio_fill) >> 3;
+
+    s32 error  = (audio_fill >> 4) - AUDIO_TARGET_FILL;
+    s32 adjust = ((s32)audio_nominal / AUDIO_MAX_ADJUST) * error / AUDIO_TARGET_FILL;
+
+    s32 trim_max = ((s32)audio_nominal / AUDIO_MAX_TRIM) * AUDIO_TRIM_FRAMES;
+    audio_trim += adjust;
+    if (audio_trim > trim_max) audio_trim = trim_max; else if (audio_trim < -trim_max) audio_trim = -trim_max;
+
+    audio_step = audio_nominal + adjust + audio_trim / AUDIO_TRIM_FRAMES;
+}
+
+// --------------------------------------------------------------------------------------------
+// Add a step from the current level to a new one, 'cycle' CPU cycles into the last scanline.
+// --------------------------------------------------------------------------------------------
+static inline __attribute__((always_inline)) void blep_add(int cycle, s16 level)
+{
+    if (cycle > (2*BEEPER_CYCLES_PER_LINE - 1)) cycle = 2*BEEPER_CYCLES_PER_LINE - 1;
+
+    int pos = (cycle * BLEP_PHASES) / BEEPER_CYCLES_PER_LINE;
+    const s16 *step = blep_step[pos & (BLEP_PHASES-1)];
+    u8 slot = blep_pos + (pos / BLEP_PHASES);
+    s32 delta = level - blep_level;
+
+    for (int tap=0; tap < BLEP_TAPS; tap++)
+    {
+        blep_ring[(slot + tap) & (BLEP_RING-1)] += delta * step[tap];
+    }
+    blep_level = level;
+}
+
+// --------------------------------------------------------------------------------------------
+// This is called once per scanline to turn the beeper edges of the last scanline into a
+// sample for the mixer ring. The steps are centered a few samples on so the sample that
+// goes out is always one that no later edge can change.
+// --------------------------------------------------------------------------------------------
+ITCM_CODE void processDirectAudio(void)
+{
+    for (u8 i=0; i < beeper_edges; i++)
+    {
+        blep_add(beeper_edge_cycle[i], beeper_edge_level[i]);
+    }
+    beeper_edges = 0;
+
+    // The level was changed behind our back (reset, restore) - just step to it
+    if (blep_level != beeper_vol) blep_add(0, beeper_vol);
+
+    blep_sum += blep_ring[blep_pos];
+    blep_ring[blep_pos] = 0;
+    blep_pos = (blep_pos + 1) & (BLEP_RING-1);
+
+    s32 sample = blep_sum >> BLEP_SHIFT;
+    if (sample > 32767) sample = 32767; else if (sample < -32768) sample = -32768;
+    capture_sample(sample);
+
+    // And any stream samples that fall between the last scanline sample and this one
+    while (audio_pos < (1 << AUDIO_FRAC))
+    {
+        if (((mixer_read - mixer_write - 1) & WAVE_DIRECT_BUF_SIZE) < 2)
+        {
+            audio_overruns++;
+        }
+        else
+        {
+            s16 out = audio_prev + (((sample - audio_prev) * (s32)(audio_pos >> 8)) >> 8);
+            mixer[mixer_write] = out;
+            mixer[(mixer_write + 1) & WAVE_DIRECT_BUF_SIZE] = out;
+            mixer_write = (mixer_write + 2) & WAVE_DIRECT_BUF_SIZE;
+        }
+        audio_pos += audio_step;
+    }
+    audio_pos -= (1 << AUDIO_FRAC);
+    audio_prev = sample;
+}
+
+// -----------------------------------------------------------------------
+// Empty the mixer ring - called whenever the emulation is reset.
+// -----------------------------------------------------------------------
+void sound_chip_reset(void)
+{
+    memset(mixer, 0x00, sizeof(mixer));
+    mixer_read=0;
+    mixer_write=AUDIO_TARGET_FILL;  // Start half full of silence
+    audio_pos = 0;
+    audio_prev = beeper_vol;
+    audio_step = audio_nominal;
+    audio_fill = AUDIO_TARGET_FILL << 4;
+    audio_trim = 0;
+
+    memset(blep_ring, 0x00, sizeof(blep_ring));
+    blep_pos = 0;
+    blep_sum = (s32)beeper_vol << BLEP_SHIFT;
+    blep_level = beeper_vol;
+    beeper_edges = 0;
+}
+
+// End of file
@@ -0,0 +1,57 @@
+// =====================================================================================
+// Copyright (c) 2025 Dave Bernazzani (wavemotion-dave)
+//
+// Copying and distribution of this emulator, its source code and associated
+// readme files, with or without modification, are permitted in any medium without
+// royalty provided this copyright notice is used and wavemotion-dave and eyalabraham
+// (Dragon 32 emu core) are thanked profusely.
+//
+// The Micro-DS emulator is offered as-is, without any warranty. Please see readme.md
+// =====================================================================================
+
+#ifndef __AUDIO_H__
+#define __AUDIO_H__
+
+#include    <nds.h>
+
+#define WAVE_DIRECT_BUF_SIZE 2047   // The mixer ring buffer (must be a power of 2 minus 1)
+
+#define BEEPER_EDGES            32  // Most beeper edges in one scanline (a write to 0xBFFF takes 4+ cycles)
+#define BEEPER_CYCLES_PER_LINE  57  // As the CPU runs them (see cpu.c)
+#define BEEPER_HIGH         0x1AFF  // Level with bit 7 of 0xBFFF set
+
+extern s16 beeper_vol;
+extern u8  beeper_edges;
+extern u8  beeper_edge_cycle[BEEPER_EDGES];
+extern s16 beeper_edge_level[BEEPER_EDGES];
+extern s16 last_sample;
+extern u16 mixer_read;
+extern u16 mixer_write;
+extern s16 mixer[WAVE_DIRECT_BUF_SIZE+1];
+extern u32 audio_underruns;
+extern u32 audio_overruns;
+
+extern void processDirectAudio(void);
+extern void sound_chip_reset(void);
+extern void audio_fill_stream(s16 *dest, int len);
+extern void audio_set_rate(u32 stream_rate, u32 line_rate);
+extern void audio_frame(void);
+
+// ------------------------------------------------------------------------
+// The beeper has been set to a new level 'cycle' CPU cycles into the
+// scanline. Should the queue ever fill, the last edge takes the new level.
+// ------------------------------------------------------------------------
+static inline void beeper_edge(int cycle, s16 level)
+{
+    if (level == beeper_vol) return;
+
+    u8 edge = beeper_edges;
+    if (edge < BEEPER_EDGES) beeper_edges++;
+    else edge = BEEPER_EDGES - 1;
+
+    beeper_edge_cycle[edge] = (cycle > 255) ? 255 : cycle;
+    beeper_edge_level[edge] = level;
+    beeper_vol = level;
+}
+
+#endif  /* __AUDIO_H__ */
@@ -0,0 +1,181 @@
+// =====================================================================================
+// Copyright (c) 2025 Dave Bernazzani (wavemotion-dave)
+//
+// Copying and distribution of this emulator, its source code and associated
+// readme files, with or without modification, are permitted in any medium without
+// royalty provided this copyright notice is used and wavemotion-dave and eyalabraham
+// (Dragon 32 emu core) are thanked profusely.
+//
+// The Micro-DS emulator is offered as-is, without any warranty. Please see readme.md
+// =====================================================================================
+
+/********************************************************************
+ * capture.c
+ *
+ *  Record the beeper to a 16-bit mono .wav file at the scanline rate.
+ *  The samples are taken before they are resampled for the sound
+ *  stream so two recordings of the same run are identical sample for
+ *  sample - the host bench (-s) uses this to diff the audio of one
+ *  version of the core against another.
+ *
+ *******************************************************************/
+#include    <nds.h>
+#include    <stdio.h>
+#include    <string.h>
+
+#include    "capture.h"
+
+#define CAPTURE_SECTOR      512
+
+// ------------------------------------------------------------------------
+// The .wav header. A JUNK chunk (which anything reading a .wav skips over)
+// pads it out to a whole sector so the samples after it are sector aligned.
+// ------------------------------------------------------------------------
+typedef struct
+{
+    char            riff_id[4];
+    uint32_t        riff_size;
+    char            wave_id[4];
+
+    char            fmt_id[4];
+    uint32_t        fmt_size;
+    uint16_t        format;
+    uint16_t        channels;
+    uint32_t        rate;
+    uint32_t        byte_rate;
+    uint16_t        block_align;
+    uint16_t        bits;
+
+    char            junk_id[4];
+    uint32_t        junk_size;
+    uint8_t         junk[CAPTURE_SECTOR - 52];
+
+    char            data_id[4];
+    uint32_t        data_size;
+} capture_header_t;
+
+_Static_assert(sizeof(capture_header_t) == CAPTURE_SECTOR, "capture header must be one sector");
+
+u8   capture_on                         __attribute__((section(".dtcm"))) = 0;
+u8   capture_half                       __attribute__((section(".dtcm"))) = 0;   // The half being filled
+u16  capture_pos                        __attribute__((section(".dtcm"))) = 0;   // The next sample in that half
+s16  capture_buffer[2][CAPTURE_SAMPLES];
+u32  capture_dropped                    = 0;    // Samples lost because a half wasn't written out in time
+
+static u8   capture_ready[2]            = {0};  // Set when a half is full and waiting to be written
+static FILE *capture_file               = NULL;
+static capture_header_t capture_header;
+
+/*------------------------------------------------
+ * capture_start()
+ *
+ *  Start recording to a new .wav file.
+ *
+ *  param:  File name, samples per second
+ *  return: 1 if recording, 0 if the file couldn't be made
+ */
+int capture_start(const char *filename, u32 rate)
+{
+    capture_stop();
+
+    capture_file = fopen(filename, "wb");
+    if (!capture_file) return 0;
+
+    memset(&capture_header, 0x00, sizeof(capture_header));
+    memcpy(capture_header.riff_id, "RIFF", 4);
+    memcpy(capture_header.wave_id, "WAVE", 4);
+    memcpy(capture_header.fmt_id,  "fmt ", 4);
+    capture_header.fmt_size     = 16;
+    capture_header.format       = 1;    // PCM
+    capture_header.channels     = 1;
+    capture_header.rate         = rate;
+    capture_header.byte_rate    = rate * sizeof(s16);
+    capture_header.block_align  = sizeof(s16);
+    capture_header.bits         = 16;
+    memcpy(capture_header.junk_id, "JUNK", 4);
+    capture_header.junk_size    = sizeof(capture_header.junk);
+    memcpy(capture_header.data_id, "data", 4);
+
+    // Sizes are filled in by capture_stop()
+    fwrite(&capture_header, sizeof(capture_header), 1, capture_file);
+
+    capture_half     = 0;
+    capture_pos      = 0;
+    capture_ready[0] = 0;
+    capture_ready[1] = 0;
+    capture_dropped  = 0;
+    capture_on       = 1;
+
+    return 1;
+}
+
+/*------------------------------------------------
+ * capture_next()
+ *
+ *  The half being filled is full - switch to the
+ *  other. Only called from capture_sample() so it
+ *  just flags the full half for capture_flush().
+ *
+ *  param:  Nothing
+ *  return: Nothing
+ */
+void capture_next(void)
+{
+    capture_ready[capture_half] = 1;
+    capture_half ^= 1;
+    capture_pos = 0;
+
+    // Still not written out? Those samples are lost
+    if (capture_ready[capture_half])
+    {
+        capture_ready[capture_half] = 0;
+        capture_dropped += CAPTURE_SAMPLES;
+    }
+}
+
+/*------------------------------------------------
+ * capture_flush()
+ *
+ *  Write out the half of the double buffer that
+ *  has filled (if it has). Call once per frame.
+ *
+ *  param:  Nothing
+ *  return: Nothing
+ */
+void capture_flush(void)
+{
+    u8 half = capture_half ^ 1;
+
+    if (!capture_on || !capture_ready[half]) return;
+
+    fwrite(capture_buffer[half], sizeof(s16), CAPTURE_SAMPLES, capture_file);
+    capture_header.data_size += CAPTURE_SAMPLES * sizeof(s16);
+    capture_ready[half] = 0;
+}
+
+/*------------------------------------------------
+ * capture_stop()
+ *
+ *  Write out what's left, fill in the sizes in the
+ *  .wav header and close the file.
+ *
+ *  param:  Nothing
+ *  return: Nothing
+ */
+void capture_stop(void)
+{
+    if (!capture_on) return;
+
+    capture_flush();
+    fwrite(capture_buffer[capture_half], sizeof(s16), capture_pos, capture_file);
+    capture_header.data_size += capture_pos * sizeof(s16);
+    capture_on = 0;
+
+    capture_header.riff_size = sizeof(capture_header) - 8 + capture_header.data_size;
+    fseek(capture_file, 0, SEEK_SET);
+    fwrite(&capture_header, sizeof(capture_header), 1, capture_file);
+    fclose(capture_file);
+    capture_file = NULL;
+}
+
+// End of file
@@ -0,0 +1,48 @@
+// =====================================================================================
+// Copyright (c) 2025 Dave Bernazzani (wavemotion-dave)
+//
+// Copying and distribution of this emulator, its source code and associated
+// readme files, with or without modification, are permitted in any medium without
+// royalty provided this copyright notice is used and wavemotion-dave and eyalabraham
+// (Dragon 32 emu core) are thanked profusely.
+//
+// The Micro-DS emulator is offered as-is, without any warranty. Please see readme.md
+// =====================================================================================
+
+#ifndef __CAPTURE_H__
+#define __CAPTURE_H__
+
+#include    <nds.h>
+
+// ------------------------------------------------------------------------
+// Audio capture to a .wav file. The sample made each scanline (before it
+// is resampled for the sound stream) goes into one half of a double buffer
+// and capture_flush() writes out whichever half has filled - called once
+// a frame, never from the scanline loop. Each half is a whole number of
+// 512 byte sectors and so is the .wav header.
+// ------------------------------------------------------------------------
+#define CAPTURE_SAMPLES     2048    // Per half of the double buffer (4K - about 8 frames)
+
+extern u8   capture_on;
+extern u8   capture_half;
+extern u16  capture_pos;
+extern s16  capture_buffer[2][CAPTURE_SAMPLES];
+extern u32  capture_dropped;
+
+extern int  capture_start(const char *filename, u32 rate);
+extern void capture_stop(void);
+extern void capture_flush(void);
+extern void capture_next(void);
+
+// ------------------------------------------------------------------------
+// Add the scanline sample to the capture (when capturing).
+// ------------------------------------------------------------------------
+static inline void capture_sample(s16 sample)
+{
+    if (!capture_on) return;
+
+    capture_buffer[capture_half][capture_pos] = sample;
+    if (++capture_pos == CAPTURE_SAMPLES) capture_next();
+}
+
+#endif  /* __CAPTURE_H__ */
@@ -22,6 +22,7 @@
 #include    "mc6803.h"
 #include    "mem.h"
 #include    "cpu.h"
+#include    "hle.h"
 
 /* -----------------------------------------
    Local definitions
@@ -46,12 +47,85 @@
 #define     CC_FLAG_CLR             0
 #define     CC_FLAG_SET             1
 
+/* Condition-code flag access.
+ * By default the eval_cc_*() helpers work out each flag as soon as an
+ * instruction completes and store it as 0/1 in the 'cc' structure. Building
+ * with CPU_LAZY_FLAGS instead has the helpers just record the raw result
+ * (and for V/H the operand mix) that each flag is derived from, and the flag
+ * is only worked out when something reads it - a branch, TPA, get_cc() when
+ * the CC register is stacked, etc. Most flags are overwritten before anyone
+ * looks at them. The raw values are kept aligned to the 16-bit flag
+ * positions (8-bit results are shifted up by 8) so one test serves both
+ * widths: C is bit 16, N and V are bit 15, H is bit 4 and Z is set when the
+ * low 16 bits are all zero. The interrupt mask is always kept in cc.i.
+ */
+#ifdef CPU_LAZY_FLAGS
+#define     CC_C                    ((lazy_cc.c >> 16) & 1)
+#define     CC_V                    ((lazy_cc.v >> 15) & 1)
+#define     CC_Z                    ((lazy_cc.z & 0xffff) ? CC_FLAG_CLR : CC_FLAG_SET)
+#define     CC_N                    ((lazy_cc.n >> 15) & 1)
+#define     CC_H                    ((lazy_cc.h >> 4) & 1)
+#define     SET_CC_C(f)             lazy_cc.c = ((uint32_t)(f) << 16)
+#define     SET_CC_V(f)             lazy_cc.v = ((uint32_t)(f) << 15)
+#define     SET_CC_Z(f)             lazy_cc.z = ((f) ? 0 : 1)
+#define     SET_CC_N(f)             lazy_cc.n = ((uint32_t)(f) << 15)
+#define     SET_CC_H(f)             lazy_cc.h = ((uint32_t)(f) << 4)
+#else
+#define     CC_C                    cc.c
+#define     CC_V                    cc.v
+#define     CC_Z                    cc.z
+#define     CC_N                    cc.n
+#define     CC_H                    cc.h
+#define     SET_CC_C(f)             cc.c = (f)
+#define     SET_CC_V(f)             cc.v = (f)
+#define     SET_CC_Z(f)             cc.z = (f)
+#define     SET_CC_N(f)             cc.n = (f)
+#define     SET_CC_H(f)             cc.h = (f)
+#endif
+
 /* Word and Byte operations
  */
 #define     GET_REG_HIGH(r)         ((uint8_t)(r >> 8))
 #define     GET_REG_LOW(r)          ((uint8_t)r)
 #define     SIG_EXTEND(b)           ((((uint8_t)b) & 0x80) ? (((uint16_t)b) | 0xff00):((uint16_t)b))
 
+/* Op-code dispatch.
+ * The default build resolves the effective address with get_eff_addr()
+ * and dispatches through the switch() in cpu_run(). Building with
+ * CPU_THREADED_DISPATCH instead jumps through a table of label addresses
+ * (GCC computed goto) to a small per op-code stub that resolves its own
+ * addressing mode in-line. Each stub sits in an 'if (0)' block in front
+ * of the shared op-code body, so it can only be entered by the jump and
+ * then falls through the following (skipped) stubs into the body. The
+ * body text, including the 'break' at the end, is the same for both.
+ */
+#ifdef CPU_THREADED_DISPATCH
+#pragma GCC diagnostic ignored "-Wswitch-unreachable"   // The switch() is only there to scope 'break'
+#define     OPCODE(op, mode)        if (0) { op_##op: EA_##mode; if (0) { dc_##op: DC_##mode; } }
+#else
+#define     OPCODE(op, mode)        case op:
+#endif
+
+#define     EA_DIRECT               eff_addr = mem_read_pc(cpu.pc++)
+#define     EA_RELATIVE             operand8 = mem_read_pc(cpu.pc++); eff_addr = (cpu.pc + SIG_EXTEND(operand8)) & 0xffff
+#define     EA_INDEXED              eff_addr = (uint16_t)(cpu.x + mem_read_pc(cpu.pc++))
+#define     EA_EXTENDED             eff_addr = (mem_read_pc(cpu.pc++) << 8); eff_addr += mem_read_pc(cpu.pc++)
+#define     EA_IMMEDIATE            eff_addr = cpu.pc; cpu.pc += 1
+#define     EA_LIMMEDIATE           eff_addr = cpu.pc; cpu.pc += 2
+#define     EA_INHERENT
+
+/* Predecoded ROM instructions (see cpu_decode_run()) come in with eff_addr
+ * already resolved - all but indexed which only has the offset to add to X.
+ * The threaded build enters each op-code through its dc_ label to do this.
+ */
+#define     DC_DIRECT
+#define     DC_RELATIVE
+#define     DC_INDEXED              eff_addr = (uint16_t)(cpu.x + eff_addr)
+#define     DC_EXTENDED
+#define     DC_IMMEDIATE
+#define     DC_LIMMEDIATE
+#define     DC_INHERENT
+
 /* -----------------------------------------
    Module functions
 ----------------------------------------- */
@@ -112,8 +186,6 @@ void    eval_cc_v(uint8_t val1, uint8_t val2, uint16_t result);
 void    eval_cc_v16(uint16_t val1, uint16_t val2, uint32_t result);
 void    eval_cc_h(uint8_t val1, uint8_t val2, uint8_t result);
 
-uint8_t get_cc(void);
-void    set_cc(uint8_t value);
 
 /* -----------------------------------------
    Module globals
@@ -133,8 +205,54 @@ struct cc_t
     uint8_t h;
 } cc __attribute__((section(".dtcm")));
 
+#ifdef CPU_LAZY_FLAGS
+/* Raw values the C, V, Z, N and H flags are derived from (see CC_C etc.)
+ */
+struct lazy_cc_t
+{
+    uint32_t c;
+    uint32_t v;
+    uint32_t z;
+    uint32_t n;
+    uint32_t h;
+} lazy_cc __attribute__((section(".dtcm")));
+#endif
+
 int cpu_cycle_deficit    __attribute__((section(".dtcm"))) = 0;
 
+/* Timer scheduling. Rather than stepping the free-running counter after
+ * every instruction, cpu.counter is only brought up to date (along with
+ * the OCF/TOF flags) by cpu_timer_sync(). In between, the counter value
+ * is cpu.counter plus the cycles run since cpu_timer_origin. The CPU loop
+ * runs without looking at the timer until cpu_line_cycles reaches
+ * cpu_next_event - the next output compare, counter overflow or the end
+ * of the scanline, whichever comes first.
+ */
+int cpu_line_cycles      __attribute__((section(".dtcm"))) = 0;    // Cycles run so far on this scanline
+int cpu_timer_origin     __attribute__((section(".dtcm"))) = 0;    // Value of cpu_line_cycles when cpu.counter was last synced
+int cpu_next_event       __attribute__((section(".dtcm"))) = 0;    // Value of cpu_line_cycles at which the timer must be looked at
+
+/* ROM decode cache. The ROM at C000-FFFF never changes (short of a bank
+ * switch) so each instruction there is decoded once into a record holding
+ * the op-code, the effective address worked out from its operand bytes,
+ * its length and cycles. cpu_run() then skips the operand fetching and
+ * decoding for any instruction with a record. Records are filled a run of
+ * straight-line code at a time and thrown away when the page they were
+ * decoded from is mapped out (see cpu_decode_map()).
+ */
+typedef struct
+{
+    uint16_t    operand;    // Effective address (just the offset for indexed)
+    uint8_t     op_code;
+    uint8_t     length;     // Op-code plus operand bytes - 0 if not decoded yet
+    uint8_t     cycles;     // 0 if this instruction can't be predecoded
+    uint8_t     indexed;    // Add X to the operand at run time
+} cpu_decoded_t;
+
+cpu_decoded_t  cpu_decoded[0x4000];                                           // One record per ROM address
+cpu_decoded_t *cpu_decoded_page[256]    __attribute__((section(".dtcm")));    // Records for each page (NULL if not ROM)
+static uint8_t *decoded_source[0x40];                                         // What each ROM page was decoded from
+
 /*------------------------------------------------
  * cpu_init()
  *
@@ -191,6 +309,224 @@ void cpu_check_reset(void)
     }
 }
 
+/*------------------------------------------------
+ * cpu_timer_sync()
+ *
+ *  Bring the free-running counter up to date with the
+ *  cycles run since it was last synced, setting the OCF
+ *  and TOF flags as the per-instruction stepping would have.
+ *  This is exact as long as it is called no later than the
+ *  instruction that reaches the event scheduled by
+ *  cpu_timer_schedule() - anything earlier is harmless.
+ *
+ *  param:  Nothing
+ *  return: Nothing
+ */
+ITCM_CODE void cpu_timer_sync(void)
+{
+    int elapsed = cpu_line_cycles - cpu_timer_origin;
+    cpu_timer_origin = cpu_line_cycles;
+
+    if (cpu.counter < cpu.compare)
+    {
+        if ((cpu.counter + elapsed) >= cpu.compare)
+        {
+            Memory[0x08] |= TCSR_OCF;
+        }
+    }
+    cpu.counter += elapsed;
+    if (cpu.counter & 0xFFFF0000) // Overflow
+    {
+        cpu.counter &= 0xFFFF;
+        Memory[0x08] |= TCSR_TOF;
+    }
+}
+
+/*------------------------------------------------
+ * cpu_timer_schedule()
+ *
+ *  Work out the scanline cycle at which the timer next needs
+ *  attention: the counter reaching the compare register, the
+ *  counter rolling over or the end of the scanline. Must be
+ *  called right after cpu_timer_sync().
+ *
+ *  param:  Nothing
+ *  return: Nothing
+ */
+static inline __attribute__((always_inline)) void cpu_timer_schedule(void)
+{
+    int to_event = (cpu.counter < cpu.compare) ? (cpu.compare - cpu.counter) : (0x10000 - cpu.counter);
+
+    cpu_next_event = cpu_timer_origin + to_event;
+    if (cpu_next_event > CPU_CYCLES_PER_LINE) cpu_next_event = CPU_CYCLES_PER_LINE;
+}
+
+/*------------------------------------------------
+ * cpu_timer_halted()
+ *
+ *  Clock the free-running counter while the CPU sits in WAI.
+ *  This is the same as stepping the counter one cycle at a
+ *  time (so a compare of 0 is never matched since the counter
+ *  steps from 0xFFFF onto 0x10000 before rolling over) but is
+ *  worked out directly so any number of cycles takes O(1).
+ *
+ *  param:  Number of cycles to clock the counter by
+ *  return: Nothing
+ */
+static inline __attribute__((always_inline)) void cpu_timer_halted(uint32_t cycles)
+{
+    uint32_t end = cpu.counter + cycles;
+
+    if (cpu.compare)
+    {
+        if ((end >= 0x10000 + cpu.compare) || ((cpu.compare > cpu.counter) && (cpu.compare <= end)))
+        {
+            Memory[0x08] |= TCSR_OCF;
+        }
+    }
+
+    if (end & 0xFFFF0000) // Overflow
+    {
+        Memory[0x08] |= TCSR_TOF;
+    }
+    cpu.counter = end & 0xFFFF;
+}
+
+/*------------------------------------------------
+ * cpu_decode_map()
+ *
+ *  Called by mem_map_build() after the page table has changed.
+ *  Pages C0-FF that are read-only take part in the decode cache
+ *  and any whose contents now come from somewhere else (an MCX
+ *  ROM bank switch) have their records thrown away - along with
+ *  the end of the page before as an instruction there may run
+ *  on into this page.
+ *
+ *  param:  Nothing
+ *  return: Nothing
+ */
+void cpu_decode_map(void)
+{
+    for (int page=0xC0; page<0x100; page++)
+    {
+        uint8_t *source = (mem_write_page[page] == write_sink_page) ? mem_read_page[page] : NULL;
+
+        if (source != decoded_source[page - 0xC0])
+        {
+            decoded_source[page - 0xC0] = source;
+
+            cpu_decoded_t *records = &cpu_decoded[(page - 0xC0) << 8];
+            memset(records, 0x00, 256 * sizeof(cpu_decoded_t));
+            if (page > 0xC0) memset(records - 2, 0x00, 2 * sizeof(cpu_decoded_t));
+        }
+
+        cpu_decoded_page[page] = source ? &cpu_decoded[(page - 0xC0) << 8] : NULL;
+    }
+}
+
+/*------------------------------------------------
+ * cpu_decode_flush()
+ *
+ *  Throw away every decoded record. Needed when the
+ *  ROM image itself is reloaded (mem_load_rom()).
+ *
+ *  param:  Nothing
+ *  return: Nothing
+ */
+void cpu_decode_flush(void)
+{
+    memset(cpu_decoded, 0x00, sizeof(cpu_decoded));
+}
+
+/*------------------------------------------------
+ * cpu_decode_run()
+ *
+ *  Decode the straight-line run of ROM instructions
+ *  starting at 'pc' up to the next branch, jump, call
+ *  or return (or the end of the ROM). An instruction
+ *  that can't be predecoded (illegal op-code or with
+ *  operand bytes outside the ROM) is left to the normal
+ *  fetch and decode.
+ *
+ *  param:  Address of the first instruction
+ *  return: Nothing
+ */
+static void cpu_decode_run(int pc)
+{
+    while (pc < 0x10000)
+    {
+        cpu_decoded_t *decoded = cpu_decoded_page[pc >> 8];
+        if (!decoded) break;
+
+        decoded += (pc & 0xff);
+        if (decoded->length) break;     // Already decoded from here on
+
+        int op_code = mem_read_pc(pc);
+        int mode = machine_code[op_code].mode;
+        int length = 1;
+
+        switch ( mode )
+        {
+            case ADDR_DIRECT:
+            case ADDR_RELATIVE:
+            case ADDR_INDEXED:
+            case ADDR_IMMEDIATE:
+                length = 2;
+                break;
+
+            case ADDR_EXTENDED:
+            case ADDR_LIMMEDIATE:
+                length = 3;
+                break;
+        }
+
+        decoded->op_code = op_code;
+        decoded->length  = length;
+        decoded->cycles  = 0;
+        decoded->indexed = 0;
+
+        // Every byte of the instruction must come from the ROM and entry points with a native routine are left alone
+        if (hle_find(pc) || (mode == ILLEGAL_OP) || ((pc + length) > 0x10000) || !cpu_decoded_page[(pc + length - 1) >> 8]) break;
+
+        switch ( mode )
+        {
+            case ADDR_DIRECT:
+                decoded->operand = mem_read_pc(pc+1);
+                break;
+
+            case ADDR_RELATIVE:
+                decoded->operand = (pc + 2 + SIG_EXTEND(mem_read_pc(pc+1))) & 0xffff;
+                break;
+
+            case ADDR_INDEXED:
+                decoded->operand = mem_read_pc(pc+1);
+                decoded->indexed = 1;
+                break;
+
+            case ADDR_EXTENDED:
+                decoded->operand = (mem_read_pc(pc+1) << 8) | mem_read_pc(pc+2);
+                break;
+
+            case ADDR_IMMEDIATE:
+            case ADDR_LIMMEDIATE:
+                decoded->operand = pc + 1;
+                break;
+
+            default:
+                decoded->operand = 0;
+                break;
+        }
+
+        decoded->cycles = machine_code[op_code].cycles;
+
+        // The run ends at anything that changes the flow of the program
+        if ((mode == ADDR_RELATIVE) || (op_code == 0x6e) || (op_code == 0x7e) || (op_code == 0x9d) || (op_code == 0xad) ||
+            (op_code == 0xbd) || (op_code == 0x39) || (op_code == 0x3b) || (op_code == 0x3e) || (op_code == 0x3f)) break;
+
+        pc += length;
+    }
+}
+
 /*------------------------------------------------
  * cpu_run()
  *
@@ -203,31 +539,79 @@ void cpu_check_reset(void)
  */
 ITCM_CODE void cpu_run(void)
 {
-    int         eff_addr;
+    int         eff_addr = 0;
     uint8_t     operand8;
     uint16_t    operand16;
     int         op_code;
+    int         op_cycles;
+
+#ifdef CPU_THREADED_DISPATCH
+    /* One entry per op-code pointing at the addressing mode stub
+     * in front of the op-code body (see OPCODE() above).
+     */
+    static const void *opcode_dispatch[256] __attribute__((section(".dtcm"))) =
+    {
+        &&op_0x00, &&op_0x01, &&op_0x02, &&op_0x03, &&op_0x04, &&op_0x05, &&op_0x06, &&op_0x07, &&op_0x08, &&op_0x09, &&op_0x0a, &&op_0x0b, &&op_0x0c, &&op_0x0d, &&op_0x0e, &&op_0x0f,
+        &&op_0x10, &&op_0x11, &&op_0x12, &&op_0x13, &&op_0x14, &&op_0x15, &&op_0x16, &&op_0x17, &&op_0x18, &&op_0x19, &&op_0x1a, &&op_0x1b, &&op_0x1c, &&op_0x1d, &&op_0x1e, &&op_0x1f,
+        &&op_0x20, &&op_0x21, &&op_0x22, &&op_0x23, &&op_0x24, &&op_0x25, &&op_0x26, &&op_0x27, &&op_0x28, &&op_0x29, &&op_0x2a, &&op_0x2b, &&op_0x2c, &&op_0x2d, &&op_0x2e, &&op_0x2f,
+        &&op_0x30, &&op_0x31, &&op_0x32, &&op_0x33, &&op_0x34, &&op_0x35, &&op_0x36, &&op_0x37, &&op_0x38, &&op_0x39, &&op_0x3a, &&op_0x3b, &&op_0x3c, &&op_0x3d, &&op_0x3e, &&op_0x3f,
+        &&op_0x40, &&op_0x41, &&op_0x42, &&op_0x43, &&op_0x44, &&op_0x45, &&op_0x46, &&op_0x47, &&op_0x48, &&op_0x49, &&op_0x4a, &&op_0x4b, &&op_0x4c, &&op_0x4d, &&op_illegal, &&op_0x4f,
+        &&op_0x50, &&op_0x51, &&op_0x52, &&op_0x53, &&op_0x54, &&op_0x55, &&op_0x56, &&op_0x57, &&op_0x58, &&op_0x59, &&op_0x5a, &&op_0x5b, &&op_0x5c, &&op_0x5d, &&op_illegal, &&op_0x5f,
+        &&op_0x60, &&op_0x61, &&op_0x62, &&op_0x63, &&op_0x64, &&op_0x65, &&op_0x66, &&op_0x67, &&op_0x68, &&op_0x69, &&op_0x6a, &&op_0x6b, &&op_0x6c, &&op_0x6d, &&op_0x6e, &&op_0x6f,
+        &&op_0x70, &&op_0x71, &&op_0x72, &&op_0x73, &&op_0x74, &&op_0x75, &&op_0x76, &&op_0x77, &&op_0x78, &&op_0x79, &&op_0x7a, &&op_0x7b, &&op_0x7c, &&op_0x7d, &&op_0x7e, &&op_0x7f,
+        &&op_0x80, &&op_0x81, &&op_0x82, &&op_0x83, &&op_0x84, &&op_0x85, &&op_0x86, &&op_0x87, &&op_0x88, &&op_0x89, &&op_0x8a, &&op_0x8b, &&op_0x8c, &&op_0x8d, &&op_0x8e, &&op_0x8f,
+        &&op_0x90, &&op_0x91, &&op_0x92, &&op_0x93, &&op_0x94, &&op_0x95, &&op_0x96, &&op_0x97, &&op_0x98, &&op_0x99, &&op_0x9a, &&op_0x9b, &&op_0x9c, &&op_0x9d, &&op_0x9e, &&op_0x9f,
+        &&op_0xa0, &&op_0xa1, &&op_0xa2, &&op_0xa3, &&op_0xa4, &&op_0xa5, &&op_0xa6, &&op_0xa7, &&op_0xa8, &&op_0xa9, &&op_0xaa, &&op_0xab, &&op_0xac, &&op_0xad, &&op_0xae, &&op_0xaf,
+        &&op_0xb0, &&op_0xb1, &&op_0xb2, &&op_0xb3, &&op_0xb4, &&op_0xb5, &&op_0xb6, &&op_0xb7, &&op_0xb8, &&op_0xb9, &&op_0xba, &&op_0xbb, &&op_0xbc, &&op_0xbd, &&op_0xbe, &&op_0xbf,
+        &&op_0xc0, &&op_0xc1, &&op_0xc2, &&op_0xc3, &&op_0xc4, &&op_0xc5, &&op_0xc6, &&op_0xc7, &&op_0xc8, &&op_0xc9, &&op_0xca, &&op_0xcb, &&op_0xcc, &&op_0xcd, &&op_0xce, &&op_0xcf,
+        &&op_0xd0, &&op_0xd1, &&op_0xd2, &&op_0xd3, &&op_0xd4, &&op_0xd5, &&op_0xd6, &&op_0xd7, &&op_0xd8, &&op_0xd9, &&op_0xda, &&op_0xdb, &&op_0xdc, &&op_0xdd, &&op_0xde, &&op_0xdf,
+        &&op_0xe0, &&op_0xe1, &&op_0xe2, &&op_0xe3, &&op_0xe4, &&op_0xe5, &&op_0xe6, &&op_0xe7, &&op_0xe8, &&op_0xe9, &&op_0xea, &&op_0xeb, &&op_0xec, &&op_0xed, &&op_0xee, &&op_0xef,
+        &&op_0xf0, &&op_0xf1, &&op_0xf2, &&op_0xf3, &&op_0xf4, &&op_0xf5, &&op_0xf6, &&op_0xf7, &&op_0xf8, &&op_0xf9, &&op_0xfa, &&op_0xfb, &&op_0xfc, &&op_0xfd, &&op_0xfe, &&op_0xff
+    };
+
+    /* The same for predecoded instructions - straight to the op-code body
+     * with eff_addr already resolved (see DC_INDEXED).
+     */
+    static const void *decoded_dispatch[256] __attribute__((section(".dtcm"))) =
+    {
+        &&dc_0x00, &&dc_0x01, &&dc_0x02, &&dc_0x03, &&dc_0x04, &&dc_0x05, &&dc_0x06, &&dc_0x07, &&dc_0x08, &&dc_0x09, &&dc_0x0a, &&dc_0x0b, &&dc_0x0c, &&dc_0x0d, &&dc_0x0e, &&dc_0x0f,
+        &&dc_0x10, &&dc_0x11, &&dc_0x12, &&dc_0x13, &&dc_0x14, &&dc_0x15, &&dc_0x16, &&dc_0x17, &&dc_0x18, &&dc_0x19, &&dc_0x1a, &&dc_0x1b, &&dc_0x1c, &&dc_0x1d, &&dc_0x1e, &&dc_0x1f,
+        &&dc_0x20, &&dc_0x21, &&dc_0x22, &&dc_0x23, &&dc_0x24, &&dc_0x25, &&dc_0x26, &&dc_0x27, &&dc_0x28, &&dc_0x29, &&dc_0x2a, &&dc_0x2b, &&dc_0x2c, &&dc_0x2d, &&dc_0x2e, &&dc_0x2f,
+        &&dc_0x30, &&dc_0x31, &&dc_0x32, &&dc_0x33, &&dc_0x34, &&dc_0x35, &&dc_0x36, &&dc_0x37, &&dc_0x38, &&dc_0x39, &&dc_0x3a, &&dc_0x3b, &&dc_0x3c, &&dc_0x3d, &&dc_0x3e, &&dc_0x3f,
+        &&dc_0x40, &&dc_0x41, &&dc_0x42, &&dc_0x43, &&dc_0x44, &&dc_0x45, &&dc_0x46, &&dc_0x47, &&dc_0x48, &&dc_0x49, &&dc_0x4a, &&dc_0x4b, &&dc_0x4c, &&dc_0x4d, &&op_illegal, &&dc_0x4f,
+        &&dc_0x50, &&dc_0x51, &&dc_0x52, &&dc_0x53, &&dc_0x54, &&dc_0x55, &&dc_0x56, &&dc_0x57, &&dc_0x58, &&dc_0x59, &&dc_0x5a, &&dc_0x5b, &&dc_0x5c, &&dc_0x5d, &&op_illegal, &&dc_0x5f,
+        &&dc_0x60, &&dc_0x61, &&dc_0x62, &&dc_0x63, &&dc_0x64, &&dc_0x65, &&dc_0x66, &&dc_0x67, &&dc_0x68, &&dc_0x69, &&dc_0x6a, &&dc_0x6b, &&dc_0x6c, &&dc_0x6d, &&dc_0x6e, &&dc_0x6f,
+        &&dc_0x70, &&dc_0x71, &&dc_0x72, &&dc_0x73, &&dc_0x74, &&dc_0x75, &&dc_0x76, &&dc_0x77, &&dc_0x78, &&dc_0x79, &&dc_0x7a, &&dc_0x7b, &&dc_0x7c, &&dc_0x7d, &&dc_0x7e, &&dc_0x7f,
+        &&dc_0x80, &&dc_0x81, &&dc_0x82, &&dc_0x83, &&dc_0x84, &&dc_0x85, &&dc_0x86, &&dc_0x87, &&dc_0x88, &&dc_0x89, &&dc_0x8a, &&dc_0x8b, &&dc_0x8c, &&dc_0x8d, &&dc_0x8e, &&dc_0x8f,
+        &&dc_0x90, &&dc_0x91, &&dc_0x92, &&dc_0x93, &&dc_0x94, &&dc_0x95, &&dc_0x96, &&dc_0x97, &&dc_0x98, &&dc_0x99, &&dc_0x9a, &&dc_0x9b, &&dc_0x9c, &&dc_0x9d, &&dc_0x9e, &&dc_0x9f,
+        &&dc_0xa0, &&dc_0xa1, &&dc_0xa2, &&dc_0xa3, &&dc_0xa4, &&dc_0xa5, &&dc_0xa6, &&dc_0xa7, &&dc_0xa8, &&dc_0xa9, &&dc_0xaa, &&dc_0xab, &&dc_0xac, &&dc_0xad, &&dc_0xae, &&dc_0xaf,
+        &&dc_0xb0, &&dc_0xb1, &&dc_0xb2, &&dc_0xb3, &&dc_0xb4, &&dc_0xb5, &&dc_0xb6, &&dc_0xb7, &&dc_0xb8, &&dc_0xb9, &&dc_0xba, &&dc_0xbb, &&dc_0xbc, &&dc_0xbd, &&dc_0xbe, &&dc_0xbf,
+        &&dc_0xc0, &&dc_0xc1, &&dc_0xc2, &&dc_0xc3, &&dc_0xc4, &&dc_0xc5, &&dc_0xc6, &&dc_0xc7, &&dc_0xc8, &&dc_0xc9, &&dc_0xca, &&dc_0xcb, &&dc_0xcc, &&dc_0xcd, &&dc_0xce, &&dc_0xcf,
+        &&dc_0xd0, &&dc_0xd1, &&dc_0xd2, &&dc_0xd3, &&dc_0xd4, &&dc_0xd5, &&dc_0xd6, &&dc_0xd7, &&dc_0xd8, &&dc_0xd9, &&dc_0xda, &&dc_0xdb, &&dc_0xdc, &&dc_0xdd, &&dc_0xde, &&dc_0xdf,
+        &&dc_0xe0, &&dc_0xe1, &&dc_0xe2, &&dc_0xe3, &&dc_0xe4, &&dc_0xe5, &&dc_0xe6, &&dc_0xe7, &&dc_0xe8, &&dc_0xe9, &&dc_0xea, &&dc_0xeb, &&dc_0xec, &&dc_0xed, &&dc_0xee, &&dc_0xef,
+        &&dc_0xf0, &&dc_0xf1, &&dc_0xf2, &&dc_0xf3, &&dc_0xf4, &&dc_0xf5, &&dc_0xf6, &&dc_0xf7, &&dc_0xf8, &&dc_0xf9, &&dc_0xfa, &&dc_0xfb, &&dc_0xfc, &&dc_0xfd, &&dc_0xfe, &&dc_0xff
+    };
+#endif
+
+    cpu_line_cycles = cpu_cycle_deficit;
+    cpu_timer_origin = cpu_line_cycles;
+    cpu_timer_schedule();
 
-    int cycles_this_scanline = cpu_cycle_deficit;
-    
     while (1)
     {
         if (cpu.cpu_state) // Something OTHER than CPU_EXEC - might be CPU halted (WAI instruction) or a CPU Exception
         {
+            cpu_timer_sync();
+
             if (cpu.cpu_state == CPU_HALTED)
             {
                 // If we are halted, we still clock the timers...
-                for (int i=0; i<CPU_CYCLES_PER_LINE; i++)
+                cpu_timer_halted(CPU_CYCLES_PER_LINE);
+
+                // Nothing can wake us if interrupts are masked or the timer interrupts are disabled
+                if ( (cc.i) || !(Memory[0x08] & (TCSR_ETOI | TCSR_EOCI)) )
                 {
-                    if (++cpu.counter == cpu.compare)
-                    {
-                        Memory[0x08] |= TCSR_OCF;
-                    }
-                    if (cpu.counter & 0xFFFF0000) // Overflow
-                    {
-                        cpu.counter &= 0xFFFF;
-                        Memory[0x08] |= TCSR_TOF;
-                    }
+                    return;
                 }
 
                 if ( !(cc.i) && (Memory[0x08] & TCSR_TOF) && (Memory[0x08] & TCSR_ETOI) )
@@ -247,6 +631,7 @@ ITCM_CODE void cpu_run(void)
                 {
                     return;
                 }
+                cpu_timer_schedule();
             }
 
             if (cpu.cpu_state == CPU_EXCEPTION)
@@ -263,7 +648,8 @@ ITCM_CODE void cpu_run(void)
             if ( (Memory[0x08] & TCSR_TOF) && (Memory[0x08] & TCSR_ETOI) )
             {
                 cpu.cpu_state = CPU_EXEC;
-                cycles_this_scanline += 12;
+                cpu_line_cycles += 12;
+                cpu_timer_origin += 12;     // The timer does not see these cycles
 
                 mem_write(cpu.sp, (cpu.pc >> 0) & 0xff);
                 cpu.sp--;
@@ -287,7 +673,8 @@ ITCM_CODE void cpu_run(void)
             if ( (Memory[0x08] & TCSR_OCF) && (Memory[0x08] & TCSR_EOCI) )
             {
                 cpu.cpu_state = CPU_EXEC;
-                cycles_this_scanline += 12;
+                cpu_line_cycles += 12;
+                cpu_timer_origin += 12;     // The timer does not see these cycles
 
                 mem_write(cpu.sp, (cpu.pc >> 0) & 0xff);
                 cpu.sp--;
@@ -309,549 +696,583 @@ ITCM_CODE void cpu_run(void)
             }
         }
 
-        // Fetch the OP Code directly from memory
-        op_code = mem_read_pc(cpu.pc++);
+#ifdef CPU_TRACE
+        cpu_timer_sync();
+        cpu_trace(get_cc());
+#endif
 
-        // Process the Op-Code...
+        // Running from ROM? Use (or make) the predecoded instruction
+        cpu_decoded_t *decoded = cpu_decoded_page[cpu.pc >> 8];
+        if (decoded)
         {
-            /* 'operand8' will be operand byte, and for a 16-bit operand 'operand8'
-             * will be the high order byte and low order byte should be read separately
-             * and combined into 16-bit value.
-             */
-            cycles_this_scanline += machine_code[op_code].cycles;
+            decoded += (cpu.pc & 0xff);
+            if (!decoded->length) cpu_decode_run(cpu.pc);
+            if (!decoded->cycles) decoded = NULL;
+        }
 
-            // --------------------------------------------------------------
-            // Counters and clocks... this is where we handle the CPU timer
-            // module with the free-running timer counter and a compare reg.
-            // --------------------------------------------------------------
-            if (cpu.counter < cpu.compare)
+        // Process the Op-Code...
+        {
+            if (decoded)
             {
-                if ((cpu.counter + machine_code[op_code].cycles) >= cpu.compare)
-                {
-                    Memory[0x08] |= TCSR_OCF;
-                }
+                op_code = decoded->op_code;
+                cpu.pc += decoded->length;
+                eff_addr = decoded->operand;
+                cpu_line_cycles += decoded->cycles;
+
+#ifdef CPU_THREADED_DISPATCH
+                goto *decoded_dispatch[op_code];
+#else
+                if (decoded->indexed) eff_addr = (uint16_t)(cpu.x + eff_addr);
+#endif
             }
-            cpu.counter += machine_code[op_code].cycles;
-            if (cpu.counter & 0xFFFF0000) // Overflow
+            else
             {
-                cpu.counter &= 0xFFFF;
-                Memory[0x08] |= TCSR_TOF;
-            }
+                // A ROM routine with a native version (see hle.c)? Run it and return to the caller
+                if (hle_trap_page[cpu.pc >> 8])
+                {
+                    uint8_t flags = get_cc();
+                    int cycles = hle_trap(cpu.pc, &flags);
+                    if (cycles)
+                    {
+                        set_cc(flags);
+                        cpu.sp++;
+                        cpu.pc = (uint16_t) mem_read(cpu.sp) << 8;
+                        cpu.sp++;
+                        cpu.pc += mem_read(cpu.sp);
+                        cpu_line_cycles += cycles;
+                        goto hle_done;
+                    }
+                }
 
-            eff_addr = get_eff_addr(machine_code[op_code].mode);
+                // Fetch the OP Code directly from memory
+                op_code = mem_read_pc(cpu.pc++);
+
+                /* 'operand8' will be operand byte, and for a 16-bit operand 'operand8'
+                 * will be the high order byte and low order byte should be read separately
+                 * and combined into 16-bit value.
+                 */
+                op_cycles = machine_code[op_code].cycles;
+                cpu_line_cycles += op_cycles;
+
+#ifdef CPU_THREADED_DISPATCH
+                goto *opcode_dispatch[op_code];
+#else
+                eff_addr = get_eff_addr(machine_code[op_code].mode);
+#endif
+            }
 
             switch ( op_code )
             {
                 // ABA
-                case 0x1B:
+                OPCODE(0x1b, INHERENT)
                     cpu.ab.ab.a = add(cpu.ab.ab.a, cpu.ab.ab.b);
                     break;
 
                 // ABX
-                case 0x3a:
+                OPCODE(0x3a, INHERENT)
                     cpu.x += cpu.ab.ab.b;
                     break;
 
                 // ADCA
-                case 0x89:
-                case 0x99:
-                case 0xa9:
-                case 0xb9:
+                OPCODE(0x89, IMMEDIATE)
+                OPCODE(0x99, DIRECT)
+                OPCODE(0xa9, INDEXED)
+                OPCODE(0xb9, EXTENDED)
                     operand8 = (uint8_t) mem_read(eff_addr);
                     cpu.ab.ab.a = adc(cpu.ab.ab.a, operand8);
                     break;
 
                 // ADCB
-                case 0xc9:
-                case 0xd9:
-                case 0xe9:
-                case 0xf9:
+                OPCODE(0xc9, IMMEDIATE)
+                OPCODE(0xd9, DIRECT)
+                OPCODE(0xe9, INDEXED)
+                OPCODE(0xf9, EXTENDED)
                     operand8 = (uint8_t) mem_read(eff_addr);
                     cpu.ab.ab.b = adc(cpu.ab.ab.b, operand8);
                     break;
 
                 // ADDA
-                case 0x8b:
-                case 0x9b:
-                case 0xab:
-                case 0xbb:
+                OPCODE(0x8b, IMMEDIATE)
+                OPCODE(0x9b, DIRECT)
+                OPCODE(0xab, INDEXED)
+                OPCODE(0xbb, EXTENDED)
                     operand8 = (uint8_t) mem_read(eff_addr);
                     cpu.ab.ab.a = add(cpu.ab.ab.a, operand8);
                     break;
 
                 // ADDB
-                case 0xcb:
-                case 0xdb:
-                case 0xeb:
-                case 0xfb:
+                OPCODE(0xcb, IMMEDIATE)
+                OPCODE(0xdb, DIRECT)
+                OPCODE(0xeb, INDEXED)
+                OPCODE(0xfb, EXTENDED)
                     operand8 = (uint8_t) mem_read(eff_addr);
                     cpu.ab.ab.b = add(cpu.ab.ab.b, operand8);
                     break;
 
                 // ADDD
-                case 0xc3:
-                case 0xd3:
-                case 0xe3:
-                case 0xf3:
+                OPCODE(0xc3, LIMMEDIATE)
+                OPCODE(0xd3, DIRECT)
+                OPCODE(0xe3, INDEXED)
+                OPCODE(0xf3, EXTENDED)
                     operand8 = (uint8_t) mem_read(eff_addr++);
                     operand16 = ((uint16_t) operand8 << 8) + (uint16_t) mem_read(eff_addr);
                     addd(operand16);
                     break;
 
                 // ANDA
-                case 0x84:
-                case 0x94:
-                case 0xa4:
-                case 0xb4:
+                OPCODE(0x84, IMMEDIATE)
+                OPCODE(0x94, DIRECT)
+                OPCODE(0xa4, INDEXED)
+                OPCODE(0xb4, EXTENDED)
                     operand8 = (uint8_t) mem_read(eff_addr);
                     cpu.ab.ab.a = and(cpu.ab.ab.a, operand8);
                     break;
 
                 // ADDB
-                case 0xc4:
-                case 0xd4:
-                case 0xe4:
-                case 0xf4:
+                OPCODE(0xc4, IMMEDIATE)
+                OPCODE(0xd4, DIRECT)
+                OPCODE(0xe4, INDEXED)
+                OPCODE(0xf4, EXTENDED)
                     operand8 = (uint8_t) mem_read(eff_addr);
                     cpu.ab.ab.b = and(cpu.ab.ab.b, operand8);
                     break;
 
                 // BITA
-                case 0x85:
-                case 0x95:
-                case 0xa5:
-                case 0xb5:
+                OPCODE(0x85, IMMEDIATE)
+                OPCODE(0x95, DIRECT)
+                OPCODE(0xa5, INDEXED)
+                OPCODE(0xb5, EXTENDED)
                     operand8 = (uint8_t) mem_read(eff_addr);
                     bit(cpu.ab.ab.a, operand8);
                     break;
 
                 // BITB
-                case 0xc5:
-                case 0xd5:
-                case 0xe5:
-                case 0xf5:
+                OPCODE(0xc5, IMMEDIATE)
+                OPCODE(0xd5, DIRECT)
+                OPCODE(0xe5, INDEXED)
+                OPCODE(0xf5, EXTENDED)
                     operand8 = (uint8_t) mem_read(eff_addr);
                     bit(cpu.ab.ab.b, operand8);
                     break;
 
                 // CBA
-                case 0x11:
+                OPCODE(0x11, INHERENT)
                     cmp(cpu.ab.ab.a, cpu.ab.ab.b);
                     break;
 
                 // CLR
-                case 0x6f:
-                case 0x7f:
+                OPCODE(0x6f, INDEXED)
+                OPCODE(0x7f, EXTENDED)
                     operand8 = clr();
                     mem_write(eff_addr, operand8);
                     break;
 
                 // CLRA
-                case 0x4f:
+                OPCODE(0x4f, INHERENT)
                     cpu.ab.ab.a = clr();
                     break;
 
                 // CLRB
-                case 0x5f:
+                OPCODE(0x5f, INHERENT)
                     cpu.ab.ab.b = clr();
                     break;
 
                 // CMPA
-                case 0x81:
-                case 0x91:
-                case 0xa1:
-                case 0xb1:
+                OPCODE(0x81, IMMEDIATE)
+                OPCODE(0x91, DIRECT)
+                OPCODE(0xa1, INDEXED)
+                OPCODE(0xb1, EXTENDED)
                     operand8 = (uint8_t) mem_read(eff_addr);
                     cmp(cpu.ab.ab.a, operand8);
                     break;
 
                 // CMPB
-                case 0xc1:
-                case 0xd1:
-                case 0xe1:
-                case 0xf1:
+                OPCODE(0xc1, IMMEDIATE)
+                OPCODE(0xd1, DIRECT)
+                OPCODE(0xe1, INDEXED)
+                OPCODE(0xf1, EXTENDED)
                     operand8 = (uint8_t) mem_read(eff_addr);
                     cmp(cpu.ab.ab.b, operand8);
                     break;
 
                 // CMPX
-                case 0x8c:
-                case 0x9c:
-                case 0xac:
-                case 0xbc:
+                OPCODE(0x8c, LIMMEDIATE)
+                OPCODE(0x9c, DIRECT)
+                OPCODE(0xac, INDEXED)
+                OPCODE(0xbc, EXTENDED)
                     operand8 = (uint8_t) mem_read(eff_addr++);
                     operand16 = ((uint16_t) operand8 << 8) + (uint16_t) mem_read(eff_addr);
                     cmp16(cpu.x, operand16);
                     break;
 
                 // COM
-                case 0x63:
-                case 0x73:
+                OPCODE(0x63, INDEXED)
+                OPCODE(0x73, EXTENDED)
                     operand8 = (uint8_t) mem_read(eff_addr);
                     operand8 = com(operand8);
                     mem_write(eff_addr, operand8);
                     break;
 
                 // COMA
-                case 0x43:
+                OPCODE(0x43, INHERENT)
                     cpu.ab.ab.a = com(cpu.ab.ab.a);
                     break;
 
                 // COMB
-                case 0x53:
+                OPCODE(0x53, INHERENT)
                     cpu.ab.ab.b = com(cpu.ab.ab.b);
                     break;
 
                 // DAA
-                case 0x19:
+                OPCODE(0x19, INHERENT)
                     daa();
                     break;
 
                 // DEC
-                case 0x6a:
-                case 0x7a:
+                OPCODE(0x6a, INDEXED)
+                OPCODE(0x7a, EXTENDED)
                     operand8 = (uint8_t) mem_read(eff_addr);
                     operand8 = dec(operand8);
                     mem_write(eff_addr, operand8);
                     break;
 
                 // DECA
-                case 0x4a:
+                OPCODE(0x4a, INHERENT)
                     cpu.ab.ab.a = dec(cpu.ab.ab.a);
                     break;
 
                 // DECB
-                case 0x5a:
+                OPCODE(0x5a, INHERENT)
                     cpu.ab.ab.b = dec(cpu.ab.ab.b);
                     break;
 
                 // EORA
-                case 0x88:
-                case 0x98:
-                case 0xa8:
-                case 0xb8:
+                OPCODE(0x88, IMMEDIATE)
+                OPCODE(0x98, DIRECT)
+                OPCODE(0xa8, INDEXED)
+                OPCODE(0xb8, EXTENDED)
                     operand8 = (uint8_t) mem_read(eff_addr);
                     cpu.ab.ab.a = eor(cpu.ab.ab.a, operand8);
                     break;
 
                 // EORB
-                case 0xc8:
-                case 0xd8:
-                case 0xe8:
-                case 0xf8:
+                OPCODE(0xc8, IMMEDIATE)
+                OPCODE(0xd8, DIRECT)
+                OPCODE(0xe8, INDEXED)
+                OPCODE(0xf8, EXTENDED)
                     operand8 = (uint8_t) mem_read(eff_addr);
                     cpu.ab.ab.b = eor(cpu.ab.ab.b, operand8);
                     break;
 
                 // INC
-                case 0x6c:
-                case 0x7c:
+                OPCODE(0x6c, INDEXED)
+                OPCODE(0x7c, EXTENDED)
                     operand8 = (uint8_t) mem_read(eff_addr);
                     operand8 = inc(operand8);
                     mem_write(eff_addr, operand8);
                     break;
 
                 // INCA
-                case 0x4c:
+                OPCODE(0x4c, INHERENT)
                     cpu.ab.ab.a = inc(cpu.ab.ab.a);
                     break;
 
                 // INCB
-                case 0x5c:
+                OPCODE(0x5c, INHERENT)
                     cpu.ab.ab.b = inc(cpu.ab.ab.b);
                     break;
 
                 // LDA
-                case 0x86:
-                case 0x96:
-                case 0xa6:
-                case 0xb6:
+                OPCODE(0x86, IMMEDIATE)
+                OPCODE(0x96, DIRECT)
+                OPCODE(0xa6, INDEXED)
+                OPCODE(0xb6, EXTENDED)
                     cpu.ab.ab.a = (uint8_t) mem_read(eff_addr);
                     eval_cc_z((uint16_t) cpu.ab.ab.a);
                     eval_cc_n((uint16_t) cpu.ab.ab.a);
-                    cc.v = CC_FLAG_CLR;
+                    SET_CC_V(CC_FLAG_CLR);
                     break;
 
                 // LDB
-                case 0xc6:
-                case 0xd6:
-                case 0xe6:
-                case 0xf6:
+                OPCODE(0xc6, IMMEDIATE)
+                OPCODE(0xd6, DIRECT)
+                OPCODE(0xe6, INDEXED)
+                OPCODE(0xf6, EXTENDED)
                     cpu.ab.ab.b = (uint8_t) mem_read(eff_addr);
                     eval_cc_z((uint16_t) cpu.ab.ab.b);
                     eval_cc_n((uint16_t) cpu.ab.ab.b);
-                    cc.v = CC_FLAG_CLR;
+                    SET_CC_V(CC_FLAG_CLR);
                     break;
 
                 // LDD/LDAD
-                case 0xcc:
-                case 0xdc:
-                case 0xec:
-                case 0xfc:
+                OPCODE(0xcc, LIMMEDIATE)
+                OPCODE(0xdc, DIRECT)
+                OPCODE(0xec, INDEXED)
+                OPCODE(0xfc, EXTENDED)
                     cpu.ab.ab.a = (uint8_t) mem_read(eff_addr++);
                     cpu.ab.ab.b = (uint8_t) mem_read(eff_addr);
                     eval_cc_z16(cpu.ab.d);
                     eval_cc_n16(cpu.ab.d);
-                    cc.v = CC_FLAG_CLR;
+                    SET_CC_V(CC_FLAG_CLR);
                     break;
 
                 // LSL
-                case 0x78:
+                OPCODE(0x78, EXTENDED)
                     operand8 = (uint8_t) mem_read(eff_addr);
                     operand8 = lsl(operand8);
                     mem_write(eff_addr, operand8);
                     break;
 
                 // LSLA
-                case 0x48:
+                OPCODE(0x48, INHERENT)
                     cpu.ab.ab.a = lsl(cpu.ab.ab.a);
                     break;
 
                 // LSLB
-                case 0x58:
+                OPCODE(0x58, INHERENT)
                     cpu.ab.ab.b = lsl(cpu.ab.ab.b);
                     break;
 
                 // ASL
-                case 0x68:
+                OPCODE(0x68, INDEXED)
                     operand8 = (uint8_t) mem_read(eff_addr);
                     operand8 = asl(operand8);
                     mem_write(eff_addr, operand8);
                     break;
 
                 // ASR
-                case 0x67:
-                case 0x77:
+                OPCODE(0x67, INDEXED)
+                OPCODE(0x77, EXTENDED)
                     operand8 = (uint8_t) mem_read(eff_addr);
                     operand8 = asr(operand8);
                     mem_write(eff_addr, operand8);
                     break;
 
                 // ASRA
-                case 0x47:
+                OPCODE(0x47, INHERENT)
                     cpu.ab.ab.a = asr(cpu.ab.ab.a);
                     break;
 
                 // ASRB
-                case 0x57:
+                OPCODE(0x57, INHERENT)
                     cpu.ab.ab.b = asr(cpu.ab.ab.b);
                     break;
 
                 // LSLD/ASLD
-                case 0x05:
+                OPCODE(0x05, INHERENT)
                     cpu.ab.d = lsl16(cpu.ab.d);
                     break;
 
                 // LSR
-                case 0x64:
-                case 0x74:
+                OPCODE(0x64, INDEXED)
+                OPCODE(0x74, EXTENDED)
                     operand8 = (uint8_t) mem_read(eff_addr);
                     operand8 = lsr(operand8);
                     mem_write(eff_addr, operand8);
                     break;
 
                 // LSRA
-                case 0x44:
-                case 0x45:
+                OPCODE(0x44, INHERENT)
+                OPCODE(0x45, INHERENT)
                     cpu.ab.ab.a = lsr(cpu.ab.ab.a);
                     break;
 
                 // LSRB
-                case 0x54:
-                case 0x55:
+                OPCODE(0x54, INHERENT)
+                OPCODE(0x55, INHERENT)
                     cpu.ab.ab.b = lsr(cpu.ab.ab.b);
                     break;
 
                 // LSRD
-                case 0x04:
+                OPCODE(0x04, INHERENT)
                     cpu.ab.d = lsr16(cpu.ab.d);
                     break;
 
                 // MUL
-                case 0x3d:
+                OPCODE(0x3d, INHERENT)
                     operand16 = cpu.ab.ab.a * cpu.ab.ab.b;
                     cpu.ab.ab.a = GET_REG_HIGH(operand16);
                     cpu.ab.ab.b = GET_REG_LOW(operand16);
-                    cc.c = (cpu.ab.ab.b & 0x80) ? CC_FLAG_SET : CC_FLAG_CLR;
+                    SET_CC_C((cpu.ab.ab.b & 0x80) ? CC_FLAG_SET : CC_FLAG_CLR);
                     break;
 
                 // NEG
-                case 0x60:
-                case 0x70:
+                OPCODE(0x60, INDEXED)
+                OPCODE(0x70, EXTENDED)
                     operand8 = (uint8_t) mem_read(eff_addr);
                     operand8 = neg(operand8);
                     mem_write(eff_addr, operand8);
                     break;
 
                 // NEGA
-                case 0x40:
+                OPCODE(0x40, INHERENT)
                     cpu.ab.ab.a = neg(cpu.ab.ab.a);
                     break;
 
                 // NEGB
-                case 0x50:
+                OPCODE(0x50, INHERENT)
                     cpu.ab.ab.b = neg(cpu.ab.ab.b);
                     break;
 
                 // NOP
-                case 0x01:
+                OPCODE(0x01, INHERENT)
                     break;
 
                 // ORA
-                case 0x8a:
-                case 0x9a:
-                case 0xaa:
-                case 0xba:
+                OPCODE(0x8a, IMMEDIATE)
+                OPCODE(0x9a, DIRECT)
+                OPCODE(0xaa, INDEXED)
+                OPCODE(0xba, EXTENDED)
                     operand8 = (uint8_t) mem_read(eff_addr);
                     cpu.ab.ab.a = or(cpu.ab.ab.a, operand8);
                     break;
 
                 // ORB
-                case 0xca:
-                case 0xda:
-                case 0xea:
-                case 0xfa:
+                OPCODE(0xca, IMMEDIATE)
+                OPCODE(0xda, DIRECT)
+                OPCODE(0xea, INDEXED)
+                OPCODE(0xfa, EXTENDED)
                     operand8 = (uint8_t) mem_read(eff_addr);
                     cpu.ab.ab.b = or(cpu.ab.ab.b, operand8);
                     break;
 
                 // PSHA
-                case 0x36:
+                OPCODE(0x36, INHERENT)
                     mem_write(cpu.sp, cpu.ab.ab.a);
                     cpu.sp--;
                     break;
 
                 // PULA
-                case 0x32:
+                OPCODE(0x32, INHERENT)
                     cpu.sp++;
                     cpu.ab.ab.a = mem_read(cpu.sp);
                     break;
 
                 // PSHB
-                case 0x37:
+                OPCODE(0x37, INHERENT)
                     mem_write(cpu.sp, cpu.ab.ab.b);
                     cpu.sp--;
                     break;
 
                 // PULB
-                case 0x33:
+                OPCODE(0x33, INHERENT)
                     cpu.sp++;
                     cpu.ab.ab.b = mem_read(cpu.sp);
                     break;
 
                 // ROL
-                case 0x69:
-                case 0x79:
+                OPCODE(0x69, INDEXED)
+                OPCODE(0x79, EXTENDED)
                     operand8 = (uint8_t) mem_read(eff_addr);
                     operand8 = rol(operand8);
                     mem_write(eff_addr, operand8);
                     break;
 
                 // ROLA
-                case 0x49:
+                OPCODE(0x49, INHERENT)
                     cpu.ab.ab.a = rol(cpu.ab.ab.a);
                     break;
 
                 // ROLB
-                case 0x59:
+                OPCODE(0x59, INHERENT)
                     cpu.ab.ab.b = rol(cpu.ab.ab.b);
                     break;
 
                 // ROR
-                case 0x66:
-                case 0x76:
+                OPCODE(0x66, INDEXED)
+                OPCODE(0x76, EXTENDED)
                     operand8 = (uint8_t) mem_read(eff_addr);
                     operand8 = ror(operand8);
                     mem_write(eff_addr, operand8);
                     break;
 
                 // RORA
-                case 0x46:
+                OPCODE(0x46, INHERENT)
                     cpu.ab.ab.a = ror(cpu.ab.ab.a);
                     break;
 
                 // RORB
-                case 0x56:
+                OPCODE(0x56, INHERENT)
                     cpu.ab.ab.b = ror(cpu.ab.ab.b);
                     break;
 
                 // SBA
-                case 0x10:
+                OPCODE(0x10, INHERENT)
                     cpu.ab.ab.a = sub(cpu.ab.ab.a, cpu.ab.ab.b);
                     break;
 
                 // SBCA
-                case 0x82:
-                case 0x92:
-                case 0xa2:
-                case 0xb2:
+                OPCODE(0x82, IMMEDIATE)
+                OPCODE(0x92, DIRECT)
+                OPCODE(0xa2, INDEXED)
+                OPCODE(0xb2, EXTENDED)
                     operand8 = (uint8_t) mem_read(eff_addr);
                     cpu.ab.ab.a = sbc(cpu.ab.ab.a, operand8);
                     break;
 
                 // SBCB
-                case 0xc2:
-                case 0xd2:
-                case 0xe2:
-                case 0xf2:
+                OPCODE(0xc2, IMMEDIATE)
+                OPCODE(0xd2, DIRECT)
+                OPCODE(0xe2, INDEXED)
+                OPCODE(0xf2, EXTENDED)
                     operand8 = (uint8_t) mem_read(eff_addr);
                     cpu.ab.ab.b = sbc(cpu.ab.ab.b, operand8);
                     break;
 
                 // STA
-                case 0x97:
-                case 0xa7:
-                case 0xb7:
+                OPCODE(0x97, DIRECT)
+                OPCODE(0xa7, INDEXED)
+                OPCODE(0xb7, EXTENDED)
                     mem_write(eff_addr, cpu.ab.ab.a);
                     eval_cc_z((uint16_t) cpu.ab.ab.a);
                     eval_cc_n((uint16_t) cpu.ab.ab.a);
-                    cc.v = CC_FLAG_CLR;
+                    SET_CC_V(CC_FLAG_CLR);
                     break;
 
                 // STB
-                case 0xd7:
-                case 0xe7:
-                case 0xf7:
+                OPCODE(0xd7, DIRECT)
+                OPCODE(0xe7, INDEXED)
+                OPCODE(0xf7, EXTENDED)
                     mem_write(eff_addr, cpu.ab.ab.b);
                     eval_cc_z((uint16_t) cpu.ab.ab.b);
                     eval_cc_n((uint16_t) cpu.ab.ab.b);
-                    cc.v = CC_FLAG_CLR;
+                    SET_CC_V(CC_FLAG_CLR);
                     break;
 
                 // STD/STAD
-                case 0xdd:
-                case 0xed:
-                case 0xfd:
+                OPCODE(0xdd, DIRECT)
+                OPCODE(0xed, INDEXED)
+                OPCODE(0xfd, EXTENDED)
                     mem_write(eff_addr, cpu.ab.ab.a);
                     mem_write(eff_addr + 1, cpu.ab.ab.b);
                     eval_cc_z16(cpu.ab.d);
                     eval_cc_n16(cpu.ab.d);
-                    cc.v = CC_FLAG_CLR;
+                    SET_CC_V(CC_FLAG_CLR);
                     break;
 
                 // SUBA
-                case 0x80:
-                case 0x90:
-                case 0xa0:
-                case 0xb0:
+                OPCODE(0x80, IMMEDIATE)
+                OPCODE(0x90, DIRECT)
+                OPCODE(0xa0, INDEXED)
+                OPCODE(0xb0, EXTENDED)
                     operand8 = (uint8_t) mem_read(eff_addr);
                     cpu.ab.ab.a = sub(cpu.ab.ab.a, operand8);
                     break;
 
                 // SUBB
-                case 0xc0:
-                case 0xd0:
-                case 0xe0:
-                case 0xf0:
+                OPCODE(0xc0, IMMEDIATE)
+                OPCODE(0xd0, DIRECT)
+                OPCODE(0xe0, INDEXED)
+                OPCODE(0xf0, EXTENDED)
                     operand8 = (uint8_t) mem_read(eff_addr);
                     cpu.ab.ab.b = sub(cpu.ab.ab.b, operand8);
                     break;
 
                 // SUBD
-                case 0x83:
-                case 0x93:
-                case 0xa3:
-                case 0xb3:
+                OPCODE(0x83, LIMMEDIATE)
+                OPCODE(0x93, DIRECT)
+                OPCODE(0xa3, INDEXED)
+                OPCODE(0xb3, EXTENDED)
                     operand8 = (uint8_t) mem_read(eff_addr);
                     eff_addr++;
                     operand16 = ((uint16_t ) operand8 << 8) + (uint16_t) mem_read(eff_addr);
@@ -859,121 +1280,121 @@ ITCM_CODE void cpu_run(void)
                     break;
 
                 // TAB
-                case 0x16:
-                case 0x1e:
+                OPCODE(0x16, INHERENT)
+                OPCODE(0x1e, INHERENT)
                     cpu.ab.ab.b = cpu.ab.ab.a;
                     eval_cc_z((uint16_t) cpu.ab.ab.b);
                     eval_cc_n((uint16_t) cpu.ab.ab.b);
-                    cc.v = CC_FLAG_CLR;
+                    SET_CC_V(CC_FLAG_CLR);
                     break;
 
                 // TBA
-                case 0x17:
+                OPCODE(0x17, INHERENT)
                     cpu.ab.ab.a = cpu.ab.ab.b;
                     eval_cc_z((uint16_t) cpu.ab.ab.a);
                     eval_cc_n((uint16_t) cpu.ab.ab.a);
-                    cc.v = CC_FLAG_CLR;
+                    SET_CC_V(CC_FLAG_CLR);
                     break;
 
                 // TST
-                case 0x6d:
-                case 0x7d:
+                OPCODE(0x6d, INDEXED)
+                OPCODE(0x7d, EXTENDED)
                     operand8 = (uint8_t) mem_read(eff_addr);
                     tst(operand8);
                     break;
 
                 // TSTA
-                case 0x4d:
+                OPCODE(0x4d, INHERENT)
                     tst(cpu.ab.ab.a);
                     break;
 
                 // TSTB
-                case 0x5d:
+                OPCODE(0x5d, INHERENT)
                     tst(cpu.ab.ab.b);
                     break;
 
                 // BRA
-                case 0x20:
+                OPCODE(0x20, RELATIVE)
                     cpu.pc = eff_addr;
                     break;
 
                 // BRN
-                case 0x21:
+                OPCODE(0x21, RELATIVE)
                     // Branch never
                     break;
 
                 // BCC
-                case 0x24:
-                    if ( cc.c == CC_FLAG_CLR ) cpu.pc = eff_addr;
+                OPCODE(0x24, RELATIVE)
+                    if ( CC_C == CC_FLAG_CLR ) cpu.pc = eff_addr;
                     break;
 
                 // BCS
-                case 0x25:
-                    if ( cc.c == CC_FLAG_SET ) cpu.pc = eff_addr;
+                OPCODE(0x25, RELATIVE)
+                    if ( CC_C == CC_FLAG_SET ) cpu.pc = eff_addr;
                     break;
 
                 // BEQ
-                case 0x27:
-                    if ( cc.z == CC_FLAG_SET ) cpu.pc = eff_addr;
+                OPCODE(0x27, RELATIVE)
+                    if ( CC_Z == CC_FLAG_SET ) cpu.pc = eff_addr;
                     break;
 
                 // BNE
-                case 0x26:
-                    if ( cc.z == CC_FLAG_CLR ) cpu.pc = eff_addr;
+                OPCODE(0x26, RELATIVE)
+                    if ( CC_Z == CC_FLAG_CLR ) cpu.pc = eff_addr;
                     break;
 
                 // BGE
-                case 0x2c:
-                    if ( cc.n == cc.v ) cpu.pc = eff_addr;
+                OPCODE(0x2c, RELATIVE)
+                    if ( CC_N == CC_V ) cpu.pc = eff_addr;
                     break;
 
                 // BLT
-                case 0x2d:
-                    if ( cc.n != cc.v ) cpu.pc = eff_addr;
+                OPCODE(0x2d, RELATIVE)
+                    if ( CC_N != CC_V ) cpu.pc = eff_addr;
                     break;
 
                 // BGT
-                case 0x2e:
-                    if ( cc.n == cc.v && cc.z == CC_FLAG_CLR ) cpu.pc = eff_addr;
+                OPCODE(0x2e, RELATIVE)
+                    if ( CC_N == CC_V && CC_Z == CC_FLAG_CLR ) cpu.pc = eff_addr;
                     break;
 
                 // BHI
-                case 0x22:
-                    if ( cc.c == CC_FLAG_CLR && cc.z == CC_FLAG_CLR ) cpu.pc = eff_addr;
+                OPCODE(0x22, RELATIVE)
+                    if ( CC_C == CC_FLAG_CLR && CC_Z == CC_FLAG_CLR ) cpu.pc = eff_addr;
                     break;
 
                 // BLE
-                case 0x2f:
-                    if ( cc.n != cc.v || cc.z == CC_FLAG_SET ) cpu.pc = eff_addr;
+                OPCODE(0x2f, RELATIVE)
+                    if ( CC_N != CC_V || CC_Z == CC_FLAG_SET ) cpu.pc = eff_addr;
                     break;
 
                 // BLS
-                case 0x23:
-                    if ( cc.c == CC_FLAG_SET || cc.z == CC_FLAG_SET ) cpu.pc = eff_addr;
+                OPCODE(0x23, RELATIVE)
+                    if ( CC_C == CC_FLAG_SET || CC_Z == CC_FLAG_SET ) cpu.pc = eff_addr;
                     break;
 
                 // BMI
-                case 0x2b:
-                    if ( cc.n == CC_FLAG_SET ) cpu.pc = eff_addr;
+                OPCODE(0x2b, RELATIVE)
+                    if ( CC_N == CC_FLAG_SET ) cpu.pc = eff_addr;
                     break;
 
                 // BPL
-                case 0x2a:
-                    if ( cc.n == CC_FLAG_CLR ) cpu.pc = eff_addr;
+                OPCODE(0x2a, RELATIVE)
+                    if ( CC_N == CC_FLAG_CLR ) cpu.pc = eff_addr;
                     break;
 
                 // BVS
-                case 0x29:
-                    if ( cc.v == CC_FLAG_SET ) cpu.pc = eff_addr;
+                OPCODE(0x29, RELATIVE)
+                    if ( CC_V == CC_FLAG_SET ) cpu.pc = eff_addr;
                     break;
 
                 // BVC
-                case 0x28:
-                    if ( cc.v == CC_FLAG_CLR ) cpu.pc = eff_addr;
+                OPCODE(0x28, RELATIVE)
+                    if ( CC_V == CC_FLAG_CLR ) cpu.pc = eff_addr;
                     break;
 
                 // BSR
-                case 0x8d:
+                OPCODE(0x8d, RELATIVE)
                     mem_write(cpu.sp, GET_REG_LOW(cpu.pc));
                     cpu.sp--;
                     mem_write(cpu.sp, GET_REG_HIGH(cpu.pc));
@@ -982,15 +1403,15 @@ ITCM_CODE void cpu_run(void)
                     break;
 
                 // JMP
-                case 0x6e:
-                case 0x7e:
+                OPCODE(0x6e, INDEXED)
+                OPCODE(0x7e, EXTENDED)
                     cpu.pc = eff_addr;
                     break;
 
                 // JSR
-                case 0x9d:
-                case 0xad:
-                case 0xbd:
+                OPCODE(0x9d, DIRECT)
+                OPCODE(0xad, INDEXED)
+                OPCODE(0xbd, EXTENDED)
                     mem_write(cpu.sp, GET_REG_LOW(cpu.pc));
                     cpu.sp--;
                     mem_write(cpu.sp, GET_REG_HIGH(cpu.pc));
@@ -999,12 +1420,12 @@ ITCM_CODE void cpu_run(void)
                     break;
 
                 // RTI
-                case 0x3b:
+                OPCODE(0x3b, INHERENT)
                     rti();
                     break;
 
                 // RTS
-                case 0x39:
+                OPCODE(0x39, INHERENT)
                      /* Restore PC and return
                       */
                      cpu.sp++;
@@ -1014,42 +1435,42 @@ ITCM_CODE void cpu_run(void)
                      break;
 
                 // DEX
-                case 0x09:
+                OPCODE(0x09, INHERENT)
                     cpu.x--;
                     eval_cc_z16(cpu.x);
                     break;
 
                 // INX
-                case 0x08:
+                OPCODE(0x08, INHERENT)
                     cpu.x++;
                     eval_cc_z16(cpu.x);
                     break;
 
                 // LDX
-                case 0xce:
-                case 0xde:
-                case 0xee:
-                case 0xfe:
+                OPCODE(0xce, LIMMEDIATE)
+                OPCODE(0xde, DIRECT)
+                OPCODE(0xee, INDEXED)
+                OPCODE(0xfe, EXTENDED)
                     cpu.x = (uint16_t) mem_read(eff_addr) << 8;
                     cpu.x += mem_read(eff_addr+1);
                     eval_cc_z16(cpu.x);
                     eval_cc_n16(cpu.x);
-                    cc.v = CC_FLAG_CLR;
+                    SET_CC_V(CC_FLAG_CLR);
                     break;
 
                 // STX
-                case 0xdf:
-                case 0xef:
-                case 0xff:
+                OPCODE(0xdf, DIRECT)
+                OPCODE(0xef, INDEXED)
+                OPCODE(0xff, EXTENDED)
                     mem_write(eff_addr, (uint8_t) (cpu.x >> 8));
                     mem_write(eff_addr + 1, (uint8_t) (cpu.x));
                     eval_cc_z16(cpu.x);
                     eval_cc_n16(cpu.x);
-                    cc.v = CC_FLAG_CLR;
+                    SET_CC_V(CC_FLAG_CLR);
                     break;
 
                 // PSHX
-                case 0x3c:
+                OPCODE(0x3c, INHERENT)
                     mem_write(cpu.sp, (uint8_t) (cpu.x));
                     cpu.sp--;
                     mem_write(cpu.sp, (uint8_t) (cpu.x >> 8));
@@ -1057,7 +1478,7 @@ ITCM_CODE void cpu_run(void)
                     break;
 
                 // PULX
-                case 0x38:
+                OPCODE(0x38, INHERENT)
                     cpu.sp++;
                     cpu.x = (uint16_t)mem_read(cpu.sp) << 8;
                     cpu.sp++;
@@ -1065,95 +1486,95 @@ ITCM_CODE void cpu_run(void)
                     break;
 
                 // TXS
-                case 0x35:
+                OPCODE(0x35, INHERENT)
                     cpu.sp = cpu.x - 1;
                     break;
 
                 // TSX
-                case 0x30:
+                OPCODE(0x30, INHERENT)
                     cpu.x = cpu.sp + 1;
                     break;
 
                 // DES
-                case 0x34:
+                OPCODE(0x34, INHERENT)
                     cpu.sp--;
                     break;
 
                 // INS
-                case 0x31:
+                OPCODE(0x31, INHERENT)
                     cpu.sp++;
                     break;
 
                 // LDS
-                case 0x8e:
-                case 0x9e:
-                case 0xae:
-                case 0xbe:
+                OPCODE(0x8e, LIMMEDIATE)
+                OPCODE(0x9e, DIRECT)
+                OPCODE(0xae, INDEXED)
+                OPCODE(0xbe, EXTENDED)
                     cpu.sp = (uint16_t) mem_read(eff_addr) << 8;
                     cpu.sp += mem_read(eff_addr + 1);
                     eval_cc_z16(cpu.sp);
                     eval_cc_n16(cpu.sp);
-                    cc.v = CC_FLAG_CLR;
+                    SET_CC_V(CC_FLAG_CLR);
                     break;
 
                 // STS
-                case 0x9f:
-                case 0xaf:
-                case 0xbf:
+                OPCODE(0x9f, DIRECT)
+                OPCODE(0xaf, INDEXED)
+                OPCODE(0xbf, EXTENDED)
                     mem_write(eff_addr, (uint8_t) (cpu.sp >> 8));
                     mem_write(eff_addr + 1, (uint8_t) (cpu.sp));
                     eval_cc_z16(cpu.sp);
                     eval_cc_n16(cpu.sp);
-                    cc.v = CC_FLAG_CLR;
+                    SET_CC_V(CC_FLAG_CLR);
                     break;
 
                 // CLC
-                case 0x0c:
-                    cc.c = CC_FLAG_CLR;
+                OPCODE(0x0c, INHERENT)
+                    SET_CC_C(CC_FLAG_CLR);
                     break;
 
                 // CLI
-                case 0x0e:
+                OPCODE(0x0e, INHERENT)
                     cc.i = CC_FLAG_CLR;
                     break;
 
                 // CLV
-                case 0x0a:
-                    cc.v = CC_FLAG_CLR;
+                OPCODE(0x0a, INHERENT)
+                    SET_CC_V(CC_FLAG_CLR);
                     break;
 
                 // SEC
-                case 0x0d:
-                    cc.c = CC_FLAG_SET;
+                OPCODE(0x0d, INHERENT)
+                    SET_CC_C(CC_FLAG_SET);
                     break;
 
                 // SEI
-                case 0x0f:
+                OPCODE(0x0f, INHERENT)
                     cc.i = CC_FLAG_SET;
                     break;
 
                 // SEV
-                case 0x0b:
-                    cc.v = CC_FLAG_SET;
+                OPCODE(0x0b, INHERENT)
+                    SET_CC_V(CC_FLAG_SET);
                     break;
 
                 // TAP
-                case 0x06:
+                OPCODE(0x06, INHERENT)
                     set_cc(cpu.ab.ab.a);
                     break;
 
                 // TPA
-                case 0x07:
+                OPCODE(0x07, INHERENT)
                     cpu.ab.ab.a = get_cc();
                     break;
 
                 // WAI
-                case 0x3e:
+                OPCODE(0x3e, INHERENT)
                     wai();
                     break;
 
                 // SWI
-                case 0x3f:
+                OPCODE(0x3f, INHERENT)
                     swi();
                     break;
 
@@ -1163,169 +1584,183 @@ ITCM_CODE void cpu_run(void)
                 // ==================================================================================
 
                 // Undocumented: CLB - Clear B
-                case 0x00:
+                OPCODE(0x00, INHERENT)
                     cpu.ab.ab.b = 0; // Flags not affected
                     break;
 
                 // Undocumented: SEXA
-                case 0x02:
-                    cpu.ab.ab.a = (cc.c ? 0xFF:0x00);  // Flags not affected
+                OPCODE(0x02, INHERENT)
+                    cpu.ab.ab.a = (CC_C ? 0xFF:0x00);  // Flags not affected
                     break;
 
                 // Undocumented: SETA
-                case 0x03:
+                OPCODE(0x03, INHERENT)
                     cpu.ab.ab.a = 0xFF;  // Flags not affected
                     break;
 
                 // Undocumented: NGC - Negate with Carry A
-                case 0x42:
+                OPCODE(0x42, INHERENT)
                     cpu.ab.ab.a = ngc(cpu.ab.ab.a);
                     break;
 
                 // Undocumented: NGC - Negate with Carry B
-                case 0x52:
+                OPCODE(0x52, INHERENT)
                     cpu.ab.ab.b = ngc(cpu.ab.ab.b);
                     break;
 
                 // Undocumented: NGC - Negate with Carry
-                case 0x62:
-                case 0x72:
+                OPCODE(0x62, INDEXED)
+                OPCODE(0x72, EXTENDED)
                     operand8 = (uint8_t) mem_read(eff_addr);
                     operand8 = ngc(operand8);
                     mem_write(eff_addr, operand8);
                     break;
 
                 // Undocumented: SCBA
-                case 0x12:
+                OPCODE(0x12, INHERENT)
                     cpu.ab.ab.a = sbc(cpu.ab.ab.a, cpu.ab.ab.b);
                     break;
 
                 // Undocumented: SDBA
-                case 0x13:
-                    cc.c = CC_FLAG_SET;
+                OPCODE(0x13, INHERENT)
+                    SET_CC_C(CC_FLAG_SET);
                     cpu.ab.ab.a = sbc(cpu.ab.ab.a, cpu.ab.ab.b);
                     break;
 
                 // Undocumented: TDAB
-                case 0x14:
-                case 0x1c:
+                OPCODE(0x14, INHERENT)
+                OPCODE(0x1c, INHERENT)
                     cpu.ab.ab.b = dec(cpu.ab.ab.a);
                     break;
 
                 // Undocumented: TDBA
-                case 0x15:
+                OPCODE(0x15, INHERENT)
                     cpu.ab.ab.a = dec(cpu.ab.ab.b);
                     break;
 
                 // Undocumented: TDBC
-                case 0x1d:
+                OPCODE(0x1d, INHERENT)
                     cpu.ab.ab.a = decc(cpu.ab.ab.b);
                     break;
 
                 // Undocumented: TBAC
-                case 0x1f:
+                OPCODE(0x1f, INHERENT)
                     cpu.ab.ab.a = cpu.ab.ab.b;
                     eval_cc_z(cpu.ab.ab.a);
                     eval_cc_n(cpu.ab.ab.a);
-                    cc.v = CC_FLAG_CLR;
-                    cc.c = CC_FLAG_SET;
+                    SET_CC_V(CC_FLAG_CLR);
+                    SET_CC_C(CC_FLAG_SET);
                     break;
 
                 // Undocumented: ABAX
-                case 0x18:
-                case 0x1A:
+                OPCODE(0x18, INHERENT)
+                OPCODE(0x1a, INHERENT)
                     cpu.ab.ab.a = addx(cpu.ab.ab.a, cpu.ab.ab.b);
                     break;
 
                 // Undocumented: NGA
-                case 0x41:
+                OPCODE(0x41, INHERENT)
                     (void) neg(cpu.ab.ab.a); // Don't update register
                     break;
 
                 // Undocumented: NGB
-                case 0x51:
+                OPCODE(0x51, INHERENT)
                     (void) neg(cpu.ab.ab.b); // Don't update register
                     break;
 
                 // Undocumented: NGX
-                case 0x61:
-                case 0x71:
+                OPCODE(0x61, INDEXED)
+                OPCODE(0x71, EXTENDED)
                     operand8 = (uint8_t) mem_read(eff_addr);
                     operand8 = neg(operand8);
                     mem_write(eff_addr, 0xFF);
                     break;
 
                 // Undocumented DCA
-                case 0x4b:
+                OPCODE(0x4b, INHERENT)
                     cpu.ab.ab.a = decc(cpu.ab.ab.a);
                     break;
 
                 // Undocumented DCB
-                case 0x5b:
+                OPCODE(0x5b, INHERENT)
                     cpu.ab.ab.b = decc(cpu.ab.ab.b);
                     break;
 
                 // Undocumented: DCX
-                case 0x6b:
-                case 0x7b:
+                OPCODE(0x6b, INDEXED)
+                OPCODE(0x7b, EXTENDED)
                     operand8 = (uint8_t) mem_read(eff_addr);
                     operand8 = decc(operand8);
                     mem_write(eff_addr, operand8);
                     break;
 
                 // Undocumented: STAI, STBI
-                case 0x87:
-                case 0xc7:
+                OPCODE(0x87, IMMEDIATE)
+                OPCODE(0xc7, IMMEDIATE)
                     (void)mem_read(eff_addr);
-                    cc.n = CC_FLAG_SET;
-                    cc.z = CC_FLAG_CLR;
-                    cc.v = CC_FLAG_CLR;
+                    SET_CC_N(CC_FLAG_SET);
+                    SET_CC_Z(CC_FLAG_CLR);
+                    SET_CC_V(CC_FLAG_CLR);
                     break;
 
                 // Undocumented: LSRX
-                case 0x65:
-                case 0x75:
+                OPCODE(0x65, INDEXED)
+                OPCODE(0x75, EXTENDED)
                     operand8 = (uint8_t) mem_read(eff_addr);
                     (void)lsr(operand8);
                     // CCR only; does not set memory
                     break;
 
                 // Undocumented: STDI
-                case 0xcd:
+                OPCODE(0xcd, LIMMEDIATE)
                     mem_write(cpu.pc-1, cpu.ab.d & 0xff);
-                    cc.n = CC_FLAG_SET;
-                    cc.z = CC_FLAG_CLR;
-                    cc.v = CC_FLAG_CLR;
+                    SET_CC_N(CC_FLAG_SET);
+                    SET_CC_Z(CC_FLAG_CLR);
+                    SET_CC_V(CC_FLAG_CLR);
                     break;
 
                 // Undocumented: STXI
-                case 0xcf:
+                OPCODE(0xcf, LIMMEDIATE)
                     mem_write(cpu.pc-1, cpu.x & 0xff);
-                    cc.n = CC_FLAG_SET;
-                    cc.z = CC_FLAG_CLR;
-                    cc.v = CC_FLAG_CLR;
+                    SET_CC_N(CC_FLAG_SET);
+                    SET_CC_Z(CC_FLAG_CLR);
+                    SET_CC_V(CC_FLAG_CLR);
                     break;
 
                 // Undocumented: STSI
-                case 0x8f:
+                OPCODE(0x8f, LIMMEDIATE)
                     mem_write(cpu.pc-1, 0xff);
-                    cc.n = CC_FLAG_SET;
-                    cc.z = CC_FLAG_CLR;
-                    cc.v = CC_FLAG_CLR;
+                    SET_CC_N(CC_FLAG_SET);
+                    SET_CC_Z(CC_FLAG_CLR);
+                    SET_CC_V(CC_FLAG_CLR);
                     break;
 
                 default:
+#ifdef CPU_THREADED_DISPATCH
+                op_illegal:
+#endif
                     /* Exception: Illegal op-code cpu_run()
                      */
                     cpu.cpu_state = CPU_EXCEPTION;
 
             }
         }
-
-        if (cycles_this_scanline >= CPU_CYCLES_PER_LINE)
+        hle_done:
+
+        // --------------------------------------------------------------
+        // Counters and clocks... the free-running timer counter and the
+        // compare register are only looked at when the next timer event
+        // (or the end of the scanline) has been reached.
+        // --------------------------------------------------------------
+        if (cpu_line_cycles >= cpu_next_event)
         {
-            cpu_cycle_deficit = (cycles_this_scanline - CPU_CYCLES_PER_LINE);
-            break;
+            cpu_timer_sync();
+            if (cpu_line_cycles >= CPU_CYCLES_PER_LINE)
+            {
+                cpu_cycle_deficit = (cpu_line_cycles - CPU_CYCLES_PER_LINE);
+                break;
+            }
+            cpu_timer_schedule();
         }
     }
 }
@@ -1341,7 +1776,7 @@ inline __attribute__((always_inline)) uint8_t adc(uint8_t acc, uint8_t byte)
 {
     uint16_t result;
 
-    result = (acc + byte + cc.c);
+    result = (acc + byte + CC_C);
 
     eval_cc_c(result);
     eval_cc_z(result);
@@ -1426,7 +1861,7 @@ inline __attribute__((always_inline)) uint8_t and(uint8_t acc, uint8_t byte)
 
     eval_cc_z((uint16_t) result);
     eval_cc_n((uint16_t) result);
-    cc.v = CC_FLAG_CLR;
+    SET_CC_V(CC_FLAG_CLR);
 
     return result;
 }
@@ -1448,7 +1883,7 @@ inline __attribute__((always_inline)) uint8_t asl(uint8_t byte)
     eval_cc_c(result);
     eval_cc_z(result);
     eval_cc_n(result);
-    cc.v = (cc.n ^ cc.c) ? CC_FLAG_SET: CC_FLAG_CLR;
+    SET_CC_V((CC_N ^ CC_C) ? CC_FLAG_SET: CC_FLAG_CLR);
 
     return (uint8_t) result;
 }
@@ -1466,10 +1901,10 @@ inline __attribute__((always_inline)) uint8_t asr(uint8_t byte)
 
     result = (byte >> 1) | (byte & 0x80);
 
-    cc.c = byte & 0x01 ? CC_FLAG_SET : CC_FLAG_CLR;
+    SET_CC_C(byte & 0x01 ? CC_FLAG_SET : CC_FLAG_CLR);
     eval_cc_z((uint16_t) result);
     eval_cc_n((uint16_t) result);
-    cc.v = (cc.n ^ cc.c) ? CC_FLAG_SET: CC_FLAG_CLR;
+    SET_CC_V((CC_N ^ CC_C) ? CC_FLAG_SET: CC_FLAG_CLR);
 
     return result;
 }
@@ -1491,7 +1926,7 @@ inline __attribute__((always_inline))  void bit(uint8_t acc, uint8_t byte)
 
     eval_cc_z((uint16_t) result);
     eval_cc_n((uint16_t) result);
-    cc.v = CC_FLAG_CLR;
+    SET_CC_V(CC_FLAG_CLR);
 }
 
 /*------------------------------------------------
@@ -1503,10 +1938,10 @@ inline __attribute__((always_inline))  void bit(uint8_t acc, uint8_t byte)
  */
 inline __attribute__((always_inline)) uint8_t clr(void)
 {
-    cc.c = CC_FLAG_CLR;
-    cc.v = CC_FLAG_CLR;
-    cc.z = CC_FLAG_SET;
-    cc.n = CC_FLAG_CLR;
+    SET_CC_C(CC_FLAG_CLR);
+    SET_CC_V(CC_FLAG_CLR);
+    SET_CC_Z(CC_FLAG_SET);
+    SET_CC_N(CC_FLAG_CLR);
 
     return 0;
 }
@@ -1564,8 +1999,8 @@ inline __attribute__((always_inline)) uint8_t com(uint8_t byte)
 
     result = ~byte;
 
-    cc.c = CC_FLAG_SET;
-    cc.v = CC_FLAG_CLR;
+    SET_CC_C(CC_FLAG_SET);
+    SET_CC_V(CC_FLAG_CLR);
     eval_cc_z((uint16_t) result);
     eval_cc_n((uint16_t) result);
 
@@ -1615,21 +2050,21 @@ inline __attribute__((always_inline)) void daa(void)
     high_nibble = cpu.ab.ab.a & 0xf0;
     low_nibble = cpu.ab.ab.a & 0x0f;
 
-    if ( low_nibble > 0x09 || cc.h )
+    if ( low_nibble > 0x09 || CC_H )
         temp |= 0x06;
 
     if ( high_nibble > 0x80 && low_nibble > 0x09 )
         temp |= 0x60;
-    else if (high_nibble > 0x90 || cc.c)
+    else if (high_nibble > 0x90 || CC_C)
         temp |= 0x60;
 
-    uint8_t origH = cc.h;
-    uint8_t origC = cc.c;
+    uint8_t origH = CC_H;
+    uint8_t origC = CC_C;
     
     cpu.ab.ab.a = add(cpu.ab.ab.a, temp);
     
-    cc.h = origH;
-    cc.c |= origC;
+    SET_CC_H(origH);
+    SET_CC_C(CC_C | origC);
 }
 
 /*------------------------------------------------
@@ -1664,8 +2099,8 @@ __attribute__((noinline)) uint8_t decc(uint8_t byte)
 {
     uint16_t result;
 
-    cc.v = (byte == 0x80) ? CC_FLAG_SET : CC_FLAG_CLR;
-    cc.c = (byte == 0x00) ? CC_FLAG_CLR : CC_FLAG_SET;
+    SET_CC_V((byte == 0x80) ? CC_FLAG_SET : CC_FLAG_CLR);
+    SET_CC_C((byte == 0x00) ? CC_FLAG_CLR : CC_FLAG_SET);
 
     result = byte - 1;
 
@@ -1691,7 +2126,7 @@ inline __attribute__((always_inline)) uint8_t eor(uint8_t acc, uint8_t byte)
 
     eval_cc_z((uint16_t) result);
     eval_cc_n((uint16_t) result);
-    cc.v = CC_FLAG_CLR;
+    SET_CC_V(CC_FLAG_CLR);
 
     return result;
 }
@@ -1727,11 +2162,11 @@ inline __attribute__((always_inline)) uint8_t lsr(uint8_t byte)
 {
     uint8_t result;
 
-    cc.c = byte & 0x01 ? CC_FLAG_SET : CC_FLAG_CLR;
+    SET_CC_C(byte & 0x01 ? CC_FLAG_SET : CC_FLAG_CLR);
     result = (byte >> 1) & 0x7f;
-    cc.z = (result) ? CC_FLAG_CLR : CC_FLAG_SET;
-    cc.n = CC_FLAG_CLR;
-    cc.v = (cc.n ^ cc.c) ? CC_FLAG_SET: CC_FLAG_CLR;
+    SET_CC_Z((result) ? CC_FLAG_CLR : CC_FLAG_SET);
+    SET_CC_N(CC_FLAG_CLR);
+    SET_CC_V((CC_N ^ CC_C) ? CC_FLAG_SET: CC_FLAG_CLR);
 
     return result;
 }
@@ -1745,11 +2180,11 @@ inline __attribute__((always_inline)) uint16_t lsr16(uint16_t word)
 {
     uint16_t result;
 
-    cc.c = word & 0x0001 ? CC_FLAG_SET : CC_FLAG_CLR;
+    SET_CC_C(word & 0x0001 ? CC_FLAG_SET : CC_FLAG_CLR);
     result = (word >> 1) & 0x7fff;
-    cc.z = (result) ? CC_FLAG_CLR : CC_FLAG_SET;
-    cc.n = CC_FLAG_CLR;
-    cc.v = (cc.n ^ cc.c) ? CC_FLAG_SET: CC_FLAG_CLR;
+    SET_CC_Z((result) ? CC_FLAG_CLR : CC_FLAG_SET);
+    SET_CC_N(CC_FLAG_CLR);
+    SET_CC_V((CC_N ^ CC_C) ? CC_FLAG_SET: CC_FLAG_CLR);
 
     return result;
 }
@@ -1765,11 +2200,11 @@ inline __attribute__((always_inline)) uint8_t lsl(uint8_t byte)
 {
     uint8_t result;
 
-    cc.c = (byte & 0x80) ? CC_FLAG_SET: CC_FLAG_CLR;
+    SET_CC_C((byte & 0x80) ? CC_FLAG_SET: CC_FLAG_CLR);
     result = (byte << 1) & 0xfe;
-    cc.z = (result) ? CC_FLAG_CLR : CC_FLAG_SET;
-    cc.n = (result & 0x80) ? CC_FLAG_SET: CC_FLAG_CLR;
-    cc.v = (cc.n ^ cc.c) ? CC_FLAG_SET: CC_FLAG_CLR;
+    SET_CC_Z((result) ? CC_FLAG_CLR : CC_FLAG_SET);
+    SET_CC_N((result & 0x80) ? CC_FLAG_SET: CC_FLAG_CLR);
+    SET_CC_V((CC_N ^ CC_C) ? CC_FLAG_SET: CC_FLAG_CLR);
 
     return result;
 }
@@ -1783,11 +2218,11 @@ inline __attribute__((always_inline)) uint16_t lsl16(uint16_t word)
 {
     uint16_t result;
 
-    cc.c = (word & 0x8000) ? CC_FLAG_SET: CC_FLAG_CLR;
+    SET_CC_C((word & 0x8000) ? CC_FLAG_SET: CC_FLAG_CLR);
     result = (word << 1) & 0xfffe;
-    cc.z = (result) ? CC_FLAG_CLR : CC_FLAG_SET;
-    cc.n = (result & 0x8000) ? CC_FLAG_SET: CC_FLAG_CLR;
-    cc.v = (cc.n ^ cc.c) ? CC_FLAG_SET: CC_FLAG_CLR;
+    SET_CC_Z((result) ? CC_FLAG_CLR : CC_FLAG_SET);
+    SET_CC_N((result & 0x8000) ? CC_FLAG_SET: CC_FLAG_CLR);
+    SET_CC_V((CC_N ^ CC_C) ? CC_FLAG_SET: CC_FLAG_CLR);
 
     return result;
 }
@@ -1825,7 +2260,7 @@ inline __attribute__((always_inline)) uint8_t ngc(uint8_t byte)
 {
     uint16_t result;
 
-    result =  0 - (byte + cc.c);
+    result =  0 - (byte + CC_C);
     eval_cc_c(result);
     eval_cc_z(result);
     eval_cc_n(result);
@@ -1847,7 +2282,7 @@ inline __attribute__((always_inline)) uint8_t or(uint8_t acc, uint8_t byte)
 
     result = acc | byte;
 
-    cc.v = CC_FLAG_CLR;
+    SET_CC_V(CC_FLAG_CLR);
     eval_cc_z((uint16_t) result);
     eval_cc_n((uint16_t) result);
 
@@ -1882,7 +2317,7 @@ inline __attribute__((always_inline)) uint8_t rol(uint8_t byte)
 
     result = (byte << 1);
 
-    if ( cc.c )
+    if ( CC_C )
         result |= 0x0001;
     else
         result &= 0xfffe;
@@ -1908,22 +2343,22 @@ inline __attribute__((always_inline)) uint8_t ror(uint8_t byte)
 
     result = byte;
 
-    if ( cc.c )
+    if ( CC_C )
         result |= 0x0100;
     else
         result &= 0xfeff;
 
     if ( byte & 0x01 )
-        cc.c = CC_FLAG_SET;
+        SET_CC_C(CC_FLAG_SET);
     else
-        cc.c = CC_FLAG_CLR;
+        SET_CC_C(CC_FLAG_CLR);
 
     result = (result >> 1);
 
     eval_cc_z(result);
     eval_cc_n(result);
 
-    cc.v = (cc.n ^ cc.c) ? CC_FLAG_SET: CC_FLAG_CLR;
+    SET_CC_V((CC_N ^ CC_C) ? CC_FLAG_SET: CC_FLAG_CLR);
 
     return (uint8_t) result;
 }
@@ -1939,7 +2374,7 @@ inline __attribute__((always_inline)) uint8_t sbc(uint8_t acc, uint8_t byte)
 {
     uint16_t result;
 
-    result = acc - byte - cc.c;
+    result = acc - byte - CC_C;
 
     eval_cc_c(result);
     eval_cc_z(result);
@@ -2065,8 +2500,8 @@ void inline __attribute__((always_inline)) tst(uint8_t byte)
 {
     eval_cc_z((uint16_t) byte);
     eval_cc_n((uint16_t) byte);
-    cc.v = CC_FLAG_CLR;
-    cc.c = CC_FLAG_CLR;
+    SET_CC_V(CC_FLAG_CLR);
+    SET_CC_C(CC_FLAG_CLR);
 }
 
 
@@ -2137,7 +2572,11 @@ inline __attribute__((always_inline)) int get_eff_addr(int mode)
  */
 inline __attribute__((always_inline)) void eval_cc_c(uint16_t value)
 {
+#ifdef CPU_LAZY_FLAGS
+    lazy_cc.c = (uint32_t) value << 8;
+#else
     cc.c = (value & 0x100) ? CC_FLAG_SET : CC_FLAG_CLR;
+#endif
 }
 
 /*------------------------------------------------
@@ -2150,7 +2589,11 @@ inline __attribute__((always_inline)) void eval_cc_c(uint16_t value)
  */
 inline __attribute__((always_inline)) void eval_cc_c16(uint32_t value)
 {
+#ifdef CPU_LAZY_FLAGS
+    lazy_cc.c = value;
+#else
     cc.c = (value & 0x00010000) ? CC_FLAG_SET : CC_FLAG_CLR;
+#endif
 }
 
 /*------------------------------------------------
@@ -2163,7 +2606,11 @@ inline __attribute__((always_inline)) void eval_cc_c16(uint32_t value)
  */
 inline __attribute__((always_inline)) void eval_cc_z(uint16_t value)
 {
+#ifdef CPU_LAZY_FLAGS
+    lazy_cc.z = (uint32_t) value << 8;
+#else
     cc.z = !(value & 0x00ff) ? CC_FLAG_SET : CC_FLAG_CLR;
+#endif
 }
 
 /*------------------------------------------------
@@ -2176,7 +2623,11 @@ inline __attribute__((always_inline)) void eval_cc_z(uint16_t value)
  */
 inline __attribute__((always_inline)) void eval_cc_z16(uint32_t value)
 {
+#ifdef CPU_LAZY_FLAGS
+    lazy_cc.z = value;
+#else
     cc.z = !(value & 0x0000ffff) ? CC_FLAG_SET : CC_FLAG_CLR;
+#endif
 }
 
 /*------------------------------------------------
@@ -2189,7 +2640,11 @@ inline __attribute__((always_inline)) void eval_cc_z16(uint32_t value)
  */
 inline __attribute__((always_inline)) void eval_cc_n(uint16_t value)
 {
+#ifdef CPU_LAZY_FLAGS
+    lazy_cc.n = (uint32_t) value << 8;
+#else
     cc.n = (value & 0x0080) ? CC_FLAG_SET : CC_FLAG_CLR;
+#endif
 }
 
 /*------------------------------------------------
@@ -2202,7 +2657,11 @@ inline __attribute__((always_inline)) void eval_cc_n(uint16_t value)
  */
 inline __attribute__((always_inline)) void eval_cc_n16(uint32_t value)
 {
+#ifdef CPU_LAZY_FLAGS
+    lazy_cc.n = value;
+#else
     cc.n = (value & 0x00008000) ? CC_FLAG_SET : CC_FLAG_CLR;
+#endif
 }
 
 /*------------------------------------------------
@@ -2219,7 +2678,11 @@ inline __attribute__((always_inline)) void eval_cc_n16(uint32_t value)
  */
 inline __attribute__((always_inline)) void eval_cc_v(uint8_t val1, uint8_t val2, uint16_t result)
 {
+#ifdef CPU_LAZY_FLAGS
+    lazy_cc.v = (uint32_t) ((val1 ^ result) & (val2 ^ result)) << 8;
+#else
     cc.v = ((val1 ^ result) & (val2 ^ result) & 0x0080) ? CC_FLAG_SET : CC_FLAG_CLR;
+#endif
 }
 
 /*------------------------------------------------
@@ -2236,7 +2699,11 @@ inline __attribute__((always_inline)) void eval_cc_v(uint8_t val1, uint8_t val2,
  */
 inline __attribute__((always_inline)) void eval_cc_v16(uint16_t val1, uint16_t val2, uint32_t result)
 {
+#ifdef CPU_LAZY_FLAGS
+    lazy_cc.v = (val1 ^ result) & (val2 ^ result);
+#else
     cc.v = ((val1 ^ result) & (val2 ^ result) & 0x00008000) ? CC_FLAG_SET : CC_FLAG_CLR;
+#endif
 }
 
 /*------------------------------------------------
@@ -2252,7 +2719,11 @@ inline __attribute__((always_inline)) void eval_cc_h(uint8_t val1, uint8_t val2,
 {
     /* Half carry in 6803 is only relevant/valid for additions ADD and ADC
      */
+#ifdef CPU_LAZY_FLAGS
+    lazy_cc.h = (val1 ^ val2) ^ result;
+#else
     cc.h = (((val1 ^ val2) ^ result) & 0x10) ? CC_FLAG_SET : CC_FLAG_CLR;
+#endif
 }
 
 /*------------------------------------------------
@@ -2265,7 +2736,7 @@ inline __attribute__((always_inline)) void eval_cc_h(uint8_t val1, uint8_t val2,
  */
 inline __attribute__((always_inline)) uint8_t get_cc(void)
 {
-    return (uint8_t) ((cc.h << 5) + (cc.i << 4) + (cc.n << 3) + (cc.z << 2) + (cc.v << 1) + cc.c) | 0xC0;
+    return (uint8_t) ((CC_H << 5) + (cc.i << 4) + (CC_N << 3) + (CC_Z << 2) + (CC_V << 1) + CC_C) | 0xC0;
 }
 
 /*------------------------------------------------
@@ -2278,10 +2749,10 @@ inline __attribute__((always_inline)) uint8_t get_cc(void)
  */
 inline void set_cc(uint8_t value)
 {
-    cc.c = (value & 0x01) ? CC_FLAG_SET : CC_FLAG_CLR;
-    cc.v = (value & 0x02) ? CC_FLAG_SET : CC_FLAG_CLR;
-    cc.z = (value & 0x04) ? CC_FLAG_SET : CC_FLAG_CLR;
-    cc.n = (value & 0x08) ? CC_FLAG_SET : CC_FLAG_CLR;
+    SET_CC_C((value & 0x01) ? CC_FLAG_SET : CC_FLAG_CLR);
+    SET_CC_V((value & 0x02) ? CC_FLAG_SET : CC_FLAG_CLR);
+    SET_CC_Z((value & 0x04) ? CC_FLAG_SET : CC_FLAG_CLR);
+    SET_CC_N((value & 0x08) ? CC_FLAG_SET : CC_FLAG_CLR);
     cc.i = (value & 0x10) ? CC_FLAG_SET : CC_FLAG_CLR;
-    cc.h = (value & 0x20) ? CC_FLAG_SET : CC_FLAG_CLR;
+    SET_CC_H((value & 0x20) ? CC_FLAG_SET : CC_FLAG_CLR);
 }
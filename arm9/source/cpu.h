@@ -56,6 +56,8 @@ typedef struct
 extern cpu_state_t cpu;
 
 extern int cpu_cycle_deficit;
+extern int cpu_next_event;
+extern int cpu_line_cycles;
 
 /********************************************************************
  *  CPU module API
@@ -64,5 +66,17 @@ void cpu_init(void);
 void cpu_reset(int state);
 void cpu_check_reset(void);
 void cpu_run(void);
+void cpu_timer_sync(void);
+uint8_t get_cc(void);
+void set_cc(uint8_t value);
+void cpu_decode_map(void);
+void cpu_decode_flush(void);
+
+#ifdef CPU_TRACE
+/* Optional hook (headless host builds only) called before each
+ * instruction is fetched with the packed CC register value.
+ */
+void cpu_trace(uint8_t cc);
+#endif
 
 #endif  /* __CPU_H__ */
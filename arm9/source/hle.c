@@ -0,0 +1,325 @@
+// =====================================================================================
+// Copyright (c) 2025 Dave Bernazzani (wavemotion-dave)
+//
+// Copying and distribution of this emulator, its source code and associated
+// readme files, with or without modification, are permitted in any medium without
+// royalty provided this copyright notice is used and wavemotion-dave and eyalabraham
+// (Dragon 32 emu core) are thanked profusely.
+//
+// The Micro-DS emulator is offered as-is, without any warranty. Please see readme.md
+// =====================================================================================
+
+/********************************************************************
+ * hle.c
+ *
+ *  High level emulation of ROM routines. BASIC programs spend much
+ *  of their time in the ROM's software floating point which the core
+ *  otherwise interprets one op-code at a time. When the PC reaches a
+ *  known entry point of a known ROM (identified by its CRC32) the
+ *  native C version is run instead and the CPU core returns straight
+ *  to the caller. The cassette block reader is handled the same way to
+ *  load tapes a whole block at a time (FAST LOAD).
+ *
+ *  Each native routine is a straight translation of the 6803 code it
+ *  replaces - same result bytes, same registers and flags and the same
+ *  cycle count on every path through it. 'make hle-compare' in the
+ *  host directory runs the ROM code and the native routine side by
+ *  side on random accumulators and checks all of that. A ROM entry
+ *  point only goes into a table once it passes.
+ *
+ *******************************************************************/
+#include    <nds.h>
+#include    <string.h>
+
+#include    "cpu.h"
+#include    "mem.h"
+#include    "hle.h"
+#include    "tape.h"
+#include    "MicroDS.h"
+#include    "MicroUtils.h"
+
+// ------------------------------------------------------------------------
+// The ROMs we have native routines for. A ROM is only listed along with
+// entry points that 'make hle-compare ROM=...' has passed against it (and
+// a cassette block reader 'make fastload-test ROM=...' has passed).
+// MICROCOLOR BASIC 1.0 (MC10.BIN, CRC 11fda97e) is not in yet - nothing
+// here has been run against that image.
+// ------------------------------------------------------------------------
+static const hle_rom_t hle_roms[] =
+{
+    {0x00000000, 0x00, 0x00, NULL, NULL}
+};
+
+// Condition code bits as packed by get_cc()
+#define     CC_C            0x01
+#define     CC_V            0x02
+#define     CC_Z            0x04
+#define     CC_N            0x08
+#define     CC_H            0x20
+
+uint8_t  hle_trap_page[256] __attribute__((section(".dtcm"))) = {0};  // Non-zero if a page has a trapped entry point
+uint32_t hle_calls                                              = 0;    // Native routines run (for the host benchmark)
+
+static const hle_rom_t *hle_rom = NULL;
+
+/*------------------------------------------------
+ * hle_init()
+ *
+ *  Pick the native routines for the ROM that was
+ *  just loaded (if we know it). Called on reset
+ *  after the ROM is in place.
+ *
+ *  param:  CRC32 of the BASIC ROM image
+ *  return: Nothing
+ */
+void hle_init(uint32_t rom_crc)
+{
+    hle_install(hle_lookup(rom_crc));
+}
+
+/*------------------------------------------------
+ * hle_lookup()
+ *
+ *  Find the table for a ROM.
+ *
+ *  param:  CRC32 of the BASIC ROM image
+ *  return: ROM table or NULL if we don't know it
+ */
+const hle_rom_t *hle_lookup(uint32_t rom_crc)
+{
+    for (int i=0; hle_roms[i].traps; i++)
+    {
+        if (hle_roms[i].crc == rom_crc) return &hle_roms[i];
+    }
+
+    return NULL;
+}
+
+/*------------------------------------------------
+ * hle_install()
+ *
+ *  Trap the entry points of a ROM's table (or none).
+ *  hle_init() does this for the ROMs we know - the
+ *  host checks use it to try out a table directly.
+ *
+ *  param:  ROM table or NULL
+ *  return: Nothing
+ */
+void hle_install(const hle_rom_t *rom)
+{
+    hle_rom   = rom;
+    hle_calls = 0;
+    memset(hle_trap_page, 0x00, sizeof(hle_trap_page));
+
+    if (hle_rom)
+    {
+        for (int i=0; hle_rom->traps[i].address; i++)
+        {
+            hle_trap_page[hle_rom->traps[i].address >> 8] = 1;
+        }
+
+        if (hle_rom->cassette)
+        {
+            hle_trap_page[hle_rom->cassette->block_in >> 8] = 1;
+        }
+    }
+
+    // Trapped entry points must not be left in the predecoded cache
+    cpu_decode_flush();
+}
+
+/*------------------------------------------------
+ * hle_find()
+ *
+ *  Is there a native routine for this address?
+ *
+ *  param:  Address
+ *  return: Index into the trap table plus one, -1 for the
+ *          cassette block reader or 0 if none
+ */
+int hle_find(int address)
+{
+    if (hle_trap_page[address >> 8])
+    {
+        if (hle_rom->cassette && (hle_rom->cassette->block_in == address)) return -1;
+
+        for (int i=0; hle_rom->traps[i].address; i++)
+        {
+            if (hle_rom->traps[i].address == address) return i+1;
+        }
+    }
+
+    return 0;
+}
+
+/*------------------------------------------------
+ * hle_trap()
+ *
+ *  Called by the CPU before an instruction is fetched
+ *  from a page that has a trapped entry point. If the
+ *  PC is at the entry point (and FAST MATH or FAST LOAD
+ *  is on) the native routine is run in place of the ROM's.
+ *
+ *  param:  Address, condition codes (updated)
+ *  return: Cycles to charge or 0 if the ROM should run
+ */
+int hle_trap(int address, uint8_t *cc)
+{
+    int index = hle_find(address);
+    if (!index) return 0;
+
+    if (index < 0)
+    {
+        if (!myConfig.fastLoad) return 0;
+        int cycles = hle_block_in(hle_rom, cc);
+        if (cycles) hle_calls++;
+        return cycles;
+    }
+
+    if (myConfig.hleMath == HLE_OFF) return 0;
+
+    const hle_trap_t *trap = &hle_rom->traps[index-1];
+    int cycles = trap->routine(hle_rom, cc);
+    hle_calls++;
+
+    return (myConfig.hleMath == HLE_TURBO) ? trap->turbo_cycles : cycles;
+}
+
+/*------------------------------------------------
+ * hle_block_in()
+ *
+ *  FAST LOAD - the ROM's cassette block reader. The
+ *  next block is taken whole from the tape image and
+ *  written to the buffer the ROM asked for. Anything
+ *  that doesn't parse as a plain block (a protected or
+ *  turbo loader tape) is left to the ROM to read bit
+ *  by bit as before.
+ *
+ *  param:  ROM table (where the reader keeps things), condition codes (updated)
+ *  return: Cycles to charge or 0 if the ROM should run
+ */
+int hle_block_in(const hle_rom_t *rom, uint8_t *cc)
+{
+    const hle_cassette_t *cassette = rom->cassette;
+    uint8_t type, length, data[256];
+
+    int status = tape_block_read(&type, &length, data);
+    if (status < 0) return 0;
+
+    uint16_t buffer = (Memory[cassette->buffer] << 8) | Memory[cassette->buffer + 1];
+    for (int i=0; i < length; i++)
+    {
+        mem_write((uint16_t)(buffer + i), data[i]);
+    }
+
+    uint8_t error = status ? 0 : 1;
+    Memory[cassette->block_type]   = type;
+    Memory[cassette->block_length] = length;
+    Memory[cassette->error]        = error;
+
+    cpu.ab.ab.a = error;
+    cpu.x = (uint16_t)(buffer + length);
+    *cc = (*cc & ~(CC_N | CC_Z | CC_V)) | (error ? 0 : CC_Z);
+
+    return HLE_BLOCK_CYCLES;
+}
+
+/*------------------------------------------------
+ * hle_normalize()
+ *
+ *  Normalize FPA0 - shift the mantissa (and the sub
+ *  byte below it) left until the top bit is set and
+ *  take the shifts off the exponent. A mantissa of
+ *  zero or an exponent that would go to zero or below
+ *  leaves FPA0 as zero (exponent and sign cleared).
+ *  The ROM code this stands in for:
+ *
+ *        CLRB                 B counts the shifts
+ *  BYTE  LDAA FPA0            whole bytes first
+ *        BNE  BIT
+ *        LDAA FPA0+1 / STAA FPA0      (and on down to
+ *        ...                           FPSBYT into FPA0+3)
+ *        CLR  FPSBYT
+ *        ADDB #8
+ *        CMPB #40
+ *        BLT  BYTE
+ *  ZERO  CLRA
+ *        STAA FP0EXP
+ *        STAA FP0SGN
+ *        RTS
+ *  BIT   BMI  DONE            then bit by bit
+ *  LOOP  INCB
+ *        ASL  FPSBYT (extended) / ROL FPA0+3 ... ROL FPA0
+ *        BPL  LOOP
+ *  DONE  LDAA FP0EXP
+ *        SBA
+ *        STAA FP0EXP
+ *        BLS  ZERO
+ *        RTS
+ *
+ *  param:  ROM table (where FPA0 is), condition codes (updated)
+ *  return: Cycles the ROM code takes (including its RTS)
+ */
+int hle_normalize(const hle_rom_t *rom, uint8_t *cc)
+{
+    uint8_t *fpa = &Memory[rom->fp0exp];    // The direct page is always internal RAM
+    uint8_t *sub = &Memory[rom->fpsbyt];
+    uint8_t  b = 0;
+    int cycles = 2;                         // CLRB
+
+    while (fpa[1] == 0)
+    {
+        fpa[1] = fpa[2];
+        fpa[2] = fpa[3];
+        fpa[3] = fpa[4];
+        fpa[4] = *sub;
+        *sub = 0;
+
+        *cc = (*cc & ~CC_H) | ((b & 0x08) ? CC_H : 0);      // ADDB #8 half carry
+        b += 8;
+        cycles += 43;                       // LDAA, BNE, 4x LDAA/STAA, CLR, ADDB, CMPB, BLT
+
+        if (b >= 40) break;
+    }
+
+    if (fpa[1])
+    {
+        cycles += 6 + 3;                    // LDAA, BNE, BMI
+
+        while (!(fpa[1] & 0x80))
+        {
+            b++;
+            uint8_t carry = *sub >> 7;
+            *sub <<= 1;
+            for (int i=4; i>=1; i--)
+            {
+                uint8_t out = fpa[i] >> 7;
+                fpa[i] = (fpa[i] << 1) | carry;
+                carry = out;
+            }
+            cycles += 35;                   // INCB, ASL, 4x ROL, BPL
+        }
+
+        uint8_t a = fpa[0] - b;
+        cycles += 11;                       // LDAA, SBA, STAA, BLS
+
+        if (fpa[0] > b)
+        {
+            fpa[0] = a;
+            cpu.ab.ab.a = a;
+            cpu.ab.ab.b = b;
+            *cc = (*cc & ~(CC_N | CC_Z | CC_V | CC_C)) | ((a & 0x80) ? CC_N : 0);
+            return cycles + 5;              // RTS
+        }
+    }
+
+    fpa[0] = 0;                             // ZERO - CLRA, 2x STAA, RTS
+    fpa[5] = 0;
+    cpu.ab.ab.a = 0;
+    cpu.ab.ab.b = b;
+    *cc = (*cc & ~(CC_N | CC_Z | CC_V | CC_C)) | CC_Z;
+
+    return cycles + 13;
+}
+
+// End of file
@@ -0,0 +1,83 @@
+// =====================================================================================
+// Copyright (c) 2025 Dave Bernazzani (wavemotion-dave)
+//
+// Copying and distribution of this emulator, its source code and associated
+// readme files, with or without modification, are permitted in any medium without
+// royalty provided this copyright notice is used and wavemotion-dave and eyalabraham
+// (Dragon 32 emu core) are thanked profusely.
+//
+// The Micro-DS emulator is offered as-is, without any warranty. Please see readme.md
+// =====================================================================================
+
+#ifndef __HLE_H__
+#define __HLE_H__
+
+#include    <stdint.h>
+
+#define HLE_BLOCK_CYCLES    1000    // What a fast-loaded block costs (under 20 scanlines)
+
+// Settings for myConfig.hleMath
+#define HLE_OFF         0   // Always run the ROM routines
+#define HLE_STRICT      1   // Native routines charged the cycles the ROM would have taken
+#define HLE_TURBO       2   // Native routines charged a token number of cycles
+
+struct hle_rom;
+
+// ------------------------------------------------------------------------
+// A ROM routine with a native replacement. The native routine leaves RAM
+// (the floating point accumulator), A, B, X and the condition codes
+// exactly as the ROM routine would at its final RTS and returns the
+// number of cycles the ROM routine would have taken (including the RTS).
+// The RTS itself is done by the CPU core.
+// ------------------------------------------------------------------------
+typedef struct
+{
+    uint16_t  address;                                          // Entry point in the ROM
+    uint16_t  turbo_cycles;                                     // What we charge in HLE_TURBO mode
+    int     (*routine)(const struct hle_rom *rom, uint8_t *cc); // Native version - returns the ROM cycle count
+} hle_trap_t;
+
+// ------------------------------------------------------------------------
+// Where a ROM's cassette block reader starts and where it leaves what it
+// read: the block type, the length, the pointer to the buffer it fills and
+// the error code (0=good, 1=bad checksum). It returns with the error code
+// in A (Z set for a good block) and X just past the data it stored. B and
+// the carry are left as they were - the ROM leaves them as working values.
+// ------------------------------------------------------------------------
+typedef struct
+{
+    uint16_t    block_in;
+    uint8_t     block_type;
+    uint8_t     block_length;
+    uint8_t     buffer;
+    uint8_t     error;
+} hle_cassette_t;
+
+// ------------------------------------------------------------------------
+// A BASIC ROM we have native routines for, identified by the CRC32 of the
+// image. The Microsoft floating point accumulator sits in the direct page
+// as the exponent, 4 mantissa bytes and the sign in that order along with
+// a sub byte holding the bits shifted out below the mantissa.
+// ------------------------------------------------------------------------
+typedef struct hle_rom
+{
+    uint32_t            crc;
+    uint8_t             fp0exp;     // FPA0 exponent (mantissa at +1 to +4, sign at +5)
+    uint8_t             fpsbyt;     // FPA0 sub byte
+    const hle_trap_t   *traps;      // Ends with a zero address
+    const hle_cassette_t *cassette; // For FAST LOAD (or NULL)
+} hle_rom_t;
+
+extern uint8_t  hle_trap_page[256];
+extern uint32_t hle_calls;
+
+extern void     hle_init(uint32_t rom_crc);
+extern void     hle_install(const hle_rom_t *rom);
+extern const hle_rom_t *hle_lookup(uint32_t rom_crc);
+extern int      hle_find(int address);
+extern int      hle_trap(int address, uint8_t *cc);
+
+extern int      hle_block_in(const hle_rom_t *rom, uint8_t *cc);
+extern int      hle_normalize(const hle_rom_t *rom, uint8_t *cc);
+
+#endif  /* __HLE_H__ */
@@ -24,12 +24,61 @@
 #include "mem.h"
 #include "tape.h"
 #include "vdg.h"
+#include "audio.h"
+#include "hle.h"
+#include "snapshot.h"
+#include "rewind.h"
 #include "printf.h"
 
-#define NTSC_SCANLINES      262
+#define NTSC_SCANLINES          262
+#define BOOT_SNAPSHOT_FRAMES    600     // Give up on the boot snapshot if BASIC isn't at its prompt by then
+#define BOOT_PROMPT_FRAMES      10      // How long BASIC must sit waiting at its prompt before we snapshot it
 
 u32 micro_line  __attribute__((section(".dtcm"))) = 0;
 
+// ------------------------------------------------------------------------
+// The boot snapshot. The first time a ROM is cold started on a machine
+// type, the whole machine is snapshotted once BASIC is sitting at its
+// prompt - running in the ROM and polling the keyboard frame after frame
+// with its program pointers set up for an empty program (and with no keys
+// pressed and no tape moving). If that isn't seen in a few seconds there
+// is no snapshot.
+// From then on, a reset of the same ROM and machine restores that in place
+// of running through the ROM's cold start. The front end may also keep it
+// on the SD card (see MicroReadBootSnapshot() in saveload.c). It is only
+// allocated for the machine being run - a machine change starts it over.
+// ------------------------------------------------------------------------
+u8 *boot_snapshot       = NULL; // snapshot_size() bytes for boot_machine (NULL if no room)
+u32 boot_snapshot_crc   = 0;    // CRC of the ROM the boot snapshot is for (0 if none)
+static u8 boot_machine  = 0xFF; // Machine boot_snapshot was allocated for
+u32 boot_rom_crc        = 0;    // CRC of the ROM that was last reset
+static int boot_frames  = 0;    // Frames left to see BASIC at its prompt (0 if not waiting)
+static int boot_prompt  = 0;    // Frames in a row BASIC has been waiting at its prompt
+
+// ------------------------------------------------------------------------
+// Run-ahead. At the end of each frame the machine is snapshotted and run
+// on for a few more frames (no audio and nothing drawn until the last of
+// them) with the keys as they are now. That frame is what goes on screen
+// and then the machine is put back. A game that takes a frame or two to
+// react to a key shows the reaction that much sooner. The snapshot is only
+// allocated (for the machine being run) while run-ahead is turned on.
+// ------------------------------------------------------------------------
+static u8 *run_ahead_state = NULL;
+static u32 run_ahead_sized = 0;                  // Snapshot size run_ahead_state was allocated for
+static u8 run_ahead_dirty[MEM_VIDEO_CHUNKS];     // Video memory written while running ahead
+
+// ------------------------------------------------------------------------
+// Allocate the boot snapshot for the machine about to be run. Whatever was
+// there was for another machine (and maybe another size) so it goes.
+// ------------------------------------------------------------------------
+static void micro_boot_alloc(void)
+{
+    if (boot_snapshot) free(boot_snapshot);
+    boot_snapshot     = malloc(snapshot_size());
+    boot_snapshot_crc = 0;
+    boot_machine      = myConfig.machine;
+}
+
 // ------------------------------------------------------------------------
 // Reset the emulation. Load the MICROBASIC into the memory map and reset
 // the various peripherals for tape and VDG... and start emulation running!
@@ -51,25 +100,185 @@ void micro_reset(void)
     // --------------------------------------------------
     if ((myConfig.machine == MACHINE_MCX) && bMCX_found)
     {
-        mem_load_rom(0xc000, MCXBASIC, sizeof(MCXBASIC));   // MCX ROM takes up all 16K
+        // The MCX ROM banks are paged in straight from MCXBASIC[] by mem_map_build()
+        boot_rom_crc = getCRC32(MCXBASIC, sizeof(MCXBASIC));
     }
     else if ((myConfig.machine == MACHINE_ALICE) && bALICE_found)
     {
         mem_load_rom(0xc000, ALICE4K, sizeof(ALICE4K));     // Mirror of 8K BASIC
         mem_load_rom(0xe000, ALICE4K, sizeof(ALICE4K));     // ROM normally runs here
+        boot_rom_crc = getCRC32(ALICE4K, sizeof(ALICE4K));
     }
     else
     {
         mem_load_rom(0xc000, MC10BASIC, sizeof(MC10BASIC)); // Mirror of 8K BASIC
         mem_load_rom(0xe000, MC10BASIC, sizeof(MC10BASIC)); // ROM normally runs here
+        boot_rom_crc = getCRC32(MC10BASIC, sizeof(MC10BASIC));
     }
 
+    hle_init(boot_rom_crc);     // Native floating point if we know this ROM
+
+    rewind_reset();             // Can't rewind back past a reset
+
     // Reset the CPU and off we go!!
     cpu_init();
     cpu_reset(1);
     cpu_check_reset();
+
+    // ------------------------------------------------------------------
+    // Skip the cold start if we have already seen this ROM boot on this
+    // machine... otherwise get ready to snapshot it once it has booted.
+    // ------------------------------------------------------------------
+    boot_frames = 0;
+    boot_prompt = 0;
+
+    if (!boot_snapshot || (boot_machine != myConfig.machine)) micro_boot_alloc();
+    if (!boot_snapshot) return;     // No room for it - always a cold start
+
+    if ((boot_snapshot_crc != boot_rom_crc) || !snapshot_restore(boot_snapshot))
+    {
+        MicroReadBootSnapshot();    // The front end may have one kept for this ROM and machine
+
+        if ((boot_snapshot_crc != boot_rom_crc) || !snapshot_restore(boot_snapshot))
+        {
+            boot_frames = BOOT_SNAPSHOT_FRAMES;
+        }
+    }
+}
+
+// ------------------------------------------------------------------------
+// The front end has put the machine into some other state straight after
+// a reset (a warm start or a saved game) so it's no longer a clean boot.
+// ------------------------------------------------------------------------
+void micro_boot_cancel(void)
+{
+    boot_frames = 0;
+}
+
+// ------------------------------------------------------------------------
+// Called at the end of each frame. While waiting for a cold start to
+// finish, BASIC is taken to be at its prompt when it's running in the ROM,
+// has read the keyboard this frame and its program pointers are set up.
+// Once that has held for a few frames in a row, the boot snapshot is taken.
+// ------------------------------------------------------------------------
+void micro_boot_frame(void)
+{
+    if (boot_frames)
+    {
+        if (kbd_keys_pressed || tape_motor)
+        {
+            boot_frames = 0;    // Not a clean boot any more
+        }
+        else if (kbd_polled && (cpu.pc >= 0xC000) && micro_basic_pointers())
+        {
+            if (++boot_prompt == BOOT_PROMPT_FRAMES)
+            {
+                snapshot_save(boot_snapshot);
+                boot_snapshot_crc = boot_rom_crc;
+                MicroWriteBootSnapshot();
+                boot_frames = 0;
+            }
+        }
+        else
+        {
+            boot_prompt = 0;    // Still starting up (or busy) - keep waiting
+            boot_frames--;
+        }
+    }
+
+    kbd_polled = 0;
 }
 
+// ------------------------------------------------------------------------
+// Find BASIC's program pointers in the direct page - the start of the
+// program text followed by the start of the simple variables, the arrays
+// and the end of the arrays. With no program in memory the text is just
+// the two zero bytes that end it and the other three all point straight
+// after those. Returns where the block starts or 0 if there isn't one.
+// ------------------------------------------------------------------------
+u16 micro_basic_pointers(void)
+{
+    for (u16 address = 0x80; address <= 0xF8; address++)
+    {
+        u16 text = (mem_read(address+0) << 8) | mem_read(address+1);
+        u16 vars = (mem_read(address+2) << 8) | mem_read(address+3);
+        u16 arys = (mem_read(address+4) << 8) | mem_read(address+5);
+        u16 aend = (mem_read(address+6) << 8) | mem_read(address+7);
+
+        if ((text < 0x0100) || (text + 1 >= io_start)) continue;   // Must be in RAM
+
+        if ((vars == text + 2) && (arys == vars) && (aend == vars) && !mem_read(text) && !mem_read(text + 1))
+        {
+            return address;
+        }
+    }
+
+    return 0;
+}
+
+
+// ------------------------------------------------------------------------
+// Run the machine on for some frames, draw the last of them and then put
+// it back to how it was. The screen now shows video memory as it is after
+// running ahead so anything written in that time is flagged to be drawn
+// again on the next frame - that's all that can differ once put back.
+// ------------------------------------------------------------------------
+void micro_run_ahead(int frames)
+{
+    u8 edges = beeper_edges;    // The beeper edges from running ahead are never heard
+
+    if (run_ahead_sized != snapshot_size())
+    {
+        micro_run_ahead_free();
+        run_ahead_state = malloc(snapshot_size());
+        if (!run_ahead_state)   // No room - just show the frame as it is
+        {
+            vdg_render();
+            return;
+        }
+        run_ahead_sized = snapshot_size();
+    }
+
+    snapshot_save(run_ahead_state);
+
+    for (int frame=0; frame < frames; frame++)
+    {
+        for (micro_line=0; micro_line < NTSC_SCANLINES; micro_line++)
+        {
+            cpu_run();              // No audio as we'll be back here shortly
+        }
+        micro_line = 0;
+        cpu_cycle_deficit = 0;
+    }
+
+    memcpy(run_ahead_dirty, mem_video_dirty, sizeof(run_ahead_dirty));
+    int changed = vdg_render();
+
+    snapshot_restore_quiet(run_ahead_state);
+    beeper_edges = edges;
+
+    // A new mode shows memory that wasn't being watched while running ahead so draw it all again
+    if (changed)
+    {
+        vdg_full_redraw = 1;
+        return;
+    }
+
+    for (int i=0; i < MEM_VIDEO_CHUNKS; i++)
+    {
+        mem_video_dirty[i] |= run_ahead_dirty[i];
+    }
+}
+
+// ------------------------------------------------------------------------
+// Give back the run-ahead snapshot once run-ahead has been turned off.
+// ------------------------------------------------------------------------
+void micro_run_ahead_free(void)
+{
+    if (run_ahead_state) free(run_ahead_state);
+    run_ahead_state = NULL;
+    run_ahead_sized = 0;
+}
 
 // -------------------------------------------------------------------------
 // Run the emulation for exactly 1 scanline of Audio and CPU. When we reach
@@ -93,9 +302,22 @@ ITCM_CODE u32 micro_run(void)
     // --------------------------------------------
     if (++micro_line == NTSC_SCANLINES)
     {
-        vdg_render();               // Draw the frame
         micro_line = 0;             // Back to the top
         cpu_cycle_deficit = 0;   // Reset cycles per line
+
+        audio_frame();              // Keep the sound output level with the emulation
+        tape_prefetch();            // Read ahead on the tape while it's outside the CPU loop
+
+        // Draw the frame - or the one a few frames on (not while the tape is running)
+        if (myConfig.runAhead && !tape_motor) micro_run_ahead(myConfig.runAhead);
+        else
+        {
+            if (!myConfig.runAhead && run_ahead_state) micro_run_ahead_free();
+            vdg_render();
+        }
+
+        micro_boot_frame();         // Still booting? Snapshot BASIC once it's at its prompt
+
         return 1;                   // End of frame
     }
 
@@ -9,9 +9,11 @@
 // The Micro-DS emulator is offered as-is, without any warranty. Please see readme.md
 // =====================================================================================
 #include    <nds.h>
+#include    <string.h>
 
 #include    "mem.h"
 #include    "tape.h"
+#include    "audio.h"
 #include    "MicroDS.h"
 #include    "MicroUtils.h"
 
@@ -28,6 +30,12 @@
 // 9000-BFFF IO Map though generally only BFFF is used (could map RAM)
 // C000-DFFF Mirror of the MICROBASIC ROM (unless 16K ROM loaded)
 // E000-FFFF MICROBASIC ROM sits here with the vectors in the last area
+//
+// The MCX-128 adds a second 64K bank of RAM (Memory_MCX[]) and RAM in all
+// of the unmapped areas. The RAM bank register at 0xBF00 selects the bank
+// for 0100-7FFF (bit 1) and 8000-BEFF (bit 0) and the ROM map register at
+// 0xBF01 selects what appears at C000-FFFF - see mem_map_build_mcx().
+// Memory[] is always bank 0 which is the bank the VDG displays from.
 // ------------------------------------------------------------------------
 
 uint8_t  Memory[MEMORY_SIZE]; // 64K Memory Space for the MC-10
@@ -39,7 +47,23 @@ uint8_t mcx_ram_bank0         __attribute__((section(".dtcm"))) = 0x00;   // For
 uint8_t mcx_ram_bank1         __attribute__((section(".dtcm"))) = 0x00;   // For management of MCX RAM banking
 uint8_t mcx_rom_bank          __attribute__((section(".dtcm"))) = 0x00;   // For management of MCX ROM banking
 
-uint8_t Memory_MCX[0x1000]    __attribute__((section(".dtcm")));          // Used to manage the 4K video buffer on an alternate MCX page of memory
+uint8_t kbd_matrix[6]         __attribute__((section(".dtcm"))) = {0};    // One byte per keyboard row with a 1-bit for each column that has a key pressed
+uint8_t kbd_special           __attribute__((section(".dtcm"))) = 0x00;   // The Memory[2] column bits which pick up SHIFT, CONTROL and BREAK on Port 2
+uint8_t kbd_polled            __attribute__((section(".dtcm"))) = 0x00;   // Set whenever the keyboard port is read (cleared by whoever is watching)
+
+uint8_t Memory_MCX[0x10000];                                              // The second 64K bank of RAM on the MCX-128
+
+uint8_t             *mem_read_page[256]     __attribute__((section(".dtcm")));  // Where each 256 byte page is read from (NULL for IO)
+uint8_t             *mem_write_page[256]    __attribute__((section(".dtcm")));  // Where each 256 byte page is written to (NULL for IO)
+uint8_t             *mem_fetch_page[256]    __attribute__((section(".dtcm")));  // Where op-codes and operands are fetched from (never NULL)
+mem_read_handler_t   mem_read_handler[256];                                     // IO read handler for pages with no read pointer
+mem_write_handler_t  mem_write_handler[256];                                    // IO write handler for pages with no write pointer
+
+uint8_t floating_bus_page[256];     // An unmapped read on the MC-10 returns the low byte of the address
+uint8_t write_sink_page[256];       // Writes to ROM or unmapped areas land here and are never read back
+
+uint8_t mem_video_dirty[MEM_VIDEO_CHUNKS] __attribute__((section(".dtcm")));    // One flag per 32 bytes of 4000-57FF - set when that part of the screen changed
+uint8_t mem_video_pages                   __attribute__((section(".dtcm"))) = 0; // How many pages from 0x4000 the VDG is displaying (writes there are tracked)
 
 /*------------------------------------------------
  * mem_init()
@@ -53,7 +77,7 @@ void mem_init(void)
     for (int addr = 0; addr < MEMORY_SIZE; addr++ )
     {
         Memory[addr] = 0x00;
-        Memory_MCX[addr & 0xFFF] = 0x00;
+        Memory_MCX[addr] = 0x00;
 
         if (addr < 0x100)                    Memory[addr] = 0x00;
         if (addr >= 0x100 && addr < 0x4000)  Memory[addr] = 0xFF;
@@ -72,47 +96,206 @@ void mem_init(void)
     mcx_rom_bank  = 0x00;
 
     counter_read_latch = 0x00;
+
+    memset(kbd_matrix, 0x00, sizeof(kbd_matrix));
+    kbd_special = 0x00;
+    kbd_polled  = 0x00;
+
+    mem_video_pages = 0;    // The VDG picks the tracked pages on its next render
+    memset(mem_video_dirty, 0x00, sizeof(mem_video_dirty));
+
+    mem_map_build();
 }
 
+/*------------------------------------------------
+ * mem_map_ram_mcx()
+ *
+ *  Point the MCX-128 RAM pages at the selected banks.
+ *  0100-7FFF comes from the bank selected by bit 1 of
+ *  0xBF00 and 8000-BEFF from the bank selected by bit 0
+ *  as does the RAM the ROM map shows at C000-FEFF.
+ *
+ *  param:  ROM map mode (see mem_map_build_mcx())
+ *  return: Last page that is RAM
+ */
+static int mem_map_ram_mcx(int mode)
+{
+    uint8_t *lower = (mcx_ram_bank1 ? Memory_MCX : Memory);
+    uint8_t *upper = (mcx_ram_bank0 ? Memory_MCX : Memory);
+    int last = (mode == 1) ? 0xDF : ((mode == 3) ? 0xFE : 0xBE);
 
-// ------------------------------------------------------------------------
-// Port 2 (memory address 0x0003) has 3 special keyboard keys mapped into
-// it... SHIFT, CONTROL and BREAK. Depending on what value was written to
-// Memory[2], we could be scanning for one or more of these special keys.
-// ------------------------------------------------------------------------
-ITCM_CODE uint8_t read_kbd_lo(void)
+    for (int page=0x01; page<0x80; page++)
+    {
+        mem_read_page[page]  = lower + (page << 8);
+        mem_write_page[page] = lower + (page << 8);
+    }
+
+    for (int page=0x80; page<=last; page++)
+    {
+        if (page == 0xBF) continue;     // The IO page stays put
+        mem_read_page[page]  = upper + (page << 8);
+        mem_write_page[page] = upper + (page << 8);
+    }
+
+    return last;
+}
+
+/*------------------------------------------------
+ * mem_map_build_mcx()
+ *
+ *  Overlay the MCX-128 banking onto the page table.
+ *  Switching banks only ever changes these pointers.
+ *
+ *  ROM map register (0xBF01) bits 0-1:
+ *   0 - 16K MCX ROM at C000-FFFF
+ *   1 - RAM at C000-DFFF, upper 8K of the MCX ROM at E000-FFFF
+ *   2 - MC-10 compatible (8K MICROBASIC mirrored at C000 and E000)
+ *   3 - RAM at C000-FEFF, the last MCX ROM page (vectors) at FF00-FFFF
+ *  The RAM at C000-FEFF comes from the bank selected for 8000-BEFF.
+ */
+static void mem_map_build_mcx(void)
 {
-    uint8_t ret = 0x04; // No RS232 input
+    // Without the MCX ROM we can only run MICROBASIC
+    uint8_t mode = bMCX_found ? mcx_rom_bank : 2;
 
-    for (int i=0; i<kbd_keys_pressed; i++)
+    int last = mem_map_ram_mcx(mode);
+
+    for (int page=((last > 0xBF) ? last+1 : 0xC0); page<0x100; page++)
     {
-        uint8_t scan_code = (uint8_t) kbd_keys[i];
+        mem_read_page[page]  = (mode == 2) ? (MC10BASIC + ((page & 0x1F) << 8)) : (MCXBASIC + ((page - 0xC0) << 8));
+        mem_write_page[page] = write_sink_page;
+    }
+}
 
-        if (((Memory[2] & 0x01) == 0))
+/*------------------------------------------------
+ * mem_map_finish()
+ *
+ *  The last pass over a range of pages once their
+ *  read and write pointers are in place - writes to
+ *  the part of bank 0 the VDG is displaying are
+ *  tracked (so it only redraws what changed) and
+ *  op-code fetches never go through the IO handlers
+ *  or the floating bus.
+ *
+ *  param:  First and last page
+ *  return: Nothing
+ */
+static void mem_map_finish(int first, int last)
+{
+    for (int page=first; page<=last; page++)
+    {
+        if ((page >= 0x40) && (page < 0x40+mem_video_pages) && (mem_write_page[page] == Memory + (page << 8)))
         {
-            if ((scan_code == KBD_CTRL) || ctrl_key) ret |= 0x02;
+            mem_write_page[page]    = NULL;
+            mem_write_handler[page] = video_mem_write;
         }
 
-        if ((Memory[2] & 0x04) == 0)
+        uint8_t *fetch = mem_read_page[page];
+        if ((fetch == NULL) || (fetch == floating_bus_page)) fetch = Memory + (page << 8);
+        mem_fetch_page[page] = fetch;
+    }
+}
+
+/*------------------------------------------------
+ * mem_map_build()
+ *
+ *  Fill in the page table for the current machine type.
+ *  Must be called whenever the machine or the memory
+ *  model changes (including after a state restore).
+ *
+ *  Page  00      CPU registers (handled ahead of the table) + internal RAM
+ *  Pages 01-3F   Unmapped - floating bus (RAM on the MCX)
+ *  Pages 40-xx   External RAM up to io_start
+ *  Pages io-BF   IO - keyboard / VDG / sound (and MCX banking registers)
+ *  Pages C0-FF   ROM - writes are ignored
+ */
+void mem_map_build(void)
+{
+    for (int i=0; i<256; i++)
+    {
+        floating_bus_page[i] = i;
+    }
+
+    for (int page=0; page<256; page++)
+    {
+        uint8_t *ram = Memory + (page << 8);
+        uint32_t address = page << 8;
+
+        mem_read_handler[page]  = io_read;
+        mem_write_handler[page] = io_write;
+
+        if (address < 0x100)                // Internal MC6803 RAM
         {
-            if (scan_code == KBD_BREAK) ret |= 0x02;
+            mem_read_page[page]  = ram;
+            mem_write_page[page] = ram;
         }
-
-        if (((Memory[2] & 0x80) == 0))
+        else if (address < 0x4000)          // Unmapped but the MCX has RAM here
+        {
+            mem_read_page[page]  = (myConfig.machine == MACHINE_MCX) ? ram : floating_bus_page;
+            mem_write_page[page] = (myConfig.machine == MACHINE_MCX) ? ram : write_sink_page;
+        }
+        else if (address < io_start)        // 4K internal + 16K expansion (or up to 0xBEFF for 32K)
+        {
+            mem_read_page[page]  = ram;
+            mem_write_page[page] = ram;
+        }
+        else if (address < 0xC000)          // IO
+        {
+            mem_read_page[page]  = NULL;
+            mem_write_page[page] = NULL;
+        }
+        else                                // ROM
         {
-            if ((scan_code == KBD_SHIFT) || shift_key) ret |= 0x02;
+            mem_read_page[page]  = ram;
+            mem_write_page[page] = write_sink_page;
         }
     }
 
-    return ~ret;
+    if (myConfig.machine == MACHINE_MCX)
+    {
+        mem_map_build_mcx();
+    }
+
+    mem_map_finish(0x00, 0xFF);
+
+    // Let the CPU know if the ROM it has decoded has been switched out
+    cpu_decode_map();
+}
+
+/*------------------------------------------------
+ * mem_track_video()
+ *
+ *  Called by the VDG when the display mode changes
+ *  to have writes to the first 'pages' pages of
+ *  video memory (from 0x4000) mark the screen dirty.
+ */
+void mem_track_video(int pages)
+{
+    if (pages != mem_video_pages)
+    {
+        mem_video_pages = pages;
+        mem_map_build();
+    }
+}
+
+// ------------------------------------------------------------------------
+// A write to RAM the VDG is displaying. The byte is stored as usual and
+// the 32 byte chunk it belongs to is flagged for the next vdg_render().
+// Writing back the same value (e.g. BASIC re-printing a line) is free.
+// ------------------------------------------------------------------------
+ITCM_CODE void video_mem_write(int address, int data)
+{
+    if (Memory[address] != (uint8_t) data)
+    {
+        Memory[address] = (uint8_t) data;
+        mem_video_dirty[(address - 0x4000) >> 5] = 1;
+    }
 }
 
 // -------------------------------------------------------------------------
-// This is the keyboard port that is normally read at 0xbfff and contains
-// all pressable keys on the MC-10 except SHIFT, CONTROL and BREAK which
-// are handled by the read at port Memory[3]. The value written to Memory[2]
-// will indicate which columns are being scanned (a 0-bit represents an
-// active column). Here is the layout of the keymap:
+// The MC-10 keyboard matrix... Memory[2] selects the column(s) being scanned
+// (a 0-bit represents an active column) and the rows are read back from the
+// keyboard port at 0xbfff. Here is the layout of the keymap:
 //
 //   Column 0   1   2   3   4   5   6   7
 //Row-0:    @   A   B   C   D   E   F   G
@@ -121,98 +304,93 @@ ITCM_CODE uint8_t read_kbd_lo(void)
 //Row-3:    X   Y   Z              ENT SPC
 //Row-4:    0   1   2   3   4   5   6   7
 //Row-5:    8   9   :   ;   ,   -   .   /
+//
+// SHIFT, CONTROL and BREAK are read back on Port 2 (Memory[3]) instead and
+// are picked up when column 7, 0 and 2 respectively are being scanned.
+//
+// Rather than working through the pressed keys on every port read, the
+// input stage calls kbd_build_matrix() once per frame and the port reads
+// just AND the active columns against the matrix.
 // -------------------------------------------------------------------------
-ITCM_CODE uint8_t read_kbd_hi(void)
+#define KBD_POS(row, col)   (0x80 | ((row) << 3) | (col))
+
+static const uint8_t kbd_position[] =
 {
-    uint8_t ret = 0x00;
+    [KBD_ATSIGN] = KBD_POS(0,0), [KBD_A] = KBD_POS(0,1), [KBD_B] = KBD_POS(0,2), [KBD_C]    = KBD_POS(0,3),
+    [KBD_D]      = KBD_POS(0,4), [KBD_E] = KBD_POS(0,5), [KBD_F] = KBD_POS(0,6), [KBD_G]    = KBD_POS(0,7),
+    [KBD_H]      = KBD_POS(1,0), [KBD_I] = KBD_POS(1,1), [KBD_J] = KBD_POS(1,2), [KBD_K]    = KBD_POS(1,3),
+    [KBD_L]      = KBD_POS(1,4), [KBD_M] = KBD_POS(1,5), [KBD_N] = KBD_POS(1,6), [KBD_O]    = KBD_POS(1,7),
+    [KBD_P]      = KBD_POS(2,0), [KBD_Q] = KBD_POS(2,1), [KBD_R] = KBD_POS(2,2), [KBD_S]    = KBD_POS(2,3),
+    [KBD_T]      = KBD_POS(2,4), [KBD_U] = KBD_POS(2,5), [KBD_V] = KBD_POS(2,6), [KBD_W]    = KBD_POS(2,7),
+    [KBD_X]      = KBD_POS(3,0), [KBD_Y] = KBD_POS(3,1), [KBD_Z] = KBD_POS(3,2),
+    [KBD_ENTER]  = KBD_POS(3,6), [KBD_SPACE] = KBD_POS(3,7),
+    [KBD_0]      = KBD_POS(4,0), [KBD_1] = KBD_POS(4,1), [KBD_2] = KBD_POS(4,2), [KBD_3]    = KBD_POS(4,3),
+    [KBD_4]      = KBD_POS(4,4), [KBD_5] = KBD_POS(4,5), [KBD_6] = KBD_POS(4,6), [KBD_7]    = KBD_POS(4,7),
+    [KBD_8]      = KBD_POS(5,0), [KBD_9] = KBD_POS(5,1), [KBD_COLON] = KBD_POS(5,2), [KBD_SEMI] = KBD_POS(5,3),
+    [KBD_COMMA]  = KBD_POS(5,4), [KBD_DASH] = KBD_POS(5,5), [KBD_PERIOD] = KBD_POS(5,6), [KBD_SLASH] = KBD_POS(5,7),
+};
+
+// -------------------------------------------------------------------------
+// Called once per frame after the input stage has filled in kbd_keys[] to
+// turn the pressed keys into the row/column matrix read by the CPU.
+// -------------------------------------------------------------------------
+void kbd_build_matrix(void)
+{
+    memset(kbd_matrix, 0x00, sizeof(kbd_matrix));
+    kbd_special = 0x00;
 
-    // ------------------------------------------------------
-    // For each key that was pressed, we need to run through
-    // the scan algorithm. The MC-10 program will write to
-    // Memory[2] to set the column(s) they are interested in
-    // scanning and this routine will read out the row bit.
-    // ------------------------------------------------------
     for (int i=0; i<kbd_keys_pressed; i++)
     {
         uint8_t scan_code = (uint8_t) kbd_keys[i];
-        
-        if ((Memory[2] & 0x01) == 0)
-        {
-            if (scan_code == KBD_ATSIGN)ret |= 0x01;
-            if (scan_code == KBD_H)     ret |= 0x02;
-            if (scan_code == KBD_P)     ret |= 0x04;
-            if (scan_code == KBD_X)     ret |= 0x08;
-            if (scan_code == KBD_0)     ret |= 0x10;
-            if (scan_code == KBD_8)     ret |= 0x20;
-        }
 
-        if ((Memory[2] & 0x02) == 0)
+        if      (scan_code == KBD_CTRL)  kbd_special |= 0x01;
+        else if (scan_code == KBD_BREAK) kbd_special |= 0x04;
+        else if (scan_code == KBD_SHIFT) kbd_special |= 0x80;
+        else if (scan_code < sizeof(kbd_position) && kbd_position[scan_code])
         {
-            if (scan_code == KBD_A)     ret |= 0x01;
-            if (scan_code == KBD_I)     ret |= 0x02;
-            if (scan_code == KBD_Q)     ret |= 0x04;
-            if (scan_code == KBD_Y)     ret |= 0x08;
-            if (scan_code == KBD_1)     ret |= 0x10;
-            if (scan_code == KBD_9)     ret |= 0x20;
+            uint8_t pos = kbd_position[scan_code];
+            kbd_matrix[(pos >> 3) & 7] |= (1 << (pos & 7));
         }
+    }
 
-        if ((Memory[2] & 0x04) == 0)
-        {
-            if (scan_code == KBD_B)     ret |= 0x01;
-            if (scan_code == KBD_J)     ret |= 0x02;
-            if (scan_code == KBD_R)     ret |= 0x04;
-            if (scan_code == KBD_Z)     ret |= 0x08;
-            if (scan_code == KBD_2)     ret |= 0x10;
-            if (scan_code == KBD_COLON) ret |= 0x20;
-        }
+    // The sticky on-screen SHIFT and CTRL keys apply along with any other key
+    if (kbd_keys_pressed)
+    {
+        if (ctrl_key)  kbd_special |= 0x01;
+        if (shift_key) kbd_special |= 0x80;
+    }
+}
 
-        if ((Memory[2] & 0x08) == 0)
-        {
-            if (scan_code == KBD_C)     ret |= 0x01;
-            if (scan_code == KBD_K)     ret |= 0x02;
-            if (scan_code == KBD_S)     ret |= 0x04;
-            if (scan_code == KBD_3)     ret |= 0x10;
-            if (scan_code == KBD_SEMI)  ret |= 0x20;
-        }
+// ------------------------------------------------------------------------
+// Port 2 (memory address 0x0003) has 3 special keyboard keys mapped into
+// it... SHIFT, CONTROL and BREAK. Depending on what value was written to
+// Memory[2], we could be scanning for one or more of these special keys.
+// ------------------------------------------------------------------------
+ITCM_CODE uint8_t read_kbd_lo(void)
+{
+    uint8_t ret = 0x04; // No RS232 input
 
-        if ((Memory[2] & 0x10) == 0)
-        {
-            if (scan_code == KBD_D)     ret |= 0x01;
-            if (scan_code == KBD_L)     ret |= 0x02;
-            if (scan_code == KBD_T)     ret |= 0x04;
-            if (scan_code == KBD_4)     ret |= 0x10;
-            if (scan_code == KBD_COMMA) ret |= 0x20;
-        }
+    if (kbd_special & ~Memory[2]) ret |= 0x02;
 
-        if ((Memory[2] & 0x20) == 0)
-        {
-            if (scan_code == KBD_E)     ret |= 0x01;
-            if (scan_code == KBD_M)     ret |= 0x02;
-            if (scan_code == KBD_U)     ret |= 0x04;
-            if (scan_code == KBD_5)     ret |= 0x10;
-            if (scan_code == KBD_DASH)  ret |= 0x20;
-        }
+    return ~ret;
+}
 
-        if ((Memory[2] & 0x40) == 0)
-        {
-            if (scan_code == KBD_F)     ret |= 0x01;
-            if (scan_code == KBD_N)     ret |= 0x02;
-            if (scan_code == KBD_V)     ret |= 0x04;
-            if (scan_code == KBD_ENTER) ret |= 0x08;
-            if (scan_code == KBD_6)     ret |= 0x10;
-            if (scan_code == KBD_PERIOD)ret |= 0x20;
-        }
+// -------------------------------------------------------------------------
+// This is the keyboard port that is normally read at 0xbfff and contains
+// all pressable keys on the MC-10 except SHIFT, CONTROL and BREAK which
+// are handled by the read at port Memory[3].
+// -------------------------------------------------------------------------
+ITCM_CODE uint8_t read_kbd_hi(void)
+{
+    uint8_t columns = ~Memory[2];
+    uint8_t ret = 0x00;
 
-        if ((Memory[2] & 0x80) == 0)
-        {
-            if (scan_code == KBD_G)     ret |= 0x01;
-            if (scan_code == KBD_O)     ret |= 0x02;
-            if (scan_code == KBD_W)     ret |= 0x04;
-            if (scan_code == KBD_SPACE) ret |= 0x08;
-            if (scan_code == KBD_7)     ret |= 0x10;
-            if (scan_code == KBD_SLASH) ret |= 0x20;
-        }
-    }
+    if (kbd_matrix[0] & columns) ret |= 0x01;
+    if (kbd_matrix[1] & columns) ret |= 0x02;
+    if (kbd_matrix[2] & columns) ret |= 0x04;
+    if (kbd_matrix[3] & columns) ret |= 0x08;
+    if (kbd_matrix[4] & columns) ret |= 0x10;
+    if (kbd_matrix[5] & columns) ret |= 0x20;
 
     // -------------------------------------------------------------
     // The upper two bits aren't used... we return 11 for those
@@ -221,6 +399,16 @@ ITCM_CODE uint8_t read_kbd_hi(void)
     return ~ret;
 }
 
+// -------------------------------------------------------------------
+// A read anywhere in the IO area is a read of the keyboard port. Even
+// on the MCX, the banking registers at 0xBF00/0xBF01 are write only.
+// -------------------------------------------------------------------
+ITCM_CODE uint8_t io_read(int address)
+{
+    kbd_polled = 1;
+    return read_kbd_hi();
+}
+
 // --------------------------------------------------------------
 // This is called whenever a memory address has been accessed
 // that is normally unmapped. This generally returns the low
@@ -251,10 +439,9 @@ ITCM_CODE void unmapped_memory_write(int address, int data)
 
 // ----------------------------------------------------------------------------
 // An MCX IO write which may bank RAM or ROM. We keep this out of fast memory
-// as it takes up a bit of space and we don't call this very often normally.
-// Beyond that... we are only supporting a very limited subset of the RAM bank
-// handling - just enough to allow the video memory to be handled separate
-// from the main MCXBASIC memory - this allows the 'Large' model to run.
+// as we don't call this very often normally. Banking is handled entirely by
+// re-pointing the page table so it costs the same no matter how much of the
+// 128K the software is using or how often it flips banks.
 // ----------------------------------------------------------------------------
 __attribute__((noinline)) void mcx_io_write(int address, int data)
 {
@@ -262,42 +449,12 @@ __attribute__((noinline)) void mcx_io_write(int address, int data)
 
     switch (address & 1)
     {
-        case 0x00:  // RAM Banking
-            if (mcx_ram_bank0 != (data & 1))
+        case 0x00:  // RAM Banking - only the RAM pages are re-pointed (the ROM map is unchanged)
+            if ((mcx_ram_bank0 != (data & 1)) || (mcx_ram_bank1 != ((data & 2) >> 1)))
             {
                 mcx_ram_bank0 = (data & 1);
-                // ----------------------------------------------------------------
-                // I have yet to see any real-world MCX program swap bank 0 out...
-                // so until I have something to use, we do nothing here.
-                // ----------------------------------------------------------------
-            }
-            if (mcx_ram_bank1 != ((data & 2) >> 1))
-            {
                 mcx_ram_bank1 = ((data & 2) >> 1);
-
-                // -----------------------------------------------------------------------------------------------------
-                // Switch-a-roo!
-                // There are so few programs that take advantage of the banked memory that we are willing to do this
-                // swap slowly and keep the normal Memory read/write routines fast - it's not worth adding banking
-                // pointers to slow down 99% of software when this works fine for the few MCX programs that need the
-                // extra memory... So far, only the MCX Large Memory Model (48K) utilizes this banking.
-                //
-                // For now we are only swapping 4K of this bank - that's the video memory (4K) at main memory 0x4000.
-                // That's all that is needed to get the MCX BASIC 'Large' model to run properly. If a program tries
-                // to utilize more memory than the 48K in the secondary bank plus the 4K Video in the primary bank,
-                // this emulation won't handle it. If and when the time comes for MCX BASIC games to utilize lots of
-                // the swappable RAM, we will adjust (but it's unlikely as the latest MCX board is only 32K in RAM.
-                // -----------------------------------------------------------------------------------------------------
-                uint32_t tmp;
-                uint32_t *s32 = (uint32_t *)(Memory+0x4000);
-                uint32_t *d32 = (uint32_t *)(Memory_MCX);
-                for (int i=0; i<256; i++) // Copy the 4K Video Memory from 'dtcm' fast memory 16 bytes at a time
-                {
-                    tmp = *s32;  *s32++ = *d32;  *d32++ = tmp;
-                    tmp = *s32;  *s32++ = *d32;  *d32++ = tmp;
-                    tmp = *s32;  *s32++ = *d32;  *d32++ = tmp;
-                    tmp = *s32;  *s32++ = *d32;  *d32++ = tmp;
-                }
+                mem_map_finish(0x01, mem_map_ram_mcx(bMCX_found ? mcx_rom_bank : 2));
             }
             break;
 
@@ -307,18 +464,21 @@ __attribute__((noinline)) void mcx_io_write(int address, int data)
                 mcx_rom_bank = (data & 3);
 
                 // ---------------------------------------------------------------
-                // The only ROM banking we are supporting is switching in of the
-                // stock 8K MICROBASIC which is option [0] on the MCX main menu.
+                // Switching in the stock 8K MICROBASIC (option [0] on the MCX
+                // main menu) puts the MCX into MC-10 mode and resets the CPU.
                 // ---------------------------------------------------------------
                 if (mcx_rom_bank == 2)
                 {
-                    mem_load_rom(0xc000, MC10BASIC, sizeof(MC10BASIC)); // Mirror of 8K BASIC
-                    mem_load_rom(0xe000, MC10BASIC, sizeof(MC10BASIC)); // ROM normally runs here
                     mcx_ram_bank0 = 0;
                     mcx_ram_bank1 = 0;
+                    mem_map_build();
                     cpu_reset(1);
                     cpu_check_reset();
                 }
+                else
+                {
+                    mem_map_build();
+                }
             }
             break;
     }
@@ -332,10 +492,7 @@ __attribute__((noinline)) void mcx_io_write(int address, int data)
 ITCM_CODE void io_write(int address, int data)
 {
     // --------------------------------------------------------------------------------------
-    // This is a "poor-man" implementation of MCX banking. We aren't supporting the banking
-    // beyond allowing the video memory to be managed by the MCX 'Large Model' in another
-    // bank. To that end, the MCXBASIC 'Large' model appears to be swapping the middle bank
-    // in order to keep the video memory on the main bank 0 RAM and utilizing bank 1 as the
+    // The MCXBASIC 'Large' model keeps the video memory in bank 0 RAM and uses bank 1 as the
     // place for BASIC and related vars... this allows for an almost 48K BASIC memory free.
     // --------------------------------------------------------------------------------------
     if (myConfig.machine == MACHINE_MCX && (mcx_rom_bank != 2))
@@ -356,9 +513,8 @@ ITCM_CODE void io_write(int address, int data)
     // -------------------------------------------------------
     // Otherwise this is the normal MC-10 VDG/Keyboard port...
     // -------------------------------------------------------
-    extern s16 beeper_vol;
     Memory[0xbfff] = (uint8_t) data;
-    beeper_vol = (data & 0x80) ? 0x1AFF : 0;
+    beeper_edge(cpu_line_cycles, (data & 0x80) ? BEEPER_HIGH : 0);
 }
 
 // =========================================================
@@ -395,22 +551,28 @@ ITCM_CODE void cpu_reg_write(int address, int data)
             break;
 
         case 0x09:  // Counter High Byte
+            cpu_timer_sync();
             cpu.counter = 0xfff8; // Any write to the high-byte sets this as the counter
+            cpu_next_event = 0;   // Have cpu_run() reschedule the timer
             break;
 
         case 0x0A:  // Counter Low Byte
             break;  // The counter is read-only except for the specific write to the high byte directly above
 
         case 0x0B:  // Compare High Byte
+            cpu_timer_sync();
             Memory[0x08] &= ~TCSR_OCF;
             cpu.compare = (uint16_t)data << 8;
             Memory[address] = data;
+            cpu_next_event = 0;
             break;
 
         case 0x0C:  // Compare Low Byte
+            cpu_timer_sync();
             Memory[0x08] &= ~TCSR_OCF;
             cpu.compare |= data;
             Memory[address] = data;
+            cpu_next_event = 0;
             break;
 
         default:
@@ -433,7 +595,13 @@ ITCM_CODE uint8_t cpu_reg_read(int address)
             return read_kbd_lo() & tape_read();
             break;
 
+        case 0x08:  // Timer Control and Status
+            cpu_timer_sync();
+            return Memory[address];
+            break;
+
         case 0x09:  // Counter high byte
+            cpu_timer_sync();
             Memory[0x08] &= ~TCSR_TOF;
             counter_read_latch = (cpu.counter & 0xFF);
             return (cpu.counter >> 8) & 0xFF;
@@ -462,4 +630,6 @@ void mem_load_rom(int addr_start, const uint8_t *buffer, int length)
     {
         Memory[(i+addr_start)] = buffer[i];
     }
+
+    cpu_decode_flush();     // Anything decoded from the old ROM is gone
 }
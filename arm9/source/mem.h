@@ -20,13 +20,41 @@
 extern unsigned int debug[];
 
 extern uint8_t  Memory[MEMORY_SIZE];      // 64K RAM for main memory
-extern uint8_t  Memory_MCX[0x1000];       //  4K RAM for MCX video memory paging
+extern uint8_t  Memory_MCX[0x10000];      // 64K RAM for the second MCX-128 bank
 extern uint8_t  counter_read_latch;
 extern uint8_t  mcx_ram_bank0;
 extern uint8_t  mcx_ram_bank1;
 extern uint8_t  mcx_rom_bank;
 extern uint32_t io_start;
 extern uint8_t  cpu_timer_control;
+extern uint8_t  kbd_polled;
+
+// ------------------------------------------------------------------------
+// The memory map is a table of 256 pages (256 bytes each). A page either
+// points straight at the 256 bytes backing it (RAM, ROM, the floating bus
+// or the write-sink for read-only areas) or is NULL in which case the
+// handler for that page is called (I/O). The CPU registers in the first
+// 128 bytes are always checked before the page table is consulted.
+// ------------------------------------------------------------------------
+typedef uint8_t (*mem_read_handler_t)(int address);
+typedef void    (*mem_write_handler_t)(int address, int data);
+
+extern uint8_t            *mem_read_page[256];
+extern uint8_t            *mem_write_page[256];
+extern uint8_t            *mem_fetch_page[256];
+extern mem_read_handler_t  mem_read_handler[256];
+extern mem_write_handler_t mem_write_handler[256];
+extern uint8_t             write_sink_page[256];
+
+// ------------------------------------------------------------------------
+// Video RAM (4000-57FF at most) is tracked in 32 byte chunks - one row of
+// text or one or two lines of the graphics modes - so the VDG can skip redrawing
+// anything that hasn't been written since the last frame.
+// ------------------------------------------------------------------------
+#define MEM_VIDEO_CHUNKS    (0x1800 >> 5)
+
+extern uint8_t             mem_video_dirty[MEM_VIDEO_CHUNKS];
+extern uint8_t             mem_video_pages;
 
 // These are for Register at Memory[8]
 #define TCSR_OLVL   0x01  // Output Level
@@ -40,17 +68,30 @@ extern uint8_t  cpu_timer_control;
 
 
 extern void     mem_init(void);
+extern void     mem_map_build(void);
+extern void     mem_track_video(int pages);
+extern void     video_mem_write(int address, int data);
 extern void     mem_load_rom(int addr_start, const uint8_t *buffer, int length);
 extern void     cpu_reg_write(int address, int data);
 extern uint8_t  cpu_reg_read(int address);
+extern void     kbd_build_matrix(void);
 extern uint8_t  read_kbd_lo(void);
 extern uint8_t  read_kbd_hi(void);
 extern uint8_t  unmapped_memory_read(int address);
 extern void     unmapped_memory_write(int address, int data);
 extern void     io_write(int address, int data);
+extern uint8_t  io_read(int address);
 
-// For when we know it's a PC read and won't be registers...
-#define mem_read_pc(addr) (Memory[addr])
+/*------------------------------------------------
+ * mem_read_pc()
+ *
+ *  For when we know it's a PC read and won't be
+ *  registers or IO... straight from the fetch page.
+ */
+inline __attribute__((always_inline)) uint8_t mem_read_pc(int address)
+{
+    return mem_fetch_page[address >> 8][address & 0xFF];
+}
 
 /*------------------------------------------------
  * mem_read()
@@ -64,9 +105,9 @@ inline __attribute__((always_inline)) uint8_t mem_read(int address)
 {
     if (address & 0xFF80)
     {
-        if (address >= io_start && address <= 0xbfff) return read_kbd_hi();
-        else if (address > 0x100 && address < 0x4000) return unmapped_memory_read(address); // Unmapped region returns floating bus address 
-        return Memory[address];
+        uint8_t *page = mem_read_page[address >> 8];
+        if (page) return page[address & 0xFF];      // RAM, ROM or floating bus
+        return mem_read_handler[address >> 8](address); // IO
     }
     else // Within the first 128 bytes, we're in the CPU register area
     {
@@ -87,21 +128,9 @@ inline __attribute__((always_inline)) void mem_write(int address, int data)
 {
     if (address & 0xFF80)
     {
-         // The starting IO address is different depending on the memory model
-         if (address >= io_start && address <= 0xbfff)
-         {
-             io_write(address, data);
-         }
-         // 20K RAM includes the built-in 4K and the 16K Expansion
-         else if (address >= 0x4000 && address < io_start)
-         {
-            Memory[address] = (uint8_t) data;
-         }
-         else if (address < 0x100) // RAM internal to the MC6803
-         {
-            Memory[address] = (uint8_t) data;
-         }
-         else unmapped_memory_write(address, data);
+        uint8_t *page = mem_write_page[address >> 8];
+        if (page) page[address & 0xFF] = (uint8_t) data; // RAM or the write-sink for ROM and unmapped areas
+        else mem_write_handler[address >> 8](address, data); // IO
     }
     else cpu_reg_write(address, data);
 }
@@ -0,0 +1,377 @@
+// =====================================================================================
+// Copyright (c) 2025 Dave Bernazzani (wavemotion-dave)
+//
+// Copying and distribution of this emulator, its source code and associated
+// readme files, with or without modification, are permitted in any medium without
+// royalty provided this copyright notice is used and wavemotion-dave and eyalabraham
+// (Dragon 32 emu core) are thanked profusely.
+//
+// The Micro-DS emulator is offered as-is, without any warranty. Please see readme.md
+// =====================================================================================
+
+/********************************************************************
+ * rewind.c
+ *
+ *  Rewind buffer. Every REWIND_INTERVAL frames a rewind point is added
+ *  to a ring buffer of fixed size, the oldest points making way for the
+ *  newest. Most points only hold the snapshot pages (see snapshot.h)
+ *  that have changed since the last keyframe - which is a whole snapshot
+ *  compressed with lzav and is taken every REWIND_KEY_INTERVAL points.
+ *  Any point can be put back with its keyframe plus its own pages.
+ *
+ *  Finding the changed pages is a compare of the running machine against
+ *  the last keyframe (kept uncompressed) so there's no copy of the whole
+ *  machine on most rewind points - only the pages that differ.
+ *
+ *  The working buffers next to the ring are sized for the snapshot of
+ *  the machine being emulated (the MCX-128's is well over twice the
+ *  MC-10's) and are sized again when a reset changes the machine type.
+ *
+ *******************************************************************/
+#include    <nds.h>
+#include    <stdlib.h>
+#include    <string.h>
+
+#include    "snapshot.h"
+#include    "rewind.h"
+#include    "lzav.h"
+
+#define REWIND_MAX_POINTS   1024            // Most rewind points the ring can hold
+#define REWIND_HASH_SIZE    (16*1024)       // lzav hash table - small is quicker on the DS
+
+// ------------------------------------------------------------------------
+// A rewind point is either a keyframe (the whole snapshot compressed) or
+// a run of records each being a page number (32 bits so the pages stay
+// word aligned) followed by that page as it was at this point.
+// ------------------------------------------------------------------------
+typedef struct
+{
+    uint32_t    offset;                 // Where it is in the ring buffer
+    uint32_t    size;                   // Bytes it takes in the ring buffer
+    uint8_t     keyframe;               // 1 if a whole (compressed) snapshot
+} rewind_point_t;
+
+#define REWIND_RECORD       (sizeof(uint32_t) + SNAPSHOT_PAGE)
+
+static rewind_point_t rewind_point[REWIND_MAX_POINTS];
+
+uint32_t rewind_points          = 0;        // How many rewind points we have
+static uint32_t rewind_head     = 0;        // The newest rewind point
+static uint32_t rewind_write    = 0;        // Where the next one goes in the ring buffer
+
+static uint8_t *rewind_memory   = NULL;     // Everything below is carved out of this
+static uint8_t *rewind_hash     = NULL;     // lzav hash table
+static uint8_t *rewind_key      = NULL;     // The keyframe the newest rewind point is based on (uncompressed)
+static uint8_t *rewind_work     = NULL;     // Where a rewind point is put together
+static uint8_t *rewind_ring     = NULL;     // The ring buffer itself
+static uint32_t rewind_ring_size = 0;
+static uint32_t rewind_sized     = 0;       // snapshot_size() the buffers above were carved out for
+
+static int32_t  rewind_key_point = -1;      // Which rewind point is in rewind_key[] (-1 if none)
+static uint32_t rewind_key_size  = 0;       // snapshot_size() when that keyframe was taken
+static int      rewind_deltas    = 0;       // Rewind points since the last keyframe
+static int      rewind_frames    = 0;       // Frames since the last rewind point
+static uint8_t  rewind_stepped   = 0;       // Set when we've stepped back to the newest rewind point
+
+/*------------------------------------------------
+ * rewind_init()
+ *
+ *  Get the rewind buffer ready. Can be called
+ *  again to change the size.
+ *
+ *  param:  Bytes the ring of rewind points may use
+ *  return: 1 if the memory was there, 0 if not
+ */
+int rewind_init(uint32_t memory)
+{
+    rewind_free();
+
+    uint32_t size = snapshot_size();
+
+    rewind_memory = malloc(REWIND_HASH_SIZE + size + SNAPSHOT_COMPRESS(size) + memory);
+    if (!rewind_memory) return 0;
+
+    rewind_hash      = rewind_memory;
+    rewind_key       = rewind_hash + REWIND_HASH_SIZE;
+    rewind_work      = rewind_key + size;
+    rewind_ring      = rewind_work + SNAPSHOT_COMPRESS(size);
+    rewind_ring_size = memory;
+    rewind_sized     = size;
+
+    rewind_reset();
+
+    return 1;
+}
+
+/*------------------------------------------------
+ * rewind_free()
+ *
+ *  Give back the rewind buffer memory (rewind is
+ *  turned off until rewind_init() is called).
+ *
+ *  param:  Nothing
+ *  return: Nothing
+ */
+void rewind_free(void)
+{
+    if (rewind_memory) free(rewind_memory);
+
+    rewind_memory    = NULL;
+    rewind_ring_size = 0;
+    rewind_sized     = 0;
+    rewind_points    = 0;
+}
+
+/*------------------------------------------------
+ * rewind_reset()
+ *
+ *  Forget all the rewind points - the machine has
+ *  been reset or changed. A new machine type with
+ *  a different size of snapshot gets the working
+ *  buffers sized again (the ring stays the size
+ *  it was given).
+ *
+ *  param:  Nothing
+ *  return: Nothing
+ */
+void rewind_reset(void)
+{
+    if (rewind_memory && (rewind_sized != snapshot_size()))
+    {
+        rewind_init(rewind_ring_size);  // Comes back here with the new size (or rewind is off)
+        return;
+    }
+
+    rewind_points    = 0;
+    rewind_head      = REWIND_MAX_POINTS - 1;
+    rewind_write     = 0;
+    rewind_key_point = -1;
+    rewind_deltas    = 0;
+    rewind_frames    = 0;
+    rewind_stepped   = 0;
+}
+
+// The oldest rewind point still in the ring
+static inline uint32_t rewind_tail(void)
+{
+    return (rewind_head + REWIND_MAX_POINTS + 1 - rewind_points) % REWIND_MAX_POINTS;
+}
+
+/*------------------------------------------------
+ * rewind_drop_oldest()
+ *
+ *  Drop the oldest rewind point. If that was a
+ *  keyframe, the rewind points based on it are
+ *  no use any more and are dropped with it.
+ *
+ *  param:  Nothing
+ *  return: Nothing
+ */
+static void rewind_drop_oldest(void)
+{
+    do
+    {
+        if ((int32_t)rewind_tail() == rewind_key_point) rewind_key_point = -1;
+        rewind_points--;
+    }
+    while (rewind_points && !rewind_point[rewind_tail()].keyframe);
+}
+
+/*------------------------------------------------
+ * rewind_add()
+ *
+ *  Add what's in rewind_work[] as the newest
+ *  rewind point, making room in the ring by
+ *  dropping the oldest as needed.
+ *
+ *  param:  Size, 1 if a keyframe
+ *  return: 1 if added, 0 if it was no longer of any use
+ */
+static int rewind_add(uint32_t size, uint8_t keyframe)
+{
+    uint32_t pos = rewind_write;
+
+    if (size > rewind_ring_size) return 0;
+    if (rewind_points == REWIND_MAX_POINTS) rewind_drop_oldest();
+
+    // Won't fit before the end of the ring? Anything past here is older than what's at the start
+    if (pos + size > rewind_ring_size)
+    {
+        while (rewind_points && (rewind_point[rewind_tail()].offset >= pos)) rewind_drop_oldest();
+        pos = 0;
+    }
+
+    while (rewind_points && (rewind_point[rewind_tail()].offset < pos + size) &&
+           (rewind_point[rewind_tail()].offset + rewind_point[rewind_tail()].size > pos))
+    {
+        rewind_drop_oldest();
+    }
+
+    if (!keyframe && (rewind_key_point < 0)) return 0;  // Its keyframe had to go
+
+    memcpy(rewind_ring + pos, rewind_work, size);
+
+    rewind_head = (rewind_head + 1) % REWIND_MAX_POINTS;
+    rewind_point[rewind_head].offset   = pos;
+    rewind_point[rewind_head].size     = size;
+    rewind_point[rewind_head].keyframe = keyframe;
+    rewind_points++;
+    rewind_write = pos + size;
+
+    return 1;
+}
+
+/*------------------------------------------------
+ * rewind_add_keyframe()
+ *
+ *  Add a rewind point with the whole machine in it.
+ *
+ *  param:  Nothing
+ *  return: Nothing
+ */
+static void rewind_add_keyframe(void)
+{
+    uint32_t size = snapshot_save(rewind_key);
+    int comp_len = lzav_compress(rewind_key, rewind_work, size, SNAPSHOT_COMPRESS_MAX, rewind_hash, REWIND_HASH_SIZE);
+
+    rewind_deltas    = 0;
+    rewind_key_size  = size;
+    rewind_key_point = -1;
+
+    if (comp_len && (comp_len <= rewind_ring_size / 2) && rewind_add(comp_len, 1))
+    {
+        rewind_key_point = rewind_head;
+    }
+}
+
+/*------------------------------------------------
+ * rewind_frame()
+ *
+ *  Called at the end of every frame. Every few
+ *  frames a rewind point is added.
+ *
+ *  param:  Nothing
+ *  return: Nothing
+ */
+void rewind_frame(void)
+{
+    if (!rewind_memory) return;
+    if (rewind_sized != snapshot_size()) rewind_reset();    // The machine type changed under us
+    if (!rewind_memory || (++rewind_frames < REWIND_INTERVAL)) return;
+
+    rewind_frames  = 0;
+    rewind_stepped = 0;
+
+    uint32_t pages = snapshot_size() / SNAPSHOT_PAGE;
+
+    // A keyframe is due
+    if ((rewind_key_point < 0) || (rewind_deltas >= REWIND_KEY_INTERVAL))
+    {
+        rewind_add_keyframe();
+        return;
+    }
+
+    // Otherwise just the pages that have changed since the keyframe... unless that's most of them
+    uint8_t *record = rewind_work;
+    uint8_t *last   = rewind_work + (pages / 2) * REWIND_RECORD;
+
+    for (uint32_t page=0; page < pages; page++)
+    {
+        const uint8_t *now = snapshot_page(page);
+
+        if (memcmp(now, rewind_key + page * SNAPSHOT_PAGE, SNAPSHOT_PAGE))
+        {
+            if (record == last)
+            {
+                rewind_add_keyframe();
+                return;
+            }
+
+            *(uint32_t *)record = page;
+            memcpy(record + sizeof(uint32_t), now, SNAPSHOT_PAGE);
+            record += REWIND_RECORD;
+        }
+    }
+
+    rewind_add(record - rewind_work, 0);
+    rewind_deltas++;
+}
+
+/*------------------------------------------------
+ * rewind_restore()
+ *
+ *  Put the machine back as it was at the newest
+ *  rewind point.
+ *
+ *  param:  Nothing
+ *  return: 1 if restored, 0 if not
+ */
+static int rewind_restore(void)
+{
+    // Find the keyframe this point is based on
+    uint32_t key = rewind_head;
+    int deltas = 0;
+    while (!rewind_point[key].keyframe)
+    {
+        key = (key + REWIND_MAX_POINTS - 1) % REWIND_MAX_POINTS;
+        deltas++;
+    }
+
+    if (rewind_key_point != (int32_t)key)
+    {
+        rewind_key_size = snapshot_size();
+        if (lzav_decompress(rewind_ring + rewind_point[key].offset, rewind_key, rewind_point[key].size, rewind_key_size) != (int)rewind_key_size)
+        {
+            rewind_reset(); // Taken on some other machine type
+            return 0;
+        }
+        rewind_key_point = key;
+    }
+    rewind_deltas = deltas;
+
+    if (key == rewind_head) return snapshot_restore(rewind_key);
+
+    memcpy(rewind_work, rewind_key, rewind_key_size);
+
+    const uint8_t *record = rewind_ring + rewind_point[rewind_head].offset;
+    const uint8_t *end    = record + rewind_point[rewind_head].size;
+    for ( ; record < end; record += REWIND_RECORD)
+    {
+        memcpy(rewind_work + *(const uint32_t *)record * SNAPSHOT_PAGE, record + sizeof(uint32_t), SNAPSHOT_PAGE);
+    }
+
+    return snapshot_restore(rewind_work);
+}
+
+/*------------------------------------------------
+ * rewind_step()
+ *
+ *  Step back one rewind point. Called once per
+ *  frame while the rewind button is held - the
+ *  first call goes back to the newest point and
+ *  each one after that drops it and goes back to
+ *  the one before. The oldest point is kept.
+ *
+ *  param:  Nothing
+ *  return: 1 if there's further back to go, 0 if not
+ */
+int rewind_step(void)
+{
+    if (!rewind_memory || !rewind_points || (rewind_sized != snapshot_size())) return 0;
+
+    if (rewind_stepped && (rewind_points > 1))
+    {
+        rewind_head  = (rewind_head + REWIND_MAX_POINTS - 1) % REWIND_MAX_POINTS;
+        rewind_write = rewind_point[rewind_head].offset + rewind_point[rewind_head].size;
+        rewind_points--;
+    }
+
+    rewind_stepped = 1;
+    rewind_frames  = 0;
+
+    if (!rewind_restore()) return 0;
+
+    return (rewind_points > 1);
+}
+
+// End of file
@@ -0,0 +1,39 @@
+// =====================================================================================
+// Copyright (c) 2025 Dave Bernazzani (wavemotion-dave)
+//
+// Copying and distribution of this emulator, its source code and associated
+// readme files, with or without modification, are permitted in any medium without
+// royalty provided this copyright notice is used and wavemotion-dave and eyalabraham
+// (Dragon 32 emu core) are thanked profusely.
+//
+// The Micro-DS emulator is offered as-is, without any warranty. Please see readme.md
+// =====================================================================================
+
+#ifndef __REWIND_H__
+#define __REWIND_H__
+
+#include    <stdint.h>
+
+// ------------------------------------------------------------------------
+// How much memory the ring of rewind points may use (its working buffers
+// come on top - about 116K for the MC-10 and 280K for the MCX-128). On a
+// DS the rest of the 4MB goes to the program itself (about 740K), the
+// static buffers (about 1M), the libraries (128K allowed) and up to 512K
+// of quicksave slots on the MCX-128 - which leaves about 1M spare even
+// then. The DSi has four times the RAM so it holds a longer stretch of play.
+// ------------------------------------------------------------------------
+#define REWIND_DS_MEMORY        (384*1024)
+#define REWIND_DSI_MEMORY       (4*1024*1024)
+
+#define REWIND_INTERVAL         4       // Frames between rewind points
+#define REWIND_KEY_INTERVAL     16      // Rewind points from one keyframe to the next
+
+extern uint32_t rewind_points;
+
+extern int      rewind_init(uint32_t memory);
+extern void     rewind_free(void);
+extern void     rewind_reset(void);
+extern void     rewind_frame(void);
+extern int      rewind_step(void);
+
+#endif  /* __REWIND_H__ */
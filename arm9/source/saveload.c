@@ -13,6 +13,7 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <stddef.h>
 #include <string.h>
 #include <unistd.h>
 #include <dirent.h>
@@ -24,23 +25,254 @@
 #include "mem.h"
 #include "tape.h"
 #include "vdg.h"
+#include "snapshot.h"
 #include "printf.h"
 
 #include "lzav.h"
 
-#define MICRO_SAVE_VER   0x0004     // Change this if the basic format of the .SAV file changes. Invalidates older .sav files.
+#define MICRO_SAVE_VER   0x0006     // Change this if the basic format of the .SAV file changes. New chunks don't need a change.
+#define MICRO_SAVE_V5    0x0005     // The last of the fixed-layout .sav files - still read back
+#define MICRO_SAVE_V4    0x0004     // Fixed layout from before the MCX-128 banking went through the page table - still read back
 
-u8 CompressBuffer[128*1024];
+#define WARM_STATE_VER   0x0002     // Change this if the basic format of the .wrm file changes.
+#define WARM_STATE_V1    0x0001     // A bare lzav compressed snapshot - still read back
+
+#define SNAPSHOT_FILE_VER 0x0001    // Boot snapshot and quicksave slot files. Before this they were raw snapshots - still read back
 
 char szLoadFile[MAX_FILENAME_LEN+1];
 char tmpStr[34];
 
-uint8_t spare[16] = {0};
+// ------------------------------------------------------------------------
+// The .sav and .wrm files (and the boot snapshot and the quicksave slots
+// kept on the SD card) are a version number followed by chunks, each
+// tagged with what it holds, its size and a CRC. A reader picks out just
+// the chunks it wants and steps over any it doesn't know about so a newer
+// emulator can add chunks (or grow one at the end) without throwing away
+// anyone's saves. A chunk stored in fewer bytes than its size is lzav
+// compressed - otherwise it's raw, which is quicker to write and read.
+//
+// The machine itself is a snapshot (see snapshot.h) split in three: the
+// first page (CPU, flags, timer, banking, beeper and tape position), the
+// main RAM and, for the MCX-128, the rest of its RAM.
+// ------------------------------------------------------------------------
+#define CHUNK_ID(a,b,c,d)   ((u32)(a) | ((u32)(b) << 8) | ((u32)(c) << 16) | ((u32)(d) << 24))
+
+#define CHUNK_TAPE          CHUNK_ID('T','A','P','E')   // The tape that was in the machine (save_tape_t)
+#define CHUNK_STATE         CHUNK_ID('S','T','A','T')   // First page of the snapshot
+#define CHUNK_RAM           CHUNK_ID('R','A','M',' ')   // Main RAM below the ROM
+#define CHUNK_MCX_RAM       CHUNK_ID('M','C','X',' ')   // MCX-128 RAM under the ROM plus the second 64K bank
+#define CHUNK_END           CHUNK_ID('E','N','D',' ')   // No more chunks
+
+typedef struct
+{
+    u32 id;         // CHUNK_xxx
+    u32 size;       // Bytes of data once read back
+    u32 length;     // Bytes stored in the file (less than size if compressed)
+    u32 crc;        // CRC32 of the bytes stored
+} save_chunk_t;
 
-void MicroSaveState()
+typedef struct
 {
-  size_t retVal;
+    u32  file_size;
+    char last_path[MAX_FILENAME_LEN];
+    char last_file[MAX_FILENAME_LEN];
+} save_tape_t;
+
+static save_tape_t save_tape;
+
+// ------------------------------------------------------------------------
+// The buffers the files are read and written through. They are only
+// allocated while a file is being read or written and are sized for the
+// machine being run - the rest of the time that memory is free.
+// ------------------------------------------------------------------------
+static u8 *CompressBuffer = NULL;   // A chunk as stored in the file
+static u32 CompressSize   = 0;      // Bytes in CompressBuffer
+static u8 *SnapshotBuffer = NULL;   // The machine on its way to or from the file
+
+static void SaveBuffersFree(void)
+{
+    if (CompressBuffer) free(CompressBuffer);
+    if (SnapshotBuffer) free(SnapshotBuffer);
+    CompressBuffer = NULL;
+    SnapshotBuffer = NULL;
+    CompressSize   = 0;
+}
+
+static u8 SaveBuffersAlloc(void)
+{
+    CompressSize   = SNAPSHOT_COMPRESS(snapshot_size());
+    CompressBuffer = malloc(CompressSize);
+    SnapshotBuffer = malloc(snapshot_size());
+
+    if (CompressBuffer && SnapshotBuffer) return 1;
+
+    SaveBuffersFree();
+    return 0;
+}
+
+/*********************************************************************************
+ * Write one chunk. The data is compressed only if asked and if it comes out
+ * smaller.
+ ********************************************************************************/
+static size_t WriteChunk(FILE *handle, u32 id, const void *data, u32 size, u8 bCompress)
+{
+    save_chunk_t chunk = {id, size, size, 0};
+    const u8 *stored = (const u8 *)data;
+
+    if (bCompress && size)
+    {
+        int comp_len = lzav_compress_hi(data, CompressBuffer, size, CompressSize);
+        if ((comp_len > 0) && ((u32)comp_len < size))
+        {
+            stored = CompressBuffer;
+            chunk.length = comp_len;
+        }
+    }
+
+    chunk.crc = getCRC32((u8 *)stored, chunk.length);
+
+    size_t retVal = fwrite(&chunk, sizeof(chunk), 1, handle);
+    if (retVal && chunk.length) retVal = fwrite(stored, chunk.length, 1, handle);
+
+    return retVal;
+}
+
+/*********************************************************************************
+ * Find a chunk anywhere after 'start' in the file and read it into 'data'. A
+ * chunk shorter than 'size' (from an older emulator) fills what it has and the
+ * rest is left alone. A longer raw one (from a newer emulator) gives only the
+ * first 'size' bytes. Returns the bytes read or -1 if missing or damaged.
+ ********************************************************************************/
+static int ReadChunk(FILE *handle, long start, u32 id, void *data, u32 size)
+{
+    save_chunk_t chunk;
+
+    if (fseek(handle, start, SEEK_SET)) return -1;
+
+    while (fread(&chunk, sizeof(chunk), 1, handle) == 1)
+    {
+        if (chunk.id == CHUNK_END) break;
+
+        if (chunk.id != id)
+        {
+            if (fseek(handle, chunk.length, SEEK_CUR)) break;
+            continue;
+        }
+
+        if ((chunk.length > CompressSize) || (chunk.length > chunk.size)) return -1;
+        if (chunk.length && (fread(CompressBuffer, chunk.length, 1, handle) != 1)) return -1;
+        if (getCRC32(CompressBuffer, chunk.length) != chunk.crc) return -1;
+
+        if (chunk.length == chunk.size)
+        {
+            u32 len = (chunk.size < size) ? chunk.size : size;
+            memcpy(data, CompressBuffer, len);
+            return len;
+        }
+
+        if (chunk.size > size) return -1;
+        if (lzav_decompress(CompressBuffer, data, chunk.length, chunk.size) != (int)chunk.size) return -1;
+
+        return chunk.size;
+    }
+
+    return -1;
+}
+
+// The chunks a snapshot is split into, in the order they are written
+static const struct
+{
+    u32 id;
+    u32 size;
+} snapshot_chunks[] =
+{
+    {CHUNK_STATE,   SNAPSHOT_PAGE},
+    {CHUNK_RAM,     SNAPSHOT_RAM},
+    {CHUNK_MCX_RAM, SNAPSHOT_MCX_RAM},      // Only the MCX-128 has this
+};
+
+#define SNAPSHOT_CHUNKS(size)   (((size) > SNAPSHOT_PAGE + SNAPSHOT_RAM) ? 3 : 2)
+
+/*********************************************************************************
+ * Write a snapshot as chunks (and the end marker). With bCompress clear the
+ * chunks are all raw - bigger but much quicker.
+ ********************************************************************************/
+static size_t WriteSnapshotChunks(FILE *handle, const u8 *snapshot, u32 size, u8 bCompress)
+{
+    size_t retVal = 1;
+
+    for (int i=0; retVal && (i < SNAPSHOT_CHUNKS(size)); i++)
+    {
+        retVal = WriteChunk(handle, snapshot_chunks[i].id, snapshot, snapshot_chunks[i].size, (i ? bCompress : 0));
+        snapshot += snapshot_chunks[i].size;
+    }
+    if (retVal) retVal = WriteChunk(handle, CHUNK_END, NULL, 0, 0);
+
+    return retVal;
+}
+
+/*********************************************************************************
+ * Read a snapshot back from its chunks into a buffer of snapshot_size() bytes.
+ * Returns 1 if all there or 0 if a chunk is missing or damaged.
+ ********************************************************************************/
+static u8 ReadSnapshotChunks(FILE *handle, long start, u8 *snapshot)
+{
+    u32 size = snapshot_size();
+
+    memset(snapshot, 0x00, SNAPSHOT_PAGE);          // Anything an older emulator didn't save starts as zero
+
+    for (int i=0; i < SNAPSHOT_CHUNKS(size); i++)
+    {
+        int len = ReadChunk(handle, start, snapshot_chunks[i].id, snapshot, snapshot_chunks[i].size);
+        if ((len <= 0) || (i && (len != (int)snapshot_chunks[i].size))) return 0;
+        snapshot += snapshot_chunks[i].size;
+    }
+
+    return 1;
+}
+
+/*********************************************************************************
+ * Write the whole machine as chunks. Read the machine back from its chunks and
+ * restore it - 0 if a chunk is missing or damaged or it was saved on another
+ * machine type.
+ ********************************************************************************/
+static size_t WriteMachineChunks(FILE *handle, u8 bCompress)
+{
+    u32 size = snapshot_save(SnapshotBuffer);
+
+    return WriteSnapshotChunks(handle, SnapshotBuffer, size, bCompress);
+}
+
+static u8 ReadMachineChunks(FILE *handle, long start)
+{
+    if (!ReadSnapshotChunks(handle, start, SnapshotBuffer)) return 0;
 
+    return snapshot_restore(SnapshotBuffer);
+}
+
+/*********************************************************************************
+ * The boot snapshot and quicksave slot files - SNAPSHOT_FILE_VER and the chunks.
+ * A raw snapshot (which starts with its size) from before them is read as-is.
+ * Either is only read into the buffer - snapshot_restore() checks it is whole
+ * and for this machine when it's used.
+ ********************************************************************************/
+static u8 ReadSnapshotFile(FILE *handle, u8 *snapshot)
+{
+    u16 file_ver = 0xBEEF;
+    u32 size = 0;
+
+    if (fread(&file_ver, sizeof(file_ver), 1, handle) != 1) return 0;
+    if (file_ver == SNAPSHOT_FILE_VER) return ReadSnapshotChunks(handle, ftell(handle), snapshot);
+
+    if (fseek(handle, 0, SEEK_SET) || (fread(snapshot, snapshot_size(), 1, handle) != 1)) return 0;
+    memcpy(&size, snapshot, sizeof(size));
+
+    return (size == snapshot_size());
+}
+
+// The .sav file goes in the sav directory named after the game with .sav in place of the extension
+static void SaveStateFilename(void)
+{
   // Return to the original path
   chdir(initial_path);
 
@@ -64,11 +296,18 @@ void MicroSaveState()
       szLoadFile[len-2] = 'a';
       szLoadFile[len-1] = 'v';
   }
+}
+
+void MicroSaveState()
+{
+  size_t retVal;
+
+  SaveStateFilename();
 
   strcpy(tmpStr,"SAVING...");
   DSPrint(0,0,0,tmpStr);
 
-  FILE *handle = fopen(szLoadFile, "wb+");
+  FILE *handle = SaveBuffersAlloc() ? fopen(szLoadFile, "wb+") : NULL;
   if (handle != NULL)
   {
     // Write Version
@@ -76,49 +315,17 @@ void MicroSaveState()
     retVal = fwrite(&save_ver, sizeof(u16), 1, handle);
 
     // Write Last Directory Path / Tape File
-    if (retVal) retVal = fwrite(&last_path, sizeof(last_path), 1, handle);
-    if (retVal) retVal = fwrite(&last_file, sizeof(last_file), 1, handle);
-
-    // Write Motorola 6803 CPU
-    if (retVal) retVal = fwrite(&cpu, sizeof(cpu), 1, handle);
-
-    // Write VDG vars
-    if (retVal) retVal = fwrite(&current_vdg_mode,      sizeof(current_vdg_mode),       1, handle);
-
-    // Some Cassette stuff
-    if (retVal) retVal = fwrite(&tape_pos,              sizeof(tape_pos),               1, handle);
-    if (retVal) retVal = fwrite(&tape_motor,            sizeof(tape_motor),             1, handle);
-    if (retVal) retVal = fwrite(&tape_speedup,          sizeof(tape_speedup),           1, handle);
-    if (retVal) retVal = fwrite(&cas_eof,               sizeof(cas_eof),                1, handle);
-    if (retVal) retVal = fwrite(&tape_byte,             sizeof(tape_byte),              1, handle);
-    if (retVal) retVal = fwrite(&bit_index,             sizeof(bit_index),              1, handle);
-    if (retVal) retVal = fwrite(&bit_timing_threshold,  sizeof(bit_timing_threshold),   1, handle);
-    if (retVal) retVal = fwrite(&bit_timing_count,      sizeof(bit_timing_count),       1, handle);
-    if (retVal) retVal = fwrite(&read_cassette_counter, sizeof(read_cassette_counter),  1, handle);
-
-    // And some MicroDS handling memory
-    if (retVal) retVal = fwrite(&micro_line,              sizeof(micro_line),           1, handle);
-    if (retVal) retVal = fwrite(&file_size,               sizeof(file_size),            1, handle);
-    if (retVal) retVal = fwrite(&emuFps,                  sizeof(emuFps),               1, handle);
-    if (retVal) retVal = fwrite(&emuActFrames,            sizeof(emuActFrames),         1, handle);
-    if (retVal) retVal = fwrite(&timingFrames,            sizeof(timingFrames),         1, handle);
-    if (retVal) retVal = fwrite(&counter_read_latch,      sizeof(counter_read_latch),   1, handle);
-    if (retVal) retVal = fwrite(&mcx_ram_bank0,           sizeof(mcx_ram_bank0),        1, handle);
-    if (retVal) retVal = fwrite(&mcx_ram_bank1,           sizeof(mcx_ram_bank1),        1, handle);
-    if (retVal) retVal = fwrite(&mcx_rom_bank,            sizeof(mcx_rom_bank),         1, handle);
-                                                                                        
-    // And some spare bytes we can eat into as needed without bumping the SAVE version  
-    if (retVal) retVal = fwrite(spare,                    16,                           1, handle);
-
-    // -----------------------------------------------------------------------
-    // Compress the 64K RAM data using 'high' compression ratio... it's
-    // still quite fast for such small memory buffers and gets us under 32K
-    // -----------------------------------------------------------------------
-    int max_len = lzav_compress_bound_hi( 0xc000 );
-    int comp_len = lzav_compress_hi( Memory, CompressBuffer, 0xc000, max_len );
-
-    if (retVal) retVal = fwrite(&comp_len,          sizeof(comp_len), 1, handle);
-    if (retVal) retVal = fwrite(&CompressBuffer,    comp_len,         1, handle);
+    memset(&save_tape, 0x00, sizeof(save_tape));
+    save_tape.file_size = file_size;
+    strcpy(save_tape.last_path, last_path);
+    strcpy(save_tape.last_file, last_file);
+    if (retVal) retVal = WriteChunk(handle, CHUNK_TAPE, &save_tape, sizeof(save_tape), 1);
+
+    // ---------------------------------------------------------------------
+    // And the machine itself. Compress the RAM using 'high' compression
+    // ratio... it's still quite fast for such small memory buffers.
+    // ---------------------------------------------------------------------
+    if (retVal) retVal = WriteMachineChunks(handle, 1);
 
     strcpy(tmpStr, (retVal ? "OK ":"ERR"));
     DSPrint(9,0,0,tmpStr);
@@ -130,42 +337,134 @@ void MicroSaveState()
       strcpy(tmpStr,"Error opening SAV file ...");
       DSPrint(0,0,0,tmpStr);
   }
-  fclose(handle);
+  if (handle) fclose(handle);
+  SaveBuffersFree();
 }
 
+/*********************************************************************************
+ * If we saved a last path/file, we load it back up if possible....
+ ********************************************************************************/
+static void LoadLastTape(void)
+{
+    if (strlen(last_path) > 1)
+    {
+        chdir(last_path);
+
+        if (strlen(last_file) > 1)
+        {
+            tape_open(last_file);
+        }
+    }
+}
 
 /*********************************************************************************
- * Load the current state - read everything back from the .sav file.
+ * A version 4 .sav file is from before the MCX-128 banking went through the
+ * page table. Then the only RAM banked was the 4K at 0x4000 - bank 1's copy
+ * was swapped into Memory[] and bank 0's was held aside (and never saved).
+ * Everything else in Memory[] was seen whichever bank was selected. Now a
+ * selected bank 1 reads all of 0100-7FFF (and bank 0 all of 8000-BEFF) from
+ * Memory_MCX[] so that's where the RAM the program could see has to go. The
+ * bank 0 copy of the 4K at 0x4000 is lost as it was in the old emulator.
  ********************************************************************************/
-void MicroLoadState()
+static void MicroConvertStateV4(void)
 {
-  size_t retVal;
+    if (myConfig.machine != MACHINE_MCX) return;    // Only the MCX banks RAM - the others load as-is
 
-  // Return to the original path
-  chdir(initial_path);
+    if (mcx_ram_bank1) memcpy(Memory_MCX + 0x0100, Memory + 0x0100, 0x7F00);
+    if (mcx_ram_bank0) memcpy(Memory_MCX + 0x8000, Memory + 0x8000, 0x3F00);
+}
 
-  // Init filename = romname and SAV in place of ROM
-  DIR* dir = opendir("sav");
-  if (dir) closedir(dir);    // Directory exists... close it out and move on.
-  else mkdir("sav", 0777);   // Otherwise create the directory...
-  sprintf(szLoadFile,"sav/%s", initial_file);
+/*********************************************************************************
+ * One lzav compressed block of a fixed-layout .sav file - its length and then the
+ * data. Returns 1 only if it was all there and decompressed to exactly 'size'.
+ ********************************************************************************/
+static size_t ReadFixedBlock(FILE *handle, u8 *data, int size)
+{
+    int comp_len = 0;
 
-  int len = strlen(szLoadFile);
-  if (szLoadFile[len-3] == '.') // k7 file most likely
-  {
-      szLoadFile[len-2] = 's';
-      szLoadFile[len-1] = 'a';
-      szLoadFile[len-0] = 'v';
-      szLoadFile[len+1] = 0;
-  }
-  else
-  {
-      szLoadFile[len-3] = 's';
-      szLoadFile[len-2] = 'a';
-      szLoadFile[len-1] = 'v';
-  }
+    if (fread(&comp_len, sizeof(comp_len), 1, handle) != 1) return 0;
+    if ((comp_len <= 0) || (comp_len > (int)CompressSize)) return 0;
+    if (fread(CompressBuffer, comp_len, 1, handle) != 1) return 0;
+
+    return (lzav_decompress(CompressBuffer, data, comp_len, size) == size);
+}
+
+/*********************************************************************************
+ * Read back a fixed-layout .sav file from before the chunks (MICRO_SAVE_V5 or
+ * MICRO_SAVE_V4 - the same but without the extra MCX-128 RAM).
+ ********************************************************************************/
+static size_t MicroLoadStateFixed(FILE *handle, u16 save_ver)
+{
+    size_t retVal = 1;
+    u8 spare[16];
+
+    // Restore Last Directory Path / Tape File
+    if (retVal) retVal = fread(&last_path, sizeof(last_path), 1, handle);
+    if (retVal) retVal = fread(&last_file, sizeof(last_file), 1, handle);
+
+    LoadLastTape();
+
+    // Restore Motorola 6803 CPU
+    if (retVal) retVal = fread(&cpu, sizeof(cpu), 1, handle);
+
+    // Restore VDG vars
+    if (retVal) retVal = fread(&current_vdg_mode,      sizeof(current_vdg_mode),       1, handle);
+
+    // Restore Cassette stuff
+    if (retVal) retVal = fread(&tape_pos,              sizeof(tape_pos),               1, handle);
+    if (retVal) retVal = fread(&tape_motor,            sizeof(tape_motor),             1, handle);
+    if (retVal) retVal = fread(&tape_speedup,          sizeof(tape_speedup),           1, handle);
+    if (retVal) retVal = fread(&cas_eof,               sizeof(cas_eof),                1, handle);
+    if (retVal) retVal = fread(&tape_byte,             sizeof(tape_byte),              1, handle);
+    if (retVal) retVal = fread(&bit_index,             sizeof(bit_index),              1, handle);
+    if (retVal) retVal = fread(&bit_timing_threshold,  sizeof(bit_timing_threshold),   1, handle);
+    if (retVal) retVal = fread(&bit_timing_count,      sizeof(bit_timing_count),       1, handle);
+    if (retVal) retVal = fread(&read_cassette_counter, sizeof(read_cassette_counter),  1, handle);
+
+    // Restore some MicroDS handling memory
+    if (retVal) retVal = fread(&micro_line,              sizeof(micro_line),           1, handle);
+    if (retVal) retVal = fread(&file_size     ,          sizeof(file_size),            1, handle);
+    if (retVal) retVal = fread(&emuFps,                  sizeof(emuFps),               1, handle);
+    if (retVal) retVal = fread(&emuActFrames,            sizeof(emuActFrames),         1, handle);
+    if (retVal) retVal = fread(&timingFrames,            sizeof(timingFrames),         1, handle);
+    if (retVal) retVal = fread(&counter_read_latch,      sizeof(counter_read_latch),   1, handle);
+    if (retVal) retVal = fread(&mcx_ram_bank0,           sizeof(mcx_ram_bank0),        1, handle);
+    if (retVal) retVal = fread(&mcx_ram_bank1,           sizeof(mcx_ram_bank1),        1, handle);
+    if (retVal) retVal = fread(&mcx_rom_bank,            sizeof(mcx_rom_bank),         1, handle);
+    mem_map_build();
+
+    // And the spare bytes
+    if (retVal) retVal = fread(spare,                    16,                           1, handle);
+
+    // ------------------------------------------------------------------
+    // Decompress the previously compressed RAM and put it back into the
+    // right memory location... this is quite fast all things considered.
+    // ------------------------------------------------------------------
+    if (retVal) retVal = ReadFixedBlock(handle, Memory, 0xC000);  // Everything up to start of BASIC ROM
+
+    // And the MCX-128 RAM under the ROM plus the second 64K bank
+    if ((myConfig.machine == MACHINE_MCX) && (save_ver == MICRO_SAVE_V5))
+    {
+        if (retVal) retVal = ReadFixedBlock(handle, Memory+0xC000, 0x3F00);
+        if (retVal) retVal = ReadFixedBlock(handle, Memory_MCX, sizeof(Memory_MCX));
+    }
+
+    if (save_ver == MICRO_SAVE_V4) MicroConvertStateV4();
 
-  memset(spare, 0x00, sizeof(spare));
+    vdg_invalidate();   // Video memory changed underneath the VDG so redraw it all
+
+    return retVal;
+}
+
+
+/*********************************************************************************
+ * Load the current state - read everything back from the .sav file.
+ ********************************************************************************/
+void MicroLoadState()
+{
+  size_t retVal;
+
+  SaveStateFilename();
 
   FILE *handle = fopen(szLoadFile, "rb");
   if (handle != NULL)
@@ -175,68 +474,37 @@ void MicroLoadState()
 
     // Read Version
     u16 save_ver = 0xBEEF;
-    retVal = fread(&save_ver, sizeof(u16), 1, handle);
+    retVal = SaveBuffersAlloc();
+    if (retVal) retVal = fread(&save_ver, sizeof(u16), 1, handle);
 
-    if (save_ver == MICRO_SAVE_VER)
+    if (retVal && ((save_ver == MICRO_SAVE_VER) || (save_ver == MICRO_SAVE_V5) || (save_ver == MICRO_SAVE_V4)))
     {
-        // Restore Last Directory Path / Tape File
-        if (retVal) retVal = fread(&last_path, sizeof(last_path), 1, handle);
-        if (retVal) retVal = fread(&last_file, sizeof(last_file), 1, handle);
-
-        // ---------------------------------------------------------------
-        // If we saved a last path/file, we load it back up if possible....
-        // ---------------------------------------------------------------
-        if (strlen(last_path) > 1)
+        if (save_ver != MICRO_SAVE_VER)
+        {
+            retVal = MicroLoadStateFixed(handle, save_ver);
+        }
+        else
         {
-            chdir(last_path);
+            long start = ftell(handle);
 
-            if (strlen(last_file) > 1)
+            // The machine first - if it can't be restored nothing is changed
+            retVal = ReadMachineChunks(handle, start);
+
+            // Restore Last Directory Path / Tape File
+            memset(&save_tape, 0x00, sizeof(save_tape));
+            if (retVal && (ReadChunk(handle, start, CHUNK_TAPE, &save_tape, sizeof(save_tape)) > 0))
             {
-                ReadFileCarefully(last_file, TapeBuffer, sizeof(TapeBuffer), 0);
+                save_tape.last_path[MAX_FILENAME_LEN-1] = 0;
+                save_tape.last_file[MAX_FILENAME_LEN-1] = 0;
+                strcpy(last_path, save_tape.last_path);
+                strcpy(last_file, save_tape.last_file);
+                file_size = save_tape.file_size;
+
+                LoadLastTape();
             }
         }
 
-        // Restore Motorola 6803 CPU
-        if (retVal) retVal = fread(&cpu, sizeof(cpu), 1, handle);
-
-        // Restore VDG vars
-        if (retVal) retVal = fread(&current_vdg_mode,      sizeof(current_vdg_mode),       1, handle);
-
-        // Restore Cassette stuff
-        if (retVal) retVal = fread(&tape_pos,              sizeof(tape_pos),               1, handle);
-        if (retVal) retVal = fread(&tape_motor,            sizeof(tape_motor),             1, handle);
-        if (retVal) retVal = fread(&tape_speedup,          sizeof(tape_speedup),           1, handle);
-        if (retVal) retVal = fread(&cas_eof,               sizeof(cas_eof),                1, handle);
-        if (retVal) retVal = fread(&tape_byte,             sizeof(tape_byte),              1, handle);
-        if (retVal) retVal = fread(&bit_index,             sizeof(bit_index),              1, handle);
-        if (retVal) retVal = fread(&bit_timing_threshold,  sizeof(bit_timing_threshold),   1, handle);
-        if (retVal) retVal = fread(&bit_timing_count,      sizeof(bit_timing_count),       1, handle);
-        if (retVal) retVal = fread(&read_cassette_counter, sizeof(read_cassette_counter),  1, handle);
-
-        // Restore some MicroDS handling memory
-        if (retVal) retVal = fread(&micro_line,              sizeof(micro_line),           1, handle);
-        if (retVal) retVal = fread(&file_size     ,          sizeof(file_size),            1, handle);
-        if (retVal) retVal = fread(&emuFps,                  sizeof(emuFps),               1, handle);
-        if (retVal) retVal = fread(&emuActFrames,            sizeof(emuActFrames),         1, handle);
-        if (retVal) retVal = fread(&timingFrames,            sizeof(timingFrames),         1, handle);
-        if (retVal) retVal = fread(&counter_read_latch,      sizeof(counter_read_latch),   1, handle);
-        if (retVal) retVal = fread(&mcx_ram_bank0,           sizeof(mcx_ram_bank0),        1, handle);
-        if (retVal) retVal = fread(&mcx_ram_bank1,           sizeof(mcx_ram_bank1),        1, handle);
-        if (retVal) retVal = fread(&mcx_rom_bank,            sizeof(mcx_rom_bank),         1, handle);
-                                                                                           
-        // And some spare bytes we can eat into as needed without bumping the SAVE version 
-        if (retVal) retVal = fread(spare,                    16,                           1, handle);
-
-        // Restore Main RAM memory
-        int comp_len = 0;
-        if (retVal) retVal = fread(&comp_len,          sizeof(comp_len), 1, handle);
-        if (retVal) retVal = fread(&CompressBuffer,    comp_len,         1, handle);
-
-        // ------------------------------------------------------------------
-        // Decompress the previously compressed RAM and put it back into the
-        // right memory location... this is quite fast all things considered.
-        // ------------------------------------------------------------------
-        (void)lzav_decompress( CompressBuffer, Memory, comp_len, 0xC000 ); // Everything up to start of BASIC ROM
+        if (retVal) micro_boot_cancel();
 
         strcpy(tmpStr, (retVal ? "OK ":"ERR"));
         DSPrint(9,0,0,tmpStr);
@@ -252,7 +520,344 @@ void MicroLoadState()
       DSPrint(0,0,0,"             ");
   }
 
-    fclose(handle);
+    if (handle) fclose(handle);
+    SaveBuffersFree();
+}
+
+/*********************************************************************************
+ * The boot snapshot (see mc10.c) is kept on the SD card so that even the first
+ * launch after power-on skips the cold start. It's written as chunks like the
+ * .sav files - one file per ROM CRC and machine type in the sav directory.
+ ********************************************************************************/
+static void BootSnapshotFilename(void)
+{
+    sprintf(szLoadFile, "%s/sav/BOOT%08X.SN%d", initial_path, (unsigned int)boot_rom_crc, myConfig.machine);
+}
+
+void MicroReadBootSnapshot(void)
+{
+    BootSnapshotFilename();
+
+    FILE *handle = fopen(szLoadFile, "rb");
+    if (handle != NULL)
+    {
+        if (SaveBuffersAlloc() && ReadSnapshotFile(handle, boot_snapshot))
+        {
+            boot_snapshot_crc = boot_rom_crc;
+        }
+        SaveBuffersFree();
+        fclose(handle);
+    }
+}
+
+void MicroWriteBootSnapshot(void)
+{
+    sprintf(szLoadFile, "%s/sav", initial_path);
+    DIR* dir = opendir(szLoadFile);
+    if (dir) closedir(dir);         // Directory exists... close it out and move on.
+    else mkdir(szLoadFile, 0777);   // Otherwise create the directory...
+
+    BootSnapshotFilename();
+
+    FILE *handle = SaveBuffersAlloc() ? fopen(szLoadFile, "wb+") : NULL;
+    if (handle != NULL)
+    {
+        u16 file_ver = SNAPSHOT_FILE_VER;
+        if (fwrite(&file_ver, sizeof(file_ver), 1, handle) == 1)
+        {
+            WriteSnapshotChunks(handle, boot_snapshot, snapshot_size(), 1);
+        }
+        fclose(handle);
+    }
+    SaveBuffersFree();
+}
+
+/*********************************************************************************
+ * The warm start is a snapshot of a game taken once its tape has finished loading
+ * (or wherever the user marked it) so that picking the game again jumps straight
+ * there. It's keyed by the tape CRC and kept in the sav directory apart from the
+ * user's own .sav file. The RAM chunks are compressed as they are in the .sav
+ * file - this is kept on the SD card for every game so it's worth the time.
+ ********************************************************************************/
+static void WarmStateFilename(void)
+{
+    sprintf(szLoadFile, "%s/sav/%08X.wrm", initial_path, (unsigned int)file_crc);
+}
+
+// A warm start from before the chunks - a bare snapshot compressed with lzav
+static u8 MicroLoadWarmStateV1(FILE *handle)
+{
+    int comp_len = 0;
+
+    if ((fread(&comp_len, sizeof(comp_len), 1, handle) != 1) || (comp_len <= 0) || (comp_len > (int)CompressSize)) return 0;
+    if (fread(CompressBuffer, comp_len, 1, handle) != 1) return 0;
+
+    // Only if it's whole and for the machine we are running now
+    if (lzav_decompress(CompressBuffer, SnapshotBuffer, comp_len, snapshot_size()) != (int)snapshot_size()) return 0;
+
+    return snapshot_restore(SnapshotBuffer);
+}
+
+u8 MicroLoadWarmState(void)
+{
+    u8 bRestored = 0;
+
+    WarmStateFilename();
+
+    FILE *handle = fopen(szLoadFile, "rb");
+    if (handle != NULL)
+    {
+        u16 warm_ver = 0xBEEF;
+
+        if (SaveBuffersAlloc() && (fread(&warm_ver, sizeof(warm_ver), 1, handle) == 1))
+        {
+            if (warm_ver == WARM_STATE_VER)     bRestored = ReadMachineChunks(handle, ftell(handle));
+            else if (warm_ver == WARM_STATE_V1) bRestored = MicroLoadWarmStateV1(handle);
+        }
+        SaveBuffersFree();
+        fclose(handle);
+    }
+
+    if (bRestored) micro_boot_cancel();
+
+    return bRestored;
+}
+
+void MicroSaveWarmState(u8 bShowStatus)
+{
+    size_t retVal = 0;
+
+    sprintf(szLoadFile, "%s/sav", initial_path);
+    DIR* dir = opendir(szLoadFile);
+    if (dir) closedir(dir);         // Directory exists... close it out and move on.
+    else mkdir(szLoadFile, 0777);   // Otherwise create the directory...
+
+    WarmStateFilename();
+
+    if (bShowStatus)
+    {
+        strcpy(tmpStr,"SAVING...");
+        DSPrint(0,0,0,tmpStr);
+    }
+
+    FILE *handle = SaveBuffersAlloc() ? fopen(szLoadFile, "wb+") : NULL;
+    if (handle != NULL)
+    {
+        u16 warm_ver = WARM_STATE_VER;
+        retVal = fwrite(&warm_ver, sizeof(warm_ver), 1, handle);
+        if (retVal) retVal = WriteMachineChunks(handle, 1);
+        fclose(handle);
+    }
+    SaveBuffersFree();
+
+    if (bShowStatus)
+    {
+        strcpy(tmpStr, (retVal ? "OK ":"ERR"));
+        DSPrint(9,0,0,tmpStr);
+        WAITVBL;WAITVBL;WAITVBL;WAITVBL;WAITVBL;WAITVBL;
+        DSPrint(0,0,0,"             ");
+    }
+}
+
+/*********************************************************************************
+ * Quicksave slots are raw snapshots kept in memory so saving and loading take
+ * microseconds - there's no compression and no SD card access. If enabled in
+ * the global options, any slot that has changed is also written out to the SD
+ * card a little at a time from the main loop (sav/<crc>.qs<n>) and read back
+ * in when the game is next launched. That file is raw chunks - each chunk's
+ * header goes out first and its CRC is filled in once the whole chunk is.
+ *
+ * A slot's memory is only allocated the first time it's used and is sized for
+ * the machine being run (under 64K for the 20K machine, 130K for the MCX-128).
+ * The slots are freed when another game is launched or the machine type changes.
+ ********************************************************************************/
+#define QUICK_FLUSH_CHUNK   4096    // Bytes written to the SD card per frame
+
+u8 *QuickSlots[QUICK_SLOTS]    = {NULL};
+u8 QuickSlotUsed[QUICK_SLOTS]  = {0};
+u8 QuickSlotDirty[QUICK_SLOTS] = {0};   // Changed since last written to the SD card
+u8 QuickSlotMachine            = 0;     // myConfig.machine the slots are sized for
+
+static FILE *quick_flush_handle = NULL;
+static u8    quick_flush_slot   = 0;
+static u32   quick_flush_pos    = 0;    // Bytes of the slot written out
+static u8    quick_flush_chunk  = 0;    // The chunk they are in (snapshot_chunks[])
+static u32   quick_flush_start  = 0;    // Where that chunk starts in the slot
+static long  quick_flush_header = 0;    // Where its header is in the file
+static u32   quick_flush_crc    = 0;    // CRC of the chunk so far
+
+static void QuickSlotFilename(u8 slot)
+{
+    sprintf(szLoadFile, "%s/sav/%08X.qs%d", initial_path, (unsigned int)file_crc, slot+1);
+}
+
+// Throw away all of the slots (and any part written out to the SD card) and give back their memory
+static void QuickSlotsFree(void)
+{
+    if (quick_flush_handle)
+    {
+        fclose(quick_flush_handle);
+        quick_flush_handle = NULL;
+    }
+
+    for (u8 slot=0; slot < QUICK_SLOTS; slot++)
+    {
+        if (QuickSlots[slot]) free(QuickSlots[slot]);
+        QuickSlots[slot] = NULL;
+    }
+
+    memset(QuickSlotUsed,  0x00, sizeof(QuickSlotUsed));
+    memset(QuickSlotDirty, 0x00, sizeof(QuickSlotDirty));
+    QuickSlotMachine = myConfig.machine;
+}
+
+// The memory for a slot - allocated on first use. NULL if there isn't the memory for it.
+static u8 *QuickSlot(u8 slot)
+{
+    if (QuickSlotMachine != myConfig.machine) QuickSlotsFree();    // Sized (and taken) for another machine
+
+    if (!QuickSlots[slot]) QuickSlots[slot] = malloc(snapshot_size());
+
+    return QuickSlots[slot];
+}
+
+void MicroQuickSave(u8 slot)
+{
+    // A slot part way out to the SD card has to start over
+    if (quick_flush_handle && (quick_flush_slot == slot))
+    {
+        fclose(quick_flush_handle);
+        quick_flush_handle = NULL;
+    }
+
+    u8 *buffer = QuickSlot(slot);
+    if (!buffer) return;
+
+    snapshot_save(buffer);
+    QuickSlotUsed[slot]  = 1;
+    QuickSlotDirty[slot] = 1;
+}
+
+u8 MicroQuickLoad(u8 slot)
+{
+    if (!MicroQuickUsed(slot) || !snapshot_restore(QuickSlots[slot])) return 0;
+
+    micro_boot_cancel();
+    return 1;
+}
+
+u8 MicroQuickUsed(u8 slot)
+{
+    if (QuickSlotMachine != myConfig.machine) QuickSlotsFree();
+
+    return QuickSlotUsed[slot];
+}
+
+// Called when a game is launched - the slots belong to the last game played
+void MicroQuickReadSlots(void)
+{
+    QuickSlotsFree();
+
+    if (!myGlobalConfig.quickFlush) return;
+
+    for (u8 slot=0; slot < QUICK_SLOTS; slot++)
+    {
+        QuickSlotFilename(slot);
+
+        FILE *handle = fopen(szLoadFile, "rb");
+        if (handle != NULL)
+        {
+            u8 *buffer = QuickSlot(slot);
+            if (buffer && SaveBuffersAlloc() && ReadSnapshotFile(handle, buffer))
+            {
+                QuickSlotUsed[slot] = 1;
+            }
+            SaveBuffersFree();
+            fclose(handle);
+        }
+
+        // Nothing kept for this slot - don't hold on to its memory
+        if (!QuickSlotUsed[slot] && QuickSlots[slot])
+        {
+            free(QuickSlots[slot]);
+            QuickSlots[slot] = NULL;
+        }
+    }
+}
+
+// Called once per frame - writes a little of any changed slot to the SD card
+void MicroQuickFlush(void)
+{
+    if (QuickSlotMachine != myConfig.machine) QuickSlotsFree();
+
+    if (!quick_flush_handle)
+    {
+        if (!myGlobalConfig.quickFlush) return;
+
+        for (quick_flush_slot=0; quick_flush_slot < QUICK_SLOTS; quick_flush_slot++)
+        {
+            if (QuickSlotDirty[quick_flush_slot]) break;
+        }
+        if (quick_flush_slot == QUICK_SLOTS) return;
+
+        sprintf(szLoadFile, "%s/sav", initial_path);
+        DIR* dir = opendir(szLoadFile);
+        if (dir) closedir(dir);         // Directory exists... close it out and move on.
+        else mkdir(szLoadFile, 0777);   // Otherwise create the directory...
+
+        QuickSlotDirty[quick_flush_slot] = 0;
+        QuickSlotFilename(quick_flush_slot);
+        quick_flush_handle = fopen(szLoadFile, "wb+");
+        if (quick_flush_handle == NULL) return;
+
+        u16 file_ver = SNAPSHOT_FILE_VER;
+        fwrite(&file_ver, sizeof(file_ver), 1, quick_flush_handle);
+        quick_flush_pos   = 0;
+        quick_flush_chunk = 0;
+        quick_flush_start = 0;
+    }
+
+    u32 size = snapshot_size();
+    u32 end  = quick_flush_start + snapshot_chunks[quick_flush_chunk].size;
+    size_t retVal = 1;
+
+    // Starting a chunk - its header goes first with the CRC filled in at the end
+    if (quick_flush_pos == quick_flush_start)
+    {
+        save_chunk_t chunk = {snapshot_chunks[quick_flush_chunk].id, end - quick_flush_start, end - quick_flush_start, 0};
+        quick_flush_header = ftell(quick_flush_handle);
+        quick_flush_crc    = 0xFFFFFFFF;
+        retVal = fwrite(&chunk, sizeof(chunk), 1, quick_flush_handle);
+    }
+
+    u32 len = ((end - quick_flush_pos) < QUICK_FLUSH_CHUNK) ? (end - quick_flush_pos) : QUICK_FLUSH_CHUNK;
+    const u8 *data = QuickSlots[quick_flush_slot] + quick_flush_pos;
+
+    if (retVal) retVal = fwrite(data, len, 1, quick_flush_handle);
+    quick_flush_crc  = crc32_update(quick_flush_crc, data, len);
+    quick_flush_pos += len;
+
+    // The end of a chunk - go back and put its CRC in the header
+    if (retVal && (quick_flush_pos == end))
+    {
+        u32 crc = ~quick_flush_crc;
+        retVal = !fseek(quick_flush_handle, quick_flush_header + offsetof(save_chunk_t, crc), SEEK_SET) &&
+                 (fwrite(&crc, sizeof(crc), 1, quick_flush_handle) == 1) &&
+                 !fseek(quick_flush_handle, 0, SEEK_END);
+
+        quick_flush_chunk++;
+        quick_flush_start = end;
+
+        if (retVal && (quick_flush_chunk < SNAPSHOT_CHUNKS(size))) return;
+        if (retVal) WriteChunk(quick_flush_handle, CHUNK_END, NULL, 0, 0);
+    }
+    else if (retVal)
+    {
+        return;
+    }
+
+    fclose(quick_flush_handle);
+    quick_flush_handle = NULL;
 }
 
 // End of file
@@ -14,6 +14,7 @@
 
 #include <nds.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <dirent.h>
 #include <unistd.h>
 
@@ -53,11 +54,14 @@ bool screenshotbmp(const char* filename) {
 
     // ---------------------------------------------------------
     // The screenshot requires a bit less than 100K of memory...
-    // We steal this from the compression buffer which is not
-    // otherwise used except when save/loading save states.
+    // only for as long as it takes to write it out.
     // ---------------------------------------------------------
-    extern u8 CompressBuffer[];
-    u8 *temp = (u8*)CompressBuffer;
+    u8 *temp = malloc(256 * 192 * 2 + sizeof(INFOHEADER) + sizeof(HEADER));
+    if (!temp)
+    {
+        fclose(file);
+        return false;
+    }
 
     HEADER *header= (HEADER*)temp;
     INFOHEADER *infoheader = (INFOHEADER*)(temp + sizeof(HEADER));
@@ -95,6 +99,7 @@ bool screenshotbmp(const char* filename) {
     DC_FlushAll();
     fwrite(temp, 1, 256 * 192 * 2 + sizeof(INFOHEADER) + sizeof(HEADER), file);
     fclose(file);
+    free(temp);
     return true;
 }
 
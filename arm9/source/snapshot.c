@@ -0,0 +1,252 @@
+// =====================================================================================
+// Copyright (c) 2025 Dave Bernazzani (wavemotion-dave)
+//
+// Copying and distribution of this emulator, its source code and associated
+// readme files, with or without modification, are permitted in any medium without
+// royalty provided this copyright notice is used and wavemotion-dave and eyalabraham
+// (Dragon 32 emu core) are thanked profusely.
+//
+// The Micro-DS emulator is offered as-is, without any warranty. Please see readme.md
+// =====================================================================================
+
+/********************************************************************
+ * snapshot.c
+ *
+ *  Take and restore an in-memory snapshot of the whole machine. This
+ *  is raw and uncompressed so it takes microseconds either way - the
+ *  .sav file (saveload.c) is the compressed on-disk form.
+ *
+ *******************************************************************/
+#include    <nds.h>
+#include    <string.h>
+
+#include    "cpu.h"
+#include    "mem.h"
+#include    "vdg.h"
+#include    "tape.h"
+#include    "audio.h"
+#include    "snapshot.h"
+#include    "MicroDS.h"
+#include    "MicroUtils.h"
+
+// ------------------------------------------------------------------------
+// Everything but the RAM. This is the first page of the snapshot and the
+// RAM follows on from the second page. New fields go on the end - a .sav
+// file from before them (see saveload.c) reads them back as zero.
+// ------------------------------------------------------------------------
+typedef struct
+{
+    uint32_t        size;                   // Of the whole snapshot including the RAM
+    uint8_t         machine;                // myConfig.machine it was taken on
+    uint8_t         cc;                     // Packed condition code register
+    uint8_t         counter_read_latch;
+    uint8_t         mcx_ram_bank0;
+    uint8_t         mcx_ram_bank1;
+    uint8_t         mcx_rom_bank;
+    s16             beeper_vol;
+    cpu_state_t     cpu;
+    int             cpu_cycle_deficit;
+    uint32_t        micro_line;
+    video_mode_t    current_vdg_mode;
+
+    uint32_t        tape_pos;
+    uint8_t         tape_motor;
+    uint8_t         tape_speedup;
+    uint8_t         cas_eof;
+    uint8_t         tape_byte;
+    uint8_t         tape_injected;
+    int             bit_index;
+    int             bit_timing_threshold;
+    int             bit_timing_count;
+    uint32_t        read_cassette_counter;
+} snapshot_header_t;
+
+_Static_assert(sizeof(snapshot_header_t) <= SNAPSHOT_PAGE, "snapshot header must fit in its page");
+
+static uint8_t snapshot_live_header[SNAPSHOT_PAGE];   // Page 0 of the running machine for snapshot_page()
+
+/*------------------------------------------------
+ * snapshot_size()
+ *
+ *  How big a snapshot of the current machine is.
+ *
+ *  param:  Nothing
+ *  return: Size in bytes
+ */
+uint32_t snapshot_size(void)
+{
+    uint32_t size = SNAPSHOT_PAGE + SNAPSHOT_RAM;
+
+    if (myConfig.machine == MACHINE_MCX) size += SNAPSHOT_MCX_RAM;
+
+    return size;
+}
+
+/*------------------------------------------------
+ * snapshot_save_header()
+ *
+ *  Fill in the first page of a snapshot.
+ *
+ *  param:  Page to fill in
+ *  return: Nothing
+ */
+static void snapshot_save_header(uint8_t *page)
+{
+    snapshot_header_t *header = (snapshot_header_t *)page;
+
+    memset(page, 0x00, SNAPSHOT_PAGE);
+
+    header->size                    = snapshot_size();
+    header->machine                 = myConfig.machine;
+    header->cc                      = get_cc();
+    header->counter_read_latch      = counter_read_latch;
+    header->mcx_ram_bank0           = mcx_ram_bank0;
+    header->mcx_ram_bank1           = mcx_ram_bank1;
+    header->mcx_rom_bank            = mcx_rom_bank;
+    header->beeper_vol              = beeper_vol;
+    header->cpu                     = cpu;
+    header->cpu_cycle_deficit       = cpu_cycle_deficit;
+    header->micro_line              = micro_line;
+    header->current_vdg_mode        = current_vdg_mode;
+
+    header->tape_pos                = tape_pos;
+    header->tape_motor              = tape_motor;
+    header->tape_speedup            = tape_speedup;
+    header->cas_eof                 = cas_eof;
+    header->tape_byte               = tape_byte;
+    header->tape_injected           = tape_injected;
+    header->bit_index               = bit_index;
+    header->bit_timing_threshold    = bit_timing_threshold;
+    header->bit_timing_count        = bit_timing_count;
+    header->read_cassette_counter   = read_cassette_counter;
+}
+
+/*------------------------------------------------
+ * snapshot_save()
+ *
+ *  Take a snapshot of the machine. Must be called
+ *  between scanlines (not from within cpu_run()).
+ *
+ *  param:  Buffer of at least snapshot_size() bytes
+ *  return: Size of the snapshot
+ */
+uint32_t snapshot_save(uint8_t *buffer)
+{
+    snapshot_save_header(buffer);
+
+    uint8_t *ram = buffer + SNAPSHOT_PAGE;
+    memcpy(ram, Memory, SNAPSHOT_RAM);
+
+    // The MCX-128 RAM under the ROM plus the second 64K bank
+    if (myConfig.machine == MACHINE_MCX)
+    {
+        memcpy(ram + SNAPSHOT_RAM, Memory + 0xC000, 0x3F00);
+        memcpy(ram + SNAPSHOT_RAM + 0x3F00, Memory_MCX, sizeof(Memory_MCX));
+    }
+
+    return snapshot_size();
+}
+
+/*------------------------------------------------
+ * snapshot_restore_quiet()
+ *
+ *  As snapshot_restore() but the VDG is left alone
+ *  so the screen isn't redrawn from scratch. The
+ *  caller must flag whatever part of the screen it
+ *  knows has changed in mem_video_dirty[].
+ *
+ *  param:  Snapshot from snapshot_save()
+ *  return: 1 if restored, 0 if taken on another machine type
+ */
+int snapshot_restore_quiet(const uint8_t *buffer)
+{
+    const snapshot_header_t *header = (const snapshot_header_t *)buffer;
+
+    if ((header->machine != myConfig.machine) || (header->size != snapshot_size())) return 0;
+
+    const uint8_t *ram = buffer + SNAPSHOT_PAGE;
+    memcpy(Memory, ram, SNAPSHOT_RAM);
+
+    if (myConfig.machine == MACHINE_MCX)
+    {
+        memcpy(Memory + 0xC000, ram + SNAPSHOT_RAM, 0x3F00);
+        memcpy(Memory_MCX, ram + SNAPSHOT_RAM + 0x3F00, sizeof(Memory_MCX));
+    }
+
+    set_cc(header->cc);
+    counter_read_latch      = header->counter_read_latch;
+    mcx_ram_bank0           = header->mcx_ram_bank0;
+    mcx_ram_bank1           = header->mcx_ram_bank1;
+    mcx_rom_bank            = header->mcx_rom_bank;
+    beeper_vol              = header->beeper_vol;
+    cpu                     = header->cpu;
+    cpu_cycle_deficit       = header->cpu_cycle_deficit;
+    micro_line              = header->micro_line;
+    current_vdg_mode        = header->current_vdg_mode;
+
+    tape_pos                = header->tape_pos;
+    tape_motor              = header->tape_motor;
+    tape_speedup            = header->tape_speedup;
+    cas_eof                 = header->cas_eof;
+    tape_byte               = header->tape_byte;
+    tape_injected           = header->tape_injected;
+    bit_index               = header->bit_index;
+    bit_timing_threshold    = header->bit_timing_threshold;
+    bit_timing_count        = header->bit_timing_count;
+    read_cassette_counter   = header->read_cassette_counter;
+
+    mem_map_build();    // The MCX banking may have changed
+
+    return 1;
+}
+
+/*------------------------------------------------
+ * snapshot_restore()
+ *
+ *  Put the machine back as it was when the snapshot
+ *  was taken. The ROM must already be in place (as
+ *  it is after micro_reset() for the same machine).
+ *
+ *  param:  Snapshot from snapshot_save()
+ *  return: 1 if restored, 0 if taken on another machine type
+ */
+int snapshot_restore(const uint8_t *buffer)
+{
+    if (!snapshot_restore_quiet(buffer)) return 0;
+
+    vdg_invalidate();   // Video memory changed underneath the VDG so redraw it all
+
+    return 1;
+}
+
+/*------------------------------------------------
+ * snapshot_page()
+ *
+ *  Where a page of a snapshot is in the running
+ *  machine. Page 0 (the registers and such) is
+ *  put together on each call. Comparing these
+ *  against an older snapshot shows what changed
+ *  without taking a whole new snapshot.
+ *
+ *  param:  Page number (less than snapshot_size() / SNAPSHOT_PAGE)
+ *  return: The page as it would be in a snapshot taken now
+ */
+const uint8_t *snapshot_page(uint32_t page)
+{
+    if (page == 0)
+    {
+        snapshot_save_header(snapshot_live_header);
+        return snapshot_live_header;
+    }
+
+    uint32_t offset = (page - 1) * SNAPSHOT_PAGE;
+
+    if (offset < SNAPSHOT_RAM) return Memory + offset;
+
+    offset -= SNAPSHOT_RAM;
+    if (offset < 0x3F00) return Memory + 0xC000 + offset;
+
+    return Memory_MCX + (offset - 0x3F00);
+}
+
+// End of file
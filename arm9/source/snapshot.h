@@ -0,0 +1,42 @@
+// =====================================================================================
+// Copyright (c) 2025 Dave Bernazzani (wavemotion-dave)
+//
+// Copying and distribution of this emulator, its source code and associated
+// readme files, with or without modification, are permitted in any medium without
+// royalty provided this copyright notice is used and wavemotion-dave and eyalabraham
+// (Dragon 32 emu core) are thanked profusely.
+//
+// The Micro-DS emulator is offered as-is, without any warranty. Please see readme.md
+// =====================================================================================
+
+#ifndef __SNAPSHOT_H__
+#define __SNAPSHOT_H__
+
+#include    <stdint.h>
+
+// ------------------------------------------------------------------------
+// A snapshot is the whole machine state (CPU, timer, memory banking, tape
+// position and RAM) taken between scanlines and laid out flat in a buffer
+// so it can be copied, compared, compressed or written out as-is. The MC-10
+// and ALICE need the 48K below the ROM. The MCX-128 also has the RAM under
+// its ROM and the second 64K bank.
+//
+// The registers and such take the first 256 byte page and each page of RAM
+// follows in order so a snapshot can also be compared (and patched) a page
+// at a time against the running machine - see snapshot_page().
+// ------------------------------------------------------------------------
+#define SNAPSHOT_PAGE           256
+#define SNAPSHOT_RAM            0xC000
+#define SNAPSHOT_MCX_RAM        (0x3F00 + 0x10000)
+#define SNAPSHOT_MAX_SIZE       (SNAPSHOT_PAGE + SNAPSHOT_RAM + SNAPSHOT_MCX_RAM)
+#define SNAPSHOT_MAX_PAGES      (SNAPSHOT_MAX_SIZE / SNAPSHOT_PAGE)
+#define SNAPSHOT_COMPRESS(size) ((size) + (size)/16 + 64)                      // Room for a snapshot once lzav compressed
+#define SNAPSHOT_COMPRESS_MAX   SNAPSHOT_COMPRESS(SNAPSHOT_MAX_SIZE)             // ...and for any snapshot at all
+
+extern uint32_t         snapshot_size(void);
+extern uint32_t         snapshot_save(uint8_t *buffer);
+extern int              snapshot_restore(const uint8_t *buffer);
+extern int              snapshot_restore_quiet(const uint8_t *buffer);
+extern const uint8_t   *snapshot_page(uint32_t page);
+
+#endif  /* __SNAPSHOT_H__ */
@@ -10,15 +10,24 @@
 // =====================================================================================
 
 #include    <nds.h>
+#include    <stdio.h>
 #include    <ctype.h>
+#include    <string.h>
+#include    <sys/stat.h>
 
+#include    "cpu.h"
+#include    "mem.h"
 #include    "tape.h"
+#include    "tapewav.h"
+#include    "snapshot.h"
 #include    "MicroDS.h"
 #include    "MicroUtils.h"
 
 #define     BIT_THRESHOLD_HI     8
 #define     BIT_THRESHOLD_LO     24
 #define     TAPE_PLAY_THRESHOLD  20000
+#define     TAPE_GUESS_SIZE      (64*1024)
+#define     TAPE_INJECT_STACK    0x100      // Room a BASIC program must leave below the stack
 
 uint32_t tape_pos               __attribute__((section(".dtcm"))) = 0;
 uint8_t  tape_motor             __attribute__((section(".dtcm"))) = 0;
@@ -29,6 +38,121 @@ int      bit_index              __attribute__((section(".dtcm"))) = 0;
 int      bit_timing_threshold   __attribute__((section(".dtcm"))) = 0;
 int      bit_timing_count       __attribute__((section(".dtcm"))) = 0;
 uint32_t read_cassette_counter  __attribute__((section(".dtcm"))) = 0;
+uint8_t  tape_injected                                          = 0;
+
+// ------------------------------------------------------------------------
+// The .C10 image isn't held in memory - it's read from the file through a
+// small window that is refilled from the SD card a few sectors at a time
+// (or, for a .wav recording, decoded into the window - see tapewav.c).
+// tape_prefetch() slides the window on once a frame while the tape is
+// playing so the CPU loop almost never has to wait on the SD card and a
+// tape can be any size (multi-program compilation tapes and the like).
+// ------------------------------------------------------------------------
+uint8_t  tape_window[TAPE_WINDOW];
+uint32_t tape_window_start      __attribute__((section(".dtcm"))) = 0;  // Where the window is in the image
+uint32_t tape_window_len        __attribute__((section(".dtcm"))) = 0;  // Bytes in the window (0 if nothing read yet)
+static FILE *tape_file          = NULL;
+static uint8_t tape_wav         = 0;    // 1 if the tape is a .wav recording
+
+/*------------------------------------------------
+ * tape_open()
+ *
+ *  Use a new .C10 image. It stays open until the
+ *  next one is opened (or tape_close()).
+ *
+ *  param:  File name
+ *  return: 1 if opened, 0 if not (no tape)
+ */
+int tape_open(const char *filename)
+{
+    tape_close();
+
+    tape_file = fopen(filename, "rb");
+    if (!tape_file) return 0;
+
+    // A recording is decoded as it plays - it sets file_size to as big as it could be for now
+    tape_wav = tape_wav_open(tape_file);
+    if (!tape_wav)
+    {
+        // Get file size the 'fast' way - use fstat() instead of fseek() or ftell()
+        struct stat stbuf;
+        (void)fstat(fileno(tape_file), &stbuf);
+        file_size = (uint32_t)stbuf.st_size;
+    }
+
+    tape_window_fill(0);
+
+    return 1;
+}
+
+/*------------------------------------------------
+ * tape_close()
+ *
+ *  Done with the .C10 image - there's no tape.
+ *
+ *  param:  Nothing
+ *  return: Nothing
+ */
+void tape_close(void)
+{
+    if (tape_file) fclose(tape_file);
+
+    tape_file         = NULL;
+    tape_wav          = 0;
+    file_size         = 0;
+    tape_window_start = 0;
+    tape_window_len   = 0;
+}
+
+/*------------------------------------------------
+ * tape_window_fill()
+ *
+ *  Read the window from the image so it starts
+ *  at the sector that holds the given offset.
+ *
+ *  param:  Offset into the image
+ *  return: Nothing
+ */
+void tape_window_fill(uint32_t pos)
+{
+    if (tape_wav)
+    {
+        tape_wav_fill(pos);
+        return;
+    }
+
+    tape_window_start = pos & ~(TAPE_SECTOR - 1);
+    tape_window_len   = 0;
+
+    if (!tape_file || (tape_window_start >= file_size)) return;
+
+    fseek(tape_file, tape_window_start, SEEK_SET);
+    tape_window_len = fread(tape_window, 1, TAPE_WINDOW, tape_file);
+}
+
+/*------------------------------------------------
+ * tape_prefetch()
+ *
+ *  Called once a frame. Once the tape has played
+ *  through half the window, the window is moved on
+ *  to start at tape_pos - well before it's needed.
+ *
+ *  param:  Nothing
+ *  return: Nothing
+ */
+void tape_prefetch(void)
+{
+    if (tape_wav)
+    {
+        tape_wav_prefetch();
+        return;
+    }
+
+    if ((tape_pos - tape_window_start) < (TAPE_WINDOW / 2)) return;
+    if ((tape_window_start + tape_window_len) >= file_size) return;  // Already have the end of the tape
+
+    tape_window_fill(tape_pos);
+}
 
 
 // -----------------------------------------------------------------------------
@@ -43,11 +167,20 @@ uint8_t tape_guess_type(void)
 {
     int printable_chars = 0;
 
-    u32 compare_size = file_size;
-    
-    for (int i=0; i < file_size; i++)
+    // The namefile block says what kind of program it is - if we can read it
+    tape_program_t program;
+    if (tape_parse(&program) && (program.file_type != TAPE_FILE_DATA))
+    {
+        return (program.file_type == TAPE_FILE_ML) ? AUTOLOAD_CLOADM : AUTOLOAD_CLOAD;
+    }
+
+    // The first 64K is plenty to go by (and all there is of almost any .C10)
+    u32 compare_size = (file_size < TAPE_GUESS_SIZE) ? file_size : TAPE_GUESS_SIZE;
+    u32 guess_size = compare_size;
+
+    for (int i=0; i < guess_size; i++)
     {
-        char c = toupper(TapeBuffer[i]);
+        char c = toupper(tape_byte_at(i));
         if (c != 0x55)
         {
             if ((c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || (c == ':') || (c == '$'))
@@ -67,11 +200,10 @@ uint8_t tape_guess_type(void)
 }
 
 // -----------------------------------------------------------------
-// At this point we have the entire .C10 tape file loaded up into
-// the TapeBuffer[] memory and so we just need to index in to grab
-// the next byte (or set the EOF if we are at the end of file).
+// Grab the next byte of the .C10 tape file from the window (or set
+// the EOF if we are at the end of file).
 // -----------------------------------------------------------------
-inline uint8_t tape_file_read(void)
+static inline uint8_t tape_file_read(void)
 {
     if (tape_pos > file_size)
     {
@@ -89,7 +221,7 @@ inline uint8_t tape_file_read(void)
     }
 
     // Return the next tape byte from the file
-    return TapeBuffer[tape_pos++];
+    return tape_byte_at(tape_pos++);
 }
 
 // ----------------------------------------------------
@@ -109,6 +241,7 @@ void tape_rewind(void)
     tape_motor = 0;
     tape_speedup = 0;
     tape_pos = 0;
+    tape_injected = 0;
 }
 
 // ----------------------------------------------------
@@ -179,6 +312,224 @@ uint8_t tape_read(void)
     return data;
 }
 
+/*------------------------------------------------
+ * tape_block_at()
+ *
+ *  Take the next whole block from the .C10 image. The
+ *  leader (0x55) is skipped up to the 0x3C sync byte
+ *  which is followed by the block type, the length,
+ *  the payload and a checksum (the 8-bit sum of the
+ *  type, length and payload bytes).
+ *
+ *  param:  Image offset (moved past the block), where to put the
+ *          block type, length and (up to 255) payload bytes
+ *  return: 1 checksum good, 0 checksum bad, -1 no block (offset unchanged)
+ */
+static int tape_block_at(uint32_t *position, uint8_t *type, uint8_t *length, uint8_t *data)
+{
+    uint32_t pos = *position;
+
+    while ((pos < file_size) && (tape_byte_at(pos) == 0x55)) pos++;
+
+    if ((pos + 3) > file_size || (tape_byte_at(pos) != 0x3C)) return -1;
+
+    *type   = tape_byte_at(pos+1);
+    *length = tape_byte_at(pos+2);
+    pos += 3;
+
+    if ((pos + *length + 1) > file_size) return -1;
+
+    uint8_t checksum = *type + *length;
+    for (int i=0; i < *length; i++)
+    {
+        data[i] = tape_byte_at(pos++);
+        checksum += data[i];
+    }
+
+    *position = pos + 1;
+
+    return (checksum == tape_byte_at(pos)) ? 1 : 0;
+}
+
+/*------------------------------------------------
+ * tape_block_read()
+ *
+ *  FAST LOAD - take the next whole block from the
+ *  tape at tape_pos rather than feeding it to the ROM
+ *  a bit at a time. The bit-level reader picks up
+ *  again at the byte after the block's checksum.
+ *
+ *  param:  Where to put the block type, length and (up to 255) payload bytes
+ *  return: 1 checksum good, 0 checksum bad, -1 no block (tape_pos unchanged)
+ */
+int tape_block_read(uint8_t *type, uint8_t *length, uint8_t *data)
+{
+    int status = tape_block_at(&tape_pos, type, length, data);
+
+    if (status >= 0)
+    {
+        bit_index = 0;
+        cas_eof   = 0;
+    }
+
+    return status;
+}
+
+/*------------------------------------------------
+ * tape_parse()
+ *
+ *  Walk the first program on the .C10 image - the
+ *  namefile block (name, file type, ASCII flag, gap
+ *  flag, exec and load address), the data blocks and
+ *  the EOF block - checking every block's checksum.
+ *
+ *  param:  Where to put what the namefile says
+ *  return: 1 if the program is all there, 0 if not
+ */
+int tape_parse(tape_program_t *program)
+{
+    uint8_t  type, length, data[256];
+    uint32_t pos = 0;
+
+    if ((tape_block_at(&pos, &type, &length, data) != 1) || (type != TAPE_BLOCK_NAMEFILE) || (length < 15)) return 0;
+
+    memcpy(program->name, data, 8);
+    program->name[8]   = 0;
+    program->file_type = data[8];
+    program->ascii     = data[9];
+    program->exec      = (data[11] << 8) | data[12];
+    program->load      = (data[13] << 8) | data[14];
+    program->length    = 0;
+
+    while (tape_block_at(&pos, &type, &length, data) == 1)
+    {
+        if (type == TAPE_BLOCK_EOF)  return 1;
+        if (type != TAPE_BLOCK_DATA) break;
+        program->length += length;
+    }
+
+    return 0;
+}
+
+/*------------------------------------------------
+ * tape_inject_basic()
+ *
+ *  Put a tokenized BASIC program in as CLOAD would.
+ *  It goes at the start of the program text and the
+ *  line links are worked out again for where it now
+ *  sits. The simple variables, arrays and their end
+ *  all start straight after the two zero bytes that
+ *  end it. It has to fit below the stack as BASIC's
+ *  own out of memory check would have it.
+ *
+ *  param:  Image offset just past the namefile, the program
+ *  return: 1 if it's in place, 0 if not (memory may be altered)
+ */
+static int tape_inject_basic(uint32_t *pos, const tape_program_t *program)
+{
+    uint8_t  type, length, data[256];
+    uint16_t pointers = micro_basic_pointers();
+    if (!pointers) return 0;
+
+    uint16_t text = (mem_read(pointers) << 8) | mem_read(pointers + 1);
+    uint32_t end  = text + program->length;
+
+    if ((program->length < 2) || ((end + TAPE_INJECT_STACK) > cpu.sp)) return 0;
+
+    uint16_t address = text;
+    while ((tape_block_at(pos, &type, &length, data) == 1) && (type == TAPE_BLOCK_DATA))
+    {
+        for (int i=0; i < length; i++)
+        {
+            mem_write(address++, data[i]);
+        }
+    }
+
+    // Each line is the link to the next, the line number, the tokens and a zero
+    uint32_t line = text;
+    while ((line + 1 < end) && (mem_read(line) | mem_read(line + 1)))
+    {
+        uint32_t next = line + 4;
+        while ((next < end) && mem_read(next)) next++;
+        if (++next >= end) return 0;
+
+        mem_write(line,     next >> 8);
+        mem_write(line + 1, next & 0xFF);
+        line = next;
+    }
+    if (line + 1 >= end) return 0;
+
+    uint16_t vars = line + 2;
+    for (int i=2; i < 8; i += 2)
+    {
+        mem_write(pointers + i,     vars >> 8);
+        mem_write(pointers + i + 1, vars & 0xFF);
+    }
+
+    return 1;
+}
+
+/*------------------------------------------------
+ * tape_inject()
+ *
+ *  Put the first program on the .C10 image straight
+ *  into memory - the same end result as CLOAD or as
+ *  CLOADM:EXEC without the ROM loader. The machine is
+ *  first put back to the boot snapshot (BASIC at its
+ *  prompt, see mc10.c) so the stack, interrupts and
+ *  BASIC's pointers are all as the ROM left them. A
+ *  BASIC program is then left at the prompt ready to
+ *  RUN and a machine language one is started at its
+ *  exec address on BASIC's stack. The tape is left
+ *  wound on past the program. Without a boot snapshot
+ *  (or if a BASIC program won't fit) the ROM has to
+ *  load it.
+ *
+ *  param:  Nothing
+ *  return: 1 if the program was injected, 0 if not
+ */
+int tape_inject(void)
+{
+    tape_program_t program;
+    uint8_t  type, length, data[256];
+    uint32_t pos = 0;
+
+    if (!tape_parse(&program) || program.ascii) return 0;
+    if ((program.file_type != TAPE_FILE_BASIC) && (program.file_type != TAPE_FILE_ML)) return 0;
+
+    if ((boot_snapshot_crc != boot_rom_crc) || !snapshot_restore(boot_snapshot)) return 0;
+
+    tape_block_at(&pos, &type, &length, data);      // Namefile
+
+    if (program.file_type == TAPE_FILE_BASIC)
+    {
+        if (!tape_inject_basic(&pos, &program))
+        {
+            snapshot_restore(boot_snapshot);        // Back at the prompt for CLOAD
+            return 0;
+        }
+    }
+    else
+    {
+        uint16_t address = program.load;
+        while ((tape_block_at(&pos, &type, &length, data) == 1) && (type == TAPE_BLOCK_DATA))
+        {
+            for (int i=0; i < length; i++)
+            {
+                mem_write(address++, data[i]);
+            }
+        }
+        cpu.pc = program.exec;
+    }
+
+    tape_pos      = pos;
+    bit_index     = 0;
+    tape_motor    = 0;
+    tape_injected = 1;
+
+    return 1;
+}
+
 /*------------------------------------------------
  * tape_init()
  *
@@ -197,6 +548,7 @@ void tape_init(void)
     bit_timing_threshold = 0;
     bit_timing_count = 0;
     read_cassette_counter = 0;
+    tape_injected = 0;
 }
 
 // End of file
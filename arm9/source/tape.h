@@ -23,11 +23,68 @@ extern int      bit_index;
 extern int      bit_timing_threshold;
 extern int      bit_timing_count;
 extern uint32_t read_cassette_counter;
+extern uint8_t  tape_injected;
+extern uint32_t file_size;
 
+// ------------------------------------------------------------------------
+// The window onto the .C10 image (see tape.c). Sector aligned and a whole
+// number of sectors so each refill is a few whole sectors off the SD card.
+// ------------------------------------------------------------------------
+#define TAPE_SECTOR             512
+#define TAPE_WINDOW             (8*1024)
+
+extern uint8_t  tape_window[TAPE_WINDOW];
+extern uint32_t tape_window_start;
+extern uint32_t tape_window_len;
+
+extern void     tape_window_fill(uint32_t pos);
+
+// .C10 block types and the file types given in the namefile block
+#define TAPE_BLOCK_NAMEFILE     0x00
+#define TAPE_BLOCK_DATA         0x01
+#define TAPE_BLOCK_EOF          0xFF
+
+#define TAPE_FILE_BASIC         0
+#define TAPE_FILE_DATA          1
+#define TAPE_FILE_ML            2
+
+typedef struct
+{
+    char     name[9];
+    uint8_t  file_type;     // TAPE_FILE_xxx
+    uint8_t  ascii;         // 0xFF if saved as ASCII text
+    uint16_t exec;
+    uint16_t load;
+    uint16_t length;        // Total bytes in the data blocks
+} tape_program_t;
+
+extern int     tape_open(const char *filename);
+extern void    tape_close(void);
+extern void    tape_prefetch(void);
 extern void    tape_init(void);
 extern uint8_t tape_read(void);
 extern void    tape_stop(void);
 extern void    tape_rewind(void);
 extern uint8_t tape_guess_type(void);
+extern int     tape_parse(tape_program_t *program);
+extern int     tape_block_read(uint8_t *type, uint8_t *length, uint8_t *data);
+extern int     tape_inject(void);
+
+// ------------------------------------------------------------------------
+// A byte of the .C10 image - past the end reads as 0xFF (no signal). Only
+// a byte outside the window has to wait for the SD card.
+// ------------------------------------------------------------------------
+static inline uint8_t tape_byte_at(uint32_t pos)
+{
+    if (pos >= file_size) return 0xFF;
+
+    if ((pos - tape_window_start) >= tape_window_len)
+    {
+        tape_window_fill(pos);
+        if ((pos - tape_window_start) >= tape_window_len) return 0xFF;   // Couldn't be read
+    }
+
+    return tape_window[pos - tape_window_start];
+}
 
 #endif  /* __TAPE_H__ */
@@ -0,0 +1,387 @@
+// =====================================================================================
+// Copyright (c) 2025 Dave Bernazzani (wavemotion-dave)
+//
+// Copying and distribution of this emulator, its source code and associated
+// readme files, with or without modification, are permitted in any medium without
+// royalty provided this copyright notice is used and wavemotion-dave and eyalabraham
+// (Dragon 32 emu core) are thanked profusely.
+//
+// The Micro-DS emulator is offered as-is, without any warranty. Please see readme.md
+// =====================================================================================
+
+/********************************************************************
+ * tapewav.c
+ *
+ *  Decode a .wav recording of an MC-10 tape. The MC-10 writes each bit
+ *  as one cycle of a square-ish wave - 2400Hz for a 1 and 1200Hz for
+ *  a 0 - least significant bit first. The decoder finds the rising
+ *  edges, times each cycle in samples and turns it into a bit.
+ *
+ *  Between blocks there is no byte framing to go by so the bits are
+ *  only put together into bytes once the leader (0x55) and the sync
+ *  byte (0x3C) that start every block are found. From there the block
+ *  type and length say how many bytes follow. The leader is passed on
+ *  as 0x55 bytes so the result reads just like a .C10 image.
+ *
+ *  The file is read a few sectors at a time and only as far as the
+ *  tape has played (plus half the tape window) - a frame never decodes
+ *  more than TAPE_WAV_BUDGET samples unless something needs a byte
+ *  that isn't decoded yet.
+ *
+ *******************************************************************/
+#include    <nds.h>
+#include    <stdio.h>
+#include    <string.h>
+
+#include    "tape.h"
+#include    "tapewav.h"
+
+#define WAV_BUFFER      4096    // Samples are read this much at a time (a whole number of sectors)
+#define WAV_LEVEL       256     // How far either side of the average the signal must swing for an edge
+
+#define WAV_HUNT        0       // Looking for a block - passing on the leader
+#define WAV_BLOCK       1       // Putting together the bytes of a block
+
+// ------------------------------------------------------------------------
+// Everything the decoder needs to carry on from where it is. A copy of it
+// is the checkpoint for going back to this point on the tape.
+// ------------------------------------------------------------------------
+typedef struct
+{
+    uint32_t    sample;         // The next sample to read
+    uint32_t    out;            // Bytes decoded so far
+    int32_t     average;        // Running average of the signal (24.8) to take out any DC offset
+    uint16_t    period;         // Samples since the last rising edge
+    uint8_t     high;           // 1 while the signal is above the average
+    uint8_t     mode;           // WAV_HUNT or WAV_BLOCK
+    uint8_t     shift;          // The last 8 bits (first one in at the bottom)
+    uint8_t     bits;           // Bits into the byte (block) or since the last leader byte (hunting)
+    uint8_t     leader;         // 1 once some leader has gone by since the last block or gap
+    uint8_t     aligned;        // 1 while hunting on from a block or a gap a byte at a time
+    uint8_t     header;         // Block header bytes still to come (type and length)
+    uint16_t    remaining;      // Block bytes still to come after the header (payload and checksum)
+} wav_decoder_t;
+
+static wav_decoder_t wav;
+static wav_decoder_t wav_checkpoint[TAPE_WAV_CHECKPOINTS];
+static uint32_t      wav_checkpoints    = 0;
+static uint8_t       wav_checkpoint_due = 0;
+static uint8_t       wav_done           = 0;    // Decoded to the end of the recording
+
+static FILE     *wav_file       = NULL;
+static uint32_t  wav_data       = 0;            // Where the samples start in the file
+static uint32_t  wav_samples    = 0;            // How many there are
+static uint32_t  wav_rate       = 0;            // Per second
+static uint16_t  wav_align      = 0;            // Bytes from one sample to the next (all channels)
+static uint8_t   wav_bits       = 0;            // 8 or 16
+
+static uint8_t   wav_buffer[WAV_BUFFER];
+static uint32_t  wav_buffer_start = 0;          // File offset of wav_buffer[0]
+static uint32_t  wav_buffer_len   = 0;
+
+/*------------------------------------------------
+ * tape_wav_open()
+ *
+ *  See if a tape file is a .wav we can decode -
+ *  uncompressed 8 or 16 bit, mono or stereo (only
+ *  the first channel is used), any sample rate.
+ *
+ *  param:  Open file
+ *  return: 1 if it's a .wav tape, 0 if not
+ */
+int tape_wav_open(FILE *file)
+{
+    uint8_t  header[12];
+    uint16_t format = 0;
+
+    wav_file = NULL;
+    wav_rate = 0;
+
+    fseek(file, 0, SEEK_SET);
+    if ((fread(header, 1, 12, file) != 12) || memcmp(header, "RIFF", 4) || memcmp(header + 8, "WAVE", 4)) return 0;
+
+    // Find the format and then the samples - skipping any other chunks
+    while (fread(header, 1, 8, file) == 8)
+    {
+        uint32_t size = header[4] | (header[5] << 8) | (header[6] << 16) | ((uint32_t)header[7] << 24);
+
+        if (!memcmp(header, "fmt ", 4) && (size >= 16))
+        {
+            uint8_t fmt[16];
+            if (fread(fmt, 1, 16, file) != 16) return 0;
+            format    = fmt[0] | (fmt[1] << 8);
+            wav_rate  = fmt[4] | (fmt[5] << 8) | (fmt[6] << 16) | ((uint32_t)fmt[7] << 24);
+            wav_align = fmt[12] | (fmt[13] << 8);
+            wav_bits  = fmt[14];
+            size -= 16;
+        }
+        else if (!memcmp(header, "data", 4))
+        {
+            if ((format != 1) || ((wav_bits != 8) && (wav_bits != 16)) || (wav_rate < 4800) || !wav_align) return 0;
+
+            wav_data    = ftell(file);
+            wav_samples = size / wav_align;
+            break;
+        }
+
+        fseek(file, size + (size & 1), SEEK_CUR);   // Chunks are padded to an even size
+    }
+
+    if (!wav_samples) return 0;
+
+    wav_file         = file;
+    wav_buffer_start = 0;
+    wav_buffer_len   = 0;
+
+    memset(&wav, 0x00, sizeof(wav));
+    wav_checkpoint[0]  = wav;
+    wav_checkpoints    = 1;
+    wav_checkpoint_due = 0;
+    wav_done           = 0;
+
+    // No more than a byte for every 8 cycles of 2400Hz - until we've decoded it all and know
+    file_size = (uint32_t)(((uint64_t)wav_samples * 300) / wav_rate) + 1;
+
+    return 1;
+}
+
+// Read the next sample (first channel) as signed 16-bit
+static inline int32_t wav_read_sample(void)
+{
+    uint32_t offset = wav_data + wav.sample * wav_align;
+
+    if ((offset - wav_buffer_start) + wav_bits/8 > wav_buffer_len)
+    {
+        wav_buffer_start = offset & ~(TAPE_SECTOR - 1);
+        fseek(wav_file, wav_buffer_start, SEEK_SET);
+        wav_buffer_len = fread(wav_buffer, 1, WAV_BUFFER, wav_file);
+        if ((offset - wav_buffer_start) + wav_bits/8 > wav_buffer_len) return 0;
+    }
+
+    const uint8_t *p = wav_buffer + (offset - wav_buffer_start);
+    if (wav_bits == 8) return ((int32_t)p[0] - 128) << 8;
+    return (int16_t)(p[0] | (p[1] << 8));
+}
+
+// Add a decoded byte to the end of the tape window
+static inline void wav_emit(uint8_t byte)
+{
+    tape_window[tape_window_len++] = byte;
+    wav.out++;
+
+    if ((wav.out % TAPE_SECTOR) == 0) wav_checkpoint_due = 1;
+}
+
+/*------------------------------------------------
+ * wav_bit()
+ *
+ *  A bit has been timed. Hunt for the leader and
+ *  sync byte or add it to the byte being put
+ *  together for the block.
+ *
+ *  param:  The bit
+ *  return: Nothing
+ */
+static void wav_bit(uint8_t bit)
+{
+    wav.shift = (wav.shift >> 1) | (bit << 7);
+
+    if (wav.mode == WAV_HUNT)
+    {
+        if ((wav.shift == 0x3C) && wav.leader)
+        {
+            wav.mode   = WAV_BLOCK;
+            wav.bits   = 0;
+            wav.header = 2;
+            wav_emit(0x3C);
+        }
+        else if (wav.aligned)
+        {
+            // Bytes start where the block (or the gap) ended - so even the single
+            // byte of leader between blocks is passed on. Anything else and we
+            // hunt for the leader bit by bit.
+            if (++wav.bits < 8) return;
+            wav.bits = 0;
+            if (wav.shift == 0x55)
+            {
+                wav.leader = 1;
+                wav_emit(0x55);
+            }
+            else
+            {
+                wav.aligned = 0;
+            }
+        }
+        else if ((wav.shift != 0x55) && (wav.shift != 0xAA))
+        {
+            wav.bits = 0;   // Not leader
+        }
+        else
+        {
+            // A byte's worth of leader - between blocks there may be only the one
+            wav.leader = 1;
+            if ((++wav.bits >= 8) && (wav.shift == 0x55))
+            {
+                wav.bits = 0;
+                wav_emit(0x55);
+            }
+        }
+        return;
+    }
+
+    if (++wav.bits < 8) return;
+
+    wav.bits = 0;
+    if (wav.header)
+    {
+        if (--wav.header == 0) wav.remaining = wav.shift + 1;   // That was the length - then the payload and the checksum
+    }
+    else if (--wav.remaining == 0)
+    {
+        wav.mode    = WAV_HUNT; // End of the block
+        wav.leader  = 0;
+        wav.aligned = 1;
+    }
+    wav_emit(wav.shift);
+}
+
+/*------------------------------------------------
+ * wav_sample()
+ *
+ *  Take the next sample - if it starts a new cycle
+ *  the last one becomes a bit.
+ *
+ *  param:  Nothing
+ *  return: Nothing
+ */
+static void wav_sample(void)
+{
+    if (wav.sample >= wav_samples)
+    {
+        wav_done  = 1;
+        file_size = wav.out;
+        return;
+    }
+
+    int32_t level = wav_read_sample();
+    if (wav.sample++ == 0) wav.average = level << 8;    // Start from the first sample so a DC offset isn't taken for an edge
+    wav.average += ((level << 8) - wav.average) >> 10;
+    level -= (wav.average >> 8);
+
+    if (wav.period < 0xFFFF) wav.period++;
+
+    if (wav.high)
+    {
+        if (level < -WAV_LEVEL) wav.high = 0;
+    }
+    else if (level > WAV_LEVEL)
+    {
+        wav.high = 1;
+
+        uint32_t cycle = (uint32_t)wav.period * 1800;   // 1800Hz is between a 1 (2400Hz) and a 0 (1200Hz)
+        if ((uint32_t)wav.period * 4800 < wav_rate)
+        {
+            // Far too short to be a cycle - just noise
+        }
+        else if ((uint32_t)wav.period * 600 > wav_rate)
+        {
+            // A gap (or the start) - any block we were in is lost
+            wav.period  = 0;
+            wav.mode    = WAV_HUNT;
+            wav.bits    = 0;
+            wav.leader  = 0;
+            wav.aligned = 1;
+        }
+        else
+        {
+            wav.period = 0;
+            wav_bit((cycle < wav_rate) ? 1 : 0);
+        }
+    }
+
+    if (wav_checkpoint_due)
+    {
+        wav_checkpoint_due = 0;
+        if ((wav.out / TAPE_SECTOR == wav_checkpoints) && (wav_checkpoints < TAPE_WAV_CHECKPOINTS))
+        {
+            wav_checkpoint[wav_checkpoints++] = wav;
+        }
+    }
+}
+
+/*------------------------------------------------
+ * wav_decode()
+ *
+ *  Decode onto the end of the tape window until
+ *  the given byte is there. When the window fills
+ *  the oldest half is dropped - unless that would
+ *  drop where the tape is and this is only reading
+ *  ahead.
+ *
+ *  param:  Byte wanted, most samples to take, 1 if the byte is needed now
+ *  return: Nothing
+ */
+static void wav_decode(uint32_t pos, uint32_t budget, uint8_t needed)
+{
+    while (!wav_done && (wav.out <= pos) && budget--)
+    {
+        if (tape_window_len == TAPE_WINDOW)
+        {
+            if (!needed && (tape_pos < tape_window_start + TAPE_WINDOW/2)) return;
+
+            memmove(tape_window, tape_window + TAPE_WINDOW/2, TAPE_WINDOW/2);
+            tape_window_start += TAPE_WINDOW/2;
+            tape_window_len   -= TAPE_WINDOW/2;
+        }
+
+        wav_sample();
+    }
+}
+
+/*------------------------------------------------
+ * tape_wav_fill()
+ *
+ *  A byte of the tape is needed that isn't in the
+ *  window. If it's before the window (or there's
+ *  a checkpoint nearer to it than where we are)
+ *  decoding starts again from the checkpoint.
+ *
+ *  param:  Byte wanted
+ *  return: Nothing
+ */
+void tape_wav_fill(uint32_t pos)
+{
+    if (!wav_file) return;
+
+    uint32_t checkpoint = pos / TAPE_SECTOR;
+    if (checkpoint >= wav_checkpoints) checkpoint = wav_checkpoints - 1;
+
+    if ((pos < tape_window_start) || (wav_checkpoint[checkpoint].out > wav.out))
+    {
+        wav               = wav_checkpoint[checkpoint];
+        wav_done          = 0;
+        tape_window_start = wav.out;
+        tape_window_len   = 0;
+    }
+
+    wav_decode(pos, 0xFFFFFFFF, 1);
+}
+
+/*------------------------------------------------
+ * tape_wav_prefetch()
+ *
+ *  Called once a frame. Keep decoding (a little
+ *  at a time) to stay half a window ahead of the
+ *  tape.
+ *
+ *  param:  Nothing
+ *  return: Nothing
+ */
+void tape_wav_prefetch(void)
+{
+    if (!wav_file || wav_done || (tape_pos < tape_window_start)) return;
+
+    wav_decode(tape_pos + TAPE_WINDOW/2, TAPE_WAV_BUDGET, 0);
+}
+
+// End of file
@@ -0,0 +1,32 @@
+// =====================================================================================
+// Copyright (c) 2025 Dave Bernazzani (wavemotion-dave)
+//
+// Copying and distribution of this emulator, its source code and associated
+// readme files, with or without modification, are permitted in any medium without
+// royalty provided this copyright notice is used and wavemotion-dave and eyalabraham
+// (Dragon 32 emu core) are thanked profusely.
+//
+// The Micro-DS emulator is offered as-is, without any warranty. Please see readme.md
+// =====================================================================================
+
+#ifndef __TAPEWAV_H__
+#define __TAPEWAV_H__
+
+#include    <stdio.h>
+#include    <stdint.h>
+
+// ------------------------------------------------------------------------
+// A .wav recording of a tape is decoded into the same bytes a .C10 image
+// holds as the tape plays (see tapewav.c). A checkpoint of the decoder is
+// kept for every TAPE_SECTOR bytes decoded so going back (a rewind, a save
+// state, tape_parse() looking at the first program) only re-decodes from
+// the nearest one. Past the last checkpoint it decodes from there on.
+// ------------------------------------------------------------------------
+#define TAPE_WAV_CHECKPOINTS    1024            // 512K of tape - half an hour or so
+#define TAPE_WAV_BUDGET         4096            // Most samples tape_prefetch() decodes in a frame (over 5x real time at 44.1kHz)
+
+extern int      tape_wav_open(FILE *file);
+extern void     tape_wav_fill(uint32_t pos);
+extern void     tape_wav_prefetch(void);
+
+#endif  /* __TAPEWAV_H__ */
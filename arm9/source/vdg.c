@@ -21,11 +21,11 @@
 /* -----------------------------------------
    Module functions
 ----------------------------------------- */
-void vdg_render_alpha_semi4(int vdg_mem_base);
-void vdg_render_semi6(int vdg_mem_base);
-void vdg_render_resl_graph(video_mode_t mode, int vdg_mem_base);
-void vdg_render_color_graph(video_mode_t mode, int vdg_mem_base);
-void vdg_render_highresolution(video_mode_t mode, int vdg_mem_base);
+void vdg_render_alpha_semi4(int vdg_mem_base, int full);
+void vdg_render_semi6(int vdg_mem_base, int full);
+void vdg_render_resl_graph(video_mode_t mode, int vdg_mem_base, int full);
+void vdg_render_color_graph(video_mode_t mode, int vdg_mem_base, int full);
+void vdg_render_highresolution(video_mode_t mode, int vdg_mem_base, int full);
 
 video_mode_t vdg_get_mode(void);
 
@@ -34,6 +34,10 @@ video_mode_t vdg_get_mode(void);
 ----------------------------------------- */
 video_mode_t current_vdg_mode   __attribute__((section(".dtcm")));
 int reduce_framerate_for_tape   __attribute__((section(".dtcm"))) = 0;
+uint8_t vdg_last_control        __attribute__((section(".dtcm"))) = 0xFF;  // Mode and CSS bits of the last frame rendered
+uint8_t vdg_full_redraw         __attribute__((section(".dtcm"))) = 1;     // Set when the whole screen must be redrawn
+
+uint8_t vdg_shadow[SCREEN_WIDTH_CHAR * SCREEN_HEIGHT_CHAR];                // The characters currently drawn on the text screen
 
 /* The following table lists the pixel ratio of columns and rows
  * relative to a 768x384 frame buffer resolution.
@@ -98,6 +102,32 @@ uint32_t color_translation_32a[16][16] __attribute__((section(".dtcm"))) = {0};
 uint32_t color_artifact_mono_0[16]    __attribute__((section(".dtcm"))) = {0};
 uint32_t color_artifact_mono_1[16]    __attribute__((section(".dtcm"))) = {0};
 
+// Semigraphics 6 rows indexed by [color set][top two bits of the character][nibble]
+uint32_t semi6_translation_32[2][4][16] __attribute__((section(".dtcm"))) = {0};
+
+// Doubles up a 2-bit pair of pixels into a 4-pixel nibble for the 2x wide modes
+uint8_t  pixel_double[4]              __attribute__((section(".dtcm"))) = {0x0, 0x3, 0xC, 0xF};
+
+/*------------------------------------------------
+ * vdg_nibble_word()
+ *
+ *  Build 4 pixels (one byte each, left-most pixel in
+ *  the low byte) from the 4 bits of a nibble.
+ *
+ */
+static uint32_t vdg_nibble_word(uint8_t fg_color, uint8_t bg_color, int nibble)
+{
+    uint32_t word = 0;
+
+    for (int pix = 0; pix < 4; pix++)
+    {
+        uint8_t pixel = (nibble & (0x08 >> pix)) ? fg_color : bg_color;
+        word |= (uint32_t)pixel << (pix * 8);
+    }
+
+    return word;
+}
+
 
 /*------------------------------------------------
  * vdg_init()
@@ -114,6 +144,7 @@ void vdg_init(void)
      */
     current_vdg_mode = ALPHA_INTERNAL;
     reduce_framerate_for_tape = 0;
+    vdg_invalidate();
 
     // --------------------------------------------------------------------------
     // Pre-render the 2-color modes for fast look-up and 32-bit writes for speed
@@ -194,23 +225,73 @@ void vdg_init(void)
         }
         color_artifact_mono_1[pixels_byte] = (buf[3] << 24) | (buf[2] << 16) | (buf[1] << 8) | (buf[0] << 0);
     }
+
+    // ------------------------------------------------------------------------
+    // Pre-render the semigraphics 6 rows. With the high bit set the next bit
+    // picks one of two colors from the color set on a black background. With
+    // the high bit clear, the MC-10 wiring shows the character value itself
+    // as the bit pattern in text-like colors (bit 6 selects the brighter pair).
+    // ------------------------------------------------------------------------
+    for (int css = 0; css < 2; css++)
+    {
+        int color_set = css ? DEF_COLOR_CSS_1 : DEF_COLOR_CSS_0;
+
+        for (int top = 0; top < 4; top++)
+        {
+            uint8_t fg_color, bg_color;
+
+            if (top & 0x02)
+            {
+                bg_color = FB_BLACK;
+                fg_color = colors[top + color_set];
+            }
+            else
+            {
+                bg_color = FB_DKGRN + ((top & 0x01) << 1);
+                fg_color = FB_LTGRN + ((top & 0x01) << 1);
+            }
+
+            for (int nibble = 0; nibble < 16; nibble++)
+            {
+                semi6_translation_32[css][top][nibble] = vdg_nibble_word(fg_color, bg_color, nibble);
+            }
+        }
+    }
+}
+
+/*------------------------------------------------
+ * vdg_invalidate()
+ *
+ *  Force the next vdg_render() to redraw the whole
+ *  screen. Needed whenever video memory or the frame
+ *  buffer changes behind the VDG's back (reset,
+ *  restoring a save state, clearing the screen...)
+ *
+ */
+void vdg_invalidate(void)
+{
+    vdg_full_redraw = 1;
+    vdg_last_control = 0xFF;
 }
 
 /*------------------------------------------------
  * vdg_render()
  *
  *  Render video display.
- *  A full screen rendering is performed at every invocation on the function.
+ *  Only the parts of video memory written since the last frame are
+ *  redrawn (see mem_video_dirty[]). The whole screen is redrawn if the
+ *  mode or color set changes or after vdg_invalidate().
  *
+ *  return: 1 if the mode or color set changed
  */
-ITCM_CODE void vdg_render(void)
+ITCM_CODE int vdg_render(void)
 {
     int vdg_mem_base = 0x4000;
 
     if (tape_motor == 2)
     {
         // When loading tape, the screen refresh is reduced to give more emulation speed
-        if (++reduce_framerate_for_tape < 10) return;
+        if (++reduce_framerate_for_tape < 10) return 0;
         reduce_framerate_for_tape = 0;
     }
 
@@ -218,40 +299,103 @@ ITCM_CODE void vdg_render(void)
      */
     current_vdg_mode = vdg_get_mode();
 
+    /* A change of mode or color set redraws everything and picks
+     * how much of video memory needs watching for writes.
+     */
+    uint8_t control = Memory[0xbfff] & (PIA_COLOR_SET | 0x3C);
+    int changed = (control != vdg_last_control);
+    if (changed)
+    {
+        vdg_last_control = control;
+        vdg_full_redraw = 1;
+        mem_track_video((current_vdg_mode == UNDEFINED) ? 0 : ((resolution[current_vdg_mode][RES_MEM] + 255) >> 8));
+    }
+
+    int full = vdg_full_redraw;
+
     /* Render screen content to frame buffer
      */
     switch ( current_vdg_mode )
     {
         case ALPHA_INTERNAL:
         case SEMI_GRAPHICS_4:
-            vdg_render_alpha_semi4(vdg_mem_base);
+            vdg_render_alpha_semi4(vdg_mem_base, full);
             break;
 
         case SEMI_GRAPHICS_6:
         case ALPHA_EXTERNAL:
-            vdg_render_semi6(vdg_mem_base);
+            vdg_render_semi6(vdg_mem_base, full);
             break;
 
         case GRAPHICS_1C:
         case GRAPHICS_2C:
         case GRAPHICS_3C:
         case GRAPHICS_6C:
-            vdg_render_color_graph(current_vdg_mode, vdg_mem_base);
+            vdg_render_color_graph(current_vdg_mode, vdg_mem_base, full);
             break;
 
         case GRAPHICS_1R:
         case GRAPHICS_2R:
         case GRAPHICS_3R:
-            vdg_render_resl_graph(current_vdg_mode, vdg_mem_base);
+            vdg_render_resl_graph(current_vdg_mode, vdg_mem_base, full);
             break;
 
         case GRAPHICS_6R:
-            vdg_render_highresolution(current_vdg_mode, vdg_mem_base);
+            vdg_render_highresolution(current_vdg_mode, vdg_mem_base, full);
             break;
 
         default:
             break;
     }
+
+    vdg_full_redraw = 0;
+    memset(mem_video_dirty, 0x00, sizeof(mem_video_dirty));
+
+    return changed;
+}
+
+/*------------------------------------------------
+ * vdg_line_dirty()
+ *
+ *  Has the 32 byte chunk of video memory holding
+ *  this address been written since the last frame.
+ *
+ */
+static inline int vdg_line_dirty(int address)
+{
+    return mem_video_dirty[(address - 0x4000) >> 5];
+}
+
+/*------------------------------------------------
+ * vdg_row_changes()
+ *
+ *  For one row of text, return a bitmap of the
+ *  columns whose character differs from what is
+ *  on screen and record the new characters.
+ *
+ * param:  Address of the row in video memory, full redraw
+ * return: 1-bit for each of the 32 columns to be drawn
+ *
+ */
+static inline uint32_t vdg_row_changes(int row_address, int full)
+{
+    uint32_t changed = 0;
+
+    row_address &= 0x4fff;
+    if (!full && !vdg_line_dirty(row_address)) return 0;
+
+    uint8_t *shadow = &vdg_shadow[row_address & 0x1ff];
+    for (int col = 0; col < SCREEN_WIDTH_CHAR; col++)
+    {
+        uint8_t c = Memory[row_address + col];
+        if (full || (c != shadow[col]))
+        {
+            shadow[col] = c;
+            changed |= (1 << col);
+        }
+    }
+
+    return changed;
 }
 
 /*------------------------------------------------
@@ -259,11 +403,11 @@ ITCM_CODE void vdg_render(void)
  *
  *  Render aplphanumeric internal and Semi-graphics 4.
  *
- * param:  VDG memory base address
+ * param:  VDG memory base address, full redraw
  * return: None
  *
  */
-ITCM_CODE void vdg_render_alpha_semi4(int vdg_mem_base)
+ITCM_CODE void vdg_render_alpha_semi4(int vdg_mem_base, int full)
 {
     int         c, row, col, font_row;
     int         char_index, row_address;
@@ -271,24 +415,37 @@ ITCM_CODE void vdg_render_alpha_semi4(int vdg_mem_base)
     uint8_t     color_set;
     uint8_t     vdg_control_reg = Memory[0xbfff];
 
-    uint32_t    *screen_buffer = (uint32_t *)0x06000000;
+    uint32_t    *screen_buffer = (uint32_t *)VDG_FRAME_BUFFER;
 
     if ( vdg_control_reg & PIA_COLOR_SET )
         color_set = FB_LTORG;
     else
         color_set = FB_GREEN;
 
-    // If we are running with MCX 'Large Model', the Video memory is in the other bank
-    uint8_t *screen_memory = (mcx_ram_bank1) ? (Memory_MCX-0x4000) : Memory;
+    // The VDG always displays from bank 0 (even with the MCX 'Large Model' banked in)
+    uint8_t *screen_memory = Memory;
 
     for ( row = 0; row < SCREEN_HEIGHT_CHAR; row++ )
     {
         row_address = row * SCREEN_WIDTH_CHAR + vdg_mem_base;
 
+        uint32_t changed = vdg_row_changes(row_address, full);
+        if (changed == 0)
+        {
+            screen_buffer += FONT_HEIGHT * SCREEN_WIDTH_CHAR * 2;  // Nothing on this row of characters has changed
+            continue;
+        }
+
         for ( font_row = 0; font_row < FONT_HEIGHT; font_row++ )
         {
             for ( col = 0; col < SCREEN_WIDTH_CHAR; col++ )
             {
+                if ( !(changed & (1 << col)) )
+                {
+                    screen_buffer += 2;
+                    continue;
+                }
+
                 c = screen_memory[(col + row_address) & 0x4fff];
 
                 /* Mode dependent initialization
@@ -341,82 +498,62 @@ ITCM_CODE void vdg_render_alpha_semi4(int vdg_mem_base)
  *
  *  Render Semi-graphics 6.
  *
- * param:  VDG memory base address
+ * param:  VDG memory base address, full redraw
  * return: None
  *
  */
-ITCM_CODE void vdg_render_semi6(int vdg_mem_base)
+ITCM_CODE void vdg_render_semi6(int vdg_mem_base, int full)
 {
-    int         c, row, col, font_row, font_col, color_set;
-    int         char_index, row_address;
-    uint8_t     bit_pattern, pix_pos;
-    uint8_t     fg_color, bg_color;
+    int         c, row, col, font_row;
+    int         row_address;
+    uint8_t     bit_pattern;
 
     uint32_t    *screen_buffer;
 
-    screen_buffer = (uint32_t *)0x06000000;
+    screen_buffer = (uint32_t *)VDG_FRAME_BUFFER;
 
-    // If we are running with MCX 'Large Model', the Video memory is in the other bank
-    uint8_t *screen_memory = (mcx_ram_bank1) ? (Memory_MCX-0x4000) : Memory;
+    // The VDG always displays from bank 0 (even with the MCX 'Large Model' banked in)
+    uint8_t *screen_memory = Memory;
 
-    if ( Memory[0xbfff] & PIA_COLOR_SET )
-        color_set = DEF_COLOR_CSS_1;
-    else
-        color_set = DEF_COLOR_CSS_0;
+    uint32_t (*translation)[16] = semi6_translation_32[(Memory[0xbfff] & PIA_COLOR_SET) ? 1 : 0];
 
     for ( row = 0; row < SCREEN_HEIGHT_CHAR; row++ )
     {
         row_address = row * SCREEN_WIDTH_CHAR + vdg_mem_base;
 
+        uint32_t changed = vdg_row_changes(row_address, full);
+        if (changed == 0)
+        {
+            screen_buffer += FONT_HEIGHT * SCREEN_WIDTH_CHAR * 2;  // Nothing on this row of characters has changed
+            continue;
+        }
+
         for ( font_row = 0; font_row < FONT_HEIGHT; font_row++ )
         {
             for ( col = 0; col < SCREEN_WIDTH_CHAR; col++ )
             {
+                if ( !(changed & (1 << col)) )
+                {
+                    screen_buffer += 2;
+                    continue;
+                }
+
                 c = screen_memory[(col + row_address) & 0x4fff];
 
                 if (c & 0x80)
                 {
-                    bg_color = FB_BLACK;
-                    fg_color = colors[(int)(((c & 0b11000000) >> 6) + color_set)];
-
-                    char_index = (int)(((uint8_t) c) & SEMI_GRAPH6_MASK);
-                    bit_pattern = semi_graph_6[char_index][font_row];
+                    bit_pattern = semi_graph_6[c & SEMI_GRAPH6_MASK][font_row];
                 }
                 else // Due to wiring in the MC-10, if the high bit isn't set, we render the actual value as the bit pattern in text-like colors
                 {
-                    bg_color = FB_DKGRN + ((c & 0x40) >> 5);
-                    fg_color = FB_LTGRN + ((c & 0x40) >> 5);
                     bit_pattern = (c & 0x7F);
                 }
 
-                /* Render a row of pixels in a temporary buffer
+                /* Render a row of pixels directly to the screen buffer - 32-bit speed!
                  */
-                pix_pos = 0x80;
-
-                uint8_t buf[8];
-                for ( font_col = 0; font_col < FONT_WIDTH; font_col++ )
-                {
-                    /* Bit is set in Font, print pixel(s) in text color
-                    */
-                    if ( (bit_pattern & pix_pos) )
-                    {
-                        buf[font_col] = fg_color;
-                    }
-                    /* Bit is cleared in Font
-                    */
-                    else
-                    {
-                        buf[font_col] = bg_color;
-                    }
-
-                    /* Move to the next pixel position
-                    */
-                    pix_pos = pix_pos >> 1;
-                }
-
-                uint32_t *ptr32 = (uint32_t *)&buf;
-                *screen_buffer++ = *ptr32++;
-                *screen_buffer++ = *ptr32++;
+                uint32_t *row_colors = translation[c >> 6];
+                *screen_buffer++ = row_colors[bit_pattern >> 4];
+                *screen_buffer++ = row_colors[bit_pattern & 0xF];
             }
         }
     }
@@ -428,68 +565,48 @@ ITCM_CODE void vdg_render_semi6(int vdg_mem_base)
  *  Render high resolution graphics modes:
  *  GRAPHICS_1R, GRAPHICS_2R, GRAPHICS_3R.
  *
- * param:  Mode, base address of video memory buffer.
+ * param:  Mode, base address of video memory buffer, full redraw.
  * return: none
  *
  */
-ITCM_CODE void vdg_render_resl_graph(video_mode_t mode, int vdg_mem_base)
+ITCM_CODE void vdg_render_resl_graph(video_mode_t mode, int vdg_mem_base, int full)
 {
-    int         i, vdg_mem_offset, element, buffer_index;
+    int         i, vdg_mem_offset;
     int         video_mem, row_rep;
-    uint8_t     pixels_byte, fg_color, pixel;
+    uint8_t     pixels_byte;
     uint8_t    *screen_buffer;
-    uint8_t     pixel_row[SCREEN_WIDTH_PIX+16];
+    uint32_t    pixel_row[(SCREEN_WIDTH_PIX+16) / 4];
 
-    screen_buffer = (uint8_t *) (0x06000000);
+    screen_buffer = (uint8_t *) (VDG_FRAME_BUFFER);
 
-    // If we are running with MCX 'Large Model', the Video memory is in the other bank
-    uint8_t *screen_memory = (mcx_ram_bank1) ? (Memory_MCX-0x4000) : Memory;
+    // The VDG always displays from bank 0 (even with the MCX 'Large Model' banked in)
+    uint8_t *screen_memory = Memory;
 
     video_mem = resolution[mode][RES_MEM];
     row_rep = resolution[mode][RES_ROW_REP];
-    buffer_index = 0;
 
-    if ( Memory[0xbfff] & PIA_COLOR_SET )
-    {
-        fg_color = colors[DEF_COLOR_CSS_1];
-    }
-    else
-    {
-        fg_color = colors[DEF_COLOR_CSS_0];
-    }
+    uint32_t *translation = color_translation_32[(Memory[0xbfff] & PIA_COLOR_SET) ? DEF_COLOR_CSS_1 : DEF_COLOR_CSS_0];
 
+    uint32_t *pixRowPtr = pixel_row;
     for ( vdg_mem_offset = 0; vdg_mem_offset < video_mem; vdg_mem_offset++)
     {
-        pixels_byte = screen_memory[(vdg_mem_offset + vdg_mem_base) & 0x4fff];
-
-        if (pixels_byte == 0x00)
-        {
-            memset(pixel_row+buffer_index, FB_BLACK, 16);
-            buffer_index += 16;
-        }
-        else if (pixels_byte == 0xFF)
+        // Skip any line (16 bytes) that hasn't changed
+        if ( (pixRowPtr == pixel_row) && !full && !vdg_line_dirty((vdg_mem_offset + vdg_mem_base) & 0x4fff) )
         {
-            memset(pixel_row+buffer_index, fg_color, 16);
-            buffer_index += 16;
+            vdg_mem_offset += (SCREEN_WIDTH_PIX / 16) - 1;
+            screen_buffer += row_rep * SCREEN_WIDTH_PIX;
+            continue;
         }
-        else
-        for ( element = 0x80; element != 0; element = element >> 1)
-        {
-            if ( pixels_byte & element )
-            {
-                pixel = fg_color;
-            }
-            else
-            {
-                pixel = FB_BLACK;
-            }
 
-            // Expand 2x
-            pixel_row[buffer_index++] = pixel;
-            pixel_row[buffer_index++] = pixel;
-        }
+        pixels_byte = screen_memory[(vdg_mem_offset + vdg_mem_base) & 0x4fff];
 
-        if ( buffer_index >= SCREEN_WIDTH_PIX )
+        // Each pixel is doubled so every 2 bits makes 4 pixels - one word
+        *pixRowPtr++ = translation[pixel_double[(pixels_byte >> 6) & 0x03]];
+        *pixRowPtr++ = translation[pixel_double[(pixels_byte >> 4) & 0x03]];
+        *pixRowPtr++ = translation[pixel_double[(pixels_byte >> 2) & 0x03]];
+        *pixRowPtr++ = translation[pixel_double[(pixels_byte     ) & 0x03]];
+
+        if ( pixRowPtr >= &pixel_row[SCREEN_WIDTH_PIX / 4] )
         {
             for ( i = 0; i < row_rep; i++ )
             {
@@ -497,7 +614,7 @@ ITCM_CODE void vdg_render_resl_graph(video_mode_t mode, int vdg_mem_base)
                 screen_buffer += SCREEN_WIDTH_PIX;
             }
 
-            buffer_index = 0;
+            pixRowPtr = pixel_row;
         }
     }
 }
@@ -509,11 +626,11 @@ ITCM_CODE void vdg_render_resl_graph(video_mode_t mode, int vdg_mem_base)
  *  Render color graphics modes:
  *  GRAPHICS_1C, GRAPHICS_2C, GRAPHICS_3C, and GRAPHICS_6C.
  *
- * param:  Mode, base address of video memory buffer.
+ * param:  Mode, base address of video memory buffer, full redraw.
  * return: none
  *
  */
-ITCM_CODE void vdg_render_color_graph(video_mode_t mode, int vdg_mem_base)
+ITCM_CODE void vdg_render_color_graph(video_mode_t mode, int vdg_mem_base, int full)
 {
     int         i, vdg_mem_offset;
     int         video_mem, row_rep;
@@ -522,10 +639,10 @@ ITCM_CODE void vdg_render_color_graph(video_mode_t mode, int vdg_mem_base)
     uint8_t    *screen_buffer;
     uint8_t     pixel_row[SCREEN_WIDTH_PIX+16];
 
-    screen_buffer = (uint8_t *) (0x06000000);
+    screen_buffer = (uint8_t *) (VDG_FRAME_BUFFER);
 
-    // If we are running with MCX 'Large Model', the Video memory is in the other bank
-    uint8_t *screen_memory = (mcx_ram_bank1) ? (Memory_MCX-0x4000) : Memory;
+    // The VDG always displays from bank 0 (even with the MCX 'Large Model' banked in)
+    uint8_t *screen_memory = Memory;
 
     video_mem = resolution[mode][RES_MEM];
     row_rep = resolution[mode][RES_ROW_REP];
@@ -540,6 +657,14 @@ ITCM_CODE void vdg_render_color_graph(video_mode_t mode, int vdg_mem_base)
         uint16_t *pixRowPtr = (uint16_t *)pixel_row;
         for ( vdg_mem_offset = 0; vdg_mem_offset < video_mem; vdg_mem_offset++)
         {
+            // Skip any line (16 bytes) that hasn't changed
+            if ( (pixRowPtr == (uint16_t *)pixel_row) && !full && !vdg_line_dirty((vdg_mem_offset + vdg_mem_base) & 0x4fff) )
+            {
+                vdg_mem_offset += (SCREEN_WIDTH_PIX / 16) - 1;
+                screen_buffer += row_rep * SCREEN_WIDTH_PIX;
+                continue;
+            }
+
             pixels_byte = screen_memory[(vdg_mem_offset + vdg_mem_base) & 0x4fff];
 
             *pixRowPtr++ = colors16[((pixels_byte >> 6) & 0x03) | color_set];
@@ -571,6 +696,14 @@ ITCM_CODE void vdg_render_color_graph(video_mode_t mode, int vdg_mem_base)
         uint16_t *pixRowPtr = (uint16_t *)pixel_row;
         for ( vdg_mem_offset = 0; vdg_mem_offset < video_mem; vdg_mem_offset++)
         {
+            // Skip any line (32 bytes) that hasn't changed
+            if ( (pixRowPtr == (uint16_t *)pixel_row) && !full && !vdg_line_dirty((vdg_mem_offset + vdg_mem_base) & 0x4fff) )
+            {
+                vdg_mem_offset += (SCREEN_WIDTH_PIX / 8) - 1;
+                screen_buffer += row_rep * SCREEN_WIDTH_PIX;
+                continue;
+            }
+
             pixels_byte = screen_memory[(vdg_mem_offset + vdg_mem_base) & 0x4fff];
 
             *pixRowPtr++ = colors16[((pixels_byte >> 6) & 0x03) | color_set];
@@ -599,7 +732,7 @@ ITCM_CODE void vdg_render_color_graph(video_mode_t mode, int vdg_mem_base)
 // Therefore, we just output this as pure mono (White/Black or Green/Black)
 // No need to get fancy, virtually nothing on the MC-10 uses this anyway.
 // ------------------------------------------------------------------------
-ITCM_CODE void vdg_render_highresolution(video_mode_t mode, int vdg_mem_base)
+ITCM_CODE void vdg_render_highresolution(video_mode_t mode, int vdg_mem_base, int full)
 {
     int         vdg_mem_offset;
     int         video_mem;
@@ -607,8 +740,8 @@ ITCM_CODE void vdg_render_highresolution(video_mode_t mode, int vdg_mem_base)
     uint32_t   *screen_buffer;
     uint8_t     pix_char = 0;
 
-    // If we are running with MCX 'Large Model', the Video memory is in the other bank
-    uint8_t *screen_memory = (mcx_ram_bank1) ? (Memory_MCX-0x4000) : Memory;
+    // The VDG always displays from bank 0 (even with the MCX 'Large Model' banked in)
+    uint8_t *screen_memory = Memory;
 
     if ( Memory[0xbfff] & PIA_COLOR_SET )
     {
@@ -619,13 +752,21 @@ ITCM_CODE void vdg_render_highresolution(video_mode_t mode, int vdg_mem_base)
         fg_color = colors[DEF_COLOR_CSS_0];
     }
 
-    screen_buffer = (uint32_t *) (0x06000000);
+    screen_buffer = (uint32_t *) (VDG_FRAME_BUFFER);
 
     video_mem = resolution[mode][RES_MEM];
     uint8_t bDoubleRez = ((resolution[mode][RES_ROW_REP]) > 1) ? 1:0;
 
     for ( vdg_mem_offset = 0; vdg_mem_offset < video_mem; vdg_mem_offset++)
     {
+        // Skip any line (32 bytes) that hasn't changed
+        if ( (pix_char == 0) && !full && !vdg_line_dirty(vdg_mem_offset + vdg_mem_base) )
+        {
+            vdg_mem_offset += 31;
+            screen_buffer += (bDoubleRez ? 128 : 64);
+            continue;
+        }
+
         pixels_byte = screen_memory[vdg_mem_offset + vdg_mem_base];
 
         if (fg_color == FB_GREEN)
@@ -17,6 +17,12 @@
 #define     SCREEN_WIDTH_PIX        256
 #define     SCREEN_HEIGHT_PIX       192
 
+// The top screen is a 256x192 8-bit bitmap in VRAM bank A. The headless
+// host build (see host/) renders into an ordinary buffer instead.
+#ifndef VDG_FRAME_BUFFER
+#define     VDG_FRAME_BUFFER        0x06000000
+#endif
+
 #define     SCREEN_WIDTH_CHAR       32
 #define     SCREEN_HEIGHT_CHAR      16
 
@@ -89,8 +95,10 @@ typedef enum
    Module globals
 ----------------------------------------- */
 extern video_mode_t current_vdg_mode;
+extern uint8_t      vdg_full_redraw;
 
 void vdg_init(void);
-void vdg_render(void);
+int  vdg_render(void);
+void vdg_invalidate(void);
 
 #endif  /* __VDG_H__ */
@@ -0,0 +1,515 @@
+// =====================================================================================
+// Copyright (c) 2025 Dave Bernazzani (wavemotion-dave)
+//
+// Copying and distribution of this emulator, its source code and associated
+// readme files, with or without modification, are permitted in any medium without
+// royalty provided this copyright notice is used and wavemotion-dave and eyalabraham
+// (Dragon 32 emu core) are thanked profusely.
+//
+// The Micro-DS emulator is offered as-is, without any warranty. Please see readme.md
+// =====================================================================================
+
+/********************************************************************
+ * bench.c
+ *
+ *  Headless benchmark for the Micro-DS core. Runs a number of emulated
+ *  frames (262 scanlines of 57 cycles each) as fast as the host allows
+ *  and reports the achieved cycle and frame rates.
+ *
+ *  Given a BASIC ROM image (and optionally a .C10 tape to CLOAD) the
+ *  whole machine is run just as micro_run() does on the DS - CPU, VDG
+ *  rendering and the beeper audio - and the time spent in each stage
+ *  is reported. With no ROM, the CPU alone runs a small built-in 6803
+ *  workload (or random op-codes) so the op-code dispatch can be compared
+ *  between builds (see host/Makefile). ROM code goes through the predecode
+ *  cache whichever dispatch is built so -R runs the workload from RAM to
+ *  time the dispatch itself.
+ *
+ *  With -w a rewind point is added every few frames as the DS does and
+ *  the time that takes is reported alongside the emulation itself. With
+ *  -a the frame drawn is the one a few frames on, as the DS run-ahead
+ *  option does, which is counted in the render time.
+ *
+ *  The final machine state is hashed so that two builds can be checked
+ *  for equivalence, and builds with CPU_TRACE can write a per-instruction
+ *  trace so two core variants can be compared instruction by instruction.
+ *
+ *******************************************************************/
+#include    <stdio.h>
+#include    <stdlib.h>
+#include    <time.h>
+
+#include    <nds.h>
+
+#include    "cpu.h"
+#include    "mem.h"
+#include    "vdg.h"
+#include    "tape.h"
+#include    "audio.h"
+#include    "capture.h"
+#include    "hle.h"
+#include    "rewind.h"
+#include    "MicroDS.h"
+#include    "MicroUtils.h"
+
+#define NTSC_SCANLINES      262
+#define CYCLES_PER_LINE     57
+#define SAMPLES_PER_FRAME   262     // What the DS sound stream (15720Hz) drains each 60Hz frame
+
+// ------------------------------------------------------------------------
+// Built-in workload: fill 4K of RAM, then sum it back 16 bits at a time
+// with a subroutine call per word, forever. Mixes immediate, direct,
+// indexed and extended addressing with branches and stack traffic.
+// ------------------------------------------------------------------------
+static const uint8_t bench_code[] =
+{
+    0x8E, 0x00, 0xFF,       // C000: LDS  #$00FF
+    0xCE, 0x40, 0x00,       // C003: LDX  #$4000
+    0x86, 0x00,             // C006: LDAA #$00
+    0xA7, 0x00,             // C008: STAA 0,X
+    0x8B, 0x07,             // C00A: ADDA #$07
+    0x08,                   // C00C: INX
+    0x8C, 0x50, 0x00,       // C00D: CPX  #$5000
+    0x26, 0xF6,             // C010: BNE  $C008
+    0xCE, 0x40, 0x00,       // C012: LDX  #$4000
+    0x4F,                   // C015: CLRA
+    0x5F,                   // C016: CLRB
+    0xE3, 0x00,             // C017: ADDD 0,X
+    0x08,                   // C019: INX
+    0x08,                   // C01A: INX
+    0xBD, 0xC0, 0x30,       // C01B: JSR  $C030
+    0x8C, 0x50, 0x00,       // C01E: CPX  #$5000
+    0x26, 0xF4,             // C021: BNE  $C017
+    0xDD, 0x90,             // C023: STD  $90
+    0x7E, 0xC0, 0x03,       // C025: JMP  $C003
+    0x01, 0x01, 0x01, 0x01, // C028: NOP padding
+    0x01, 0x01, 0x01, 0x01,
+    0x36,                   // C030: PSHA
+    0x44,                   // C031: LSRA
+    0x49,                   // C032: ROLA
+    0x32,                   // C033: PULA
+    0x39,                   // C034: RTS
+};
+
+// Where the workload has an absolute address (the high byte of the JSR and JMP)
+static const uint8_t bench_code_fixups[] = {0x1C, 0x26};
+
+#define BENCH_RAM_ORIGIN    0x6000  // Where -R puts the workload (RAM on every machine)
+
+static FILE *trace_fp    = NULL;
+static uint32_t traced   = 0;    // Instructions written to the trace
+
+#ifdef CPU_TRACE
+// ------------------------------------------------------------------------
+// Called by cpu_run() before every instruction - one line per instruction
+// ------------------------------------------------------------------------
+void cpu_trace(uint8_t cc)
+{
+    if (trace_fp)
+    {
+        traced++;
+        fprintf(trace_fp, "%04X %02X A=%02X B=%02X X=%04X S=%04X CC=%02X T=%04X\n", cpu.pc, Memory[cpu.pc],
+                cpu.ab.ab.a, cpu.ab.ab.b, cpu.x, cpu.sp, cc, cpu.counter);
+    }
+}
+#endif
+
+// ------------------------------------------------------------------------
+// The soup soon runs into an illegal op-code (or a loop it never leaves).
+// Carry on from another address in it so that a run covers millions of
+// instructions. The new PC comes from the seed so every build of the core
+// goes to the same place.
+// ------------------------------------------------------------------------
+static uint32_t soup_seed     = 0;
+static uint32_t soup_restarts = 0;
+
+static void soup_restart(void)
+{
+    soup_seed = soup_seed * 1103515245u + 12345u;
+    cpu.pc = 0xC000 + ((soup_seed >> 16) % 0x3FF0);
+    cpu.cpu_state = CPU_EXEC;
+    soup_restarts++;
+}
+
+// ------------------------------------------------------------------------
+// Fill RAM and the 16K ROM image with pseudo-random bytes for exercising
+// every instruction and flag path. WAI and the two halting op-codes are
+// replaced by NOP in the ROM and the vectors all point back into the soup.
+// ------------------------------------------------------------------------
+static void random_soup(uint32_t seed)
+{
+    soup_seed = seed;   // Where it carries on from is seeded too
+
+    for (int addr=0x4000; addr<0x10000; addr++)
+    {
+        seed = seed * 1103515245u + 12345u;
+        uint8_t byte = seed >> 16;
+        if (addr >= 0xC000 && (byte == 0x4e || byte == 0x5e || byte == 0x3e)) byte = 0x01;
+        if (addr >= 0xC000) MCXBASIC[addr - 0xC000] = byte;
+        else if (addr < 0x9000) Memory[addr] = byte;
+    }
+
+    for (int addr=0x3FF0; addr<0x4000; addr+=2)
+    {
+        MCXBASIC[addr] |= 0xC0;
+    }
+}
+
+// CPU time of this process - unlike the wall clock, time the host gives to other processes isn't counted
+static double now_seconds(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// FNV-1a over the registers and the RAM so two builds can be compared
+static uint32_t state_hash(void)
+{
+    uint32_t hash = 2166136261u;
+    uint8_t regs[] = {cpu.ab.ab.a, cpu.ab.ab.b, cpu.x >> 8, cpu.x & 0xFF, cpu.sp >> 8, cpu.sp & 0xFF, cpu.pc >> 8, cpu.pc & 0xFF};
+
+    for (int i=0; i<sizeof(regs); i++)    { hash ^= regs[i];    hash *= 16777619u; }
+    for (int i=0; i<0xC000; i++)          { hash ^= Memory[i];  hash *= 16777619u; }
+
+    return hash;
+}
+
+// ------------------------------------------------------------------------
+// Load a ROM image for the whole machine. An 8K MICROCOLOR BASIC (or the
+// ALICE ROM with -m 3) is loaded by micro_reset() while a 16K image is
+// the MCX ROM which is paged straight out of MCXBASIC[].
+// ------------------------------------------------------------------------
+static int load_rom(const char *path)
+{
+    static uint8_t image[0x4000];
+
+    FILE *fp = fopen(path, "rb");
+    if (!fp) return 0;
+
+    int len = fread(image, 1, sizeof(image), fp);
+    fclose(fp);
+
+    if (len == 0x2000)
+    {
+        memcpy(MC10BASIC, image, sizeof(MC10BASIC));
+        memcpy(ALICE4K, image, sizeof(ALICE4K));
+        bALICE_found = (myConfig.machine == MACHINE_ALICE);
+    }
+    else if ((len == 0x4000) && (myConfig.machine == MACHINE_MCX))
+    {
+        memcpy(MCXBASIC, image, sizeof(MCXBASIC));
+        bMCX_found = true;
+    }
+    else
+    {
+        return 0;
+    }
+
+    return 1;
+}
+
+// ------------------------------------------------------------------------
+// Open a .C10 cassette image as MC10Init() does - it's read as it plays.
+// ------------------------------------------------------------------------
+static int load_tape(const char *path)
+{
+    return tape_open(path) && (file_size > 0);
+}
+
+// ------------------------------------------------------------------------
+// A very small typist so a tape can be loaded and run without a human.
+// Each character is held for a few frames and then released, much like
+// the buffered keys the DS front end uses for the START/SELECT shortcuts.
+// ------------------------------------------------------------------------
+static const char *typing = NULL;
+static int         typing_frames = 0;
+
+static u8 bench_scan_code(char c)
+{
+    if (c >= 'A' && c <= 'Z') return KBD_A + (c - 'A');
+    if (c >= '1' && c <= '9') return KBD_1 + (c - '1');
+    if (c == '0')  return KBD_0;
+    if (c == ':')  return KBD_COLON;
+    if (c == ' ')  return KBD_SPACE;
+    return KBD_ENTER;
+}
+
+static void bench_keyboard(void)
+{
+    kbd_keys_pressed = 0;
+
+    if (typing && *typing)
+    {
+        if (typing_frames < 3)  // Hold the key...
+        {
+            kbd_keys[0] = bench_scan_code(*typing);
+            kbd_keys_pressed = 1;
+        }
+
+        if (++typing_frames == 6) // ...then let go of it
+        {
+            typing_frames = 0;
+            typing++;
+        }
+    }
+
+    kbd_build_matrix();
+}
+
+static void usage(void)
+{
+    printf("usage: bench [-f frames] [-m machine] [-r seed] [-R] [-t trace.txt] [-x hle] [-i] [-w] [-a frames] [-s audio.wav] [rom.bin [tape.c10]]\n");
+    printf("   -f  number of 60Hz frames to emulate (default 3600)\n");
+    printf("   -m  machine: 0=20K, 1=32K, 2=MCX, 3=ALICE (default 0)\n");
+    printf("   -r  run pseudo-random op-codes from this seed instead of the built-in workload\n");
+    printf("   -R  run the built-in workload from RAM, where nothing is predecoded (times the op-code dispatch)\n");
+    printf("   -t  write an instruction trace (CPU_TRACE builds only)\n");
+    printf("   -i  put a machine language tape straight into memory rather than CLOADM:EXEC\n");
+    printf("   -x  native ROM floating point: 0=off, 1=strict, 2=turbo (default 0)\n");
+    printf("   -w  add rewind points as the DS does (with its rewind memory) and time them\n");
+    printf("   -a  run ahead this many frames before drawing each frame (needs a ROM)\n");
+    printf("   -s  record the beeper to a .wav file (needs a ROM)\n");
+    printf("   With an 8K BASIC ROM (16K for the MCX) the whole machine is run and the\n");
+    printf("   tape, if given, is loaded with CLOAD (or CLOADM:EXEC) and then RUN.\n");
+    exit(1);
+}
+
+int main(int argc, char *argv[])
+{
+    int frames = 3600;
+    const char *rom = NULL;
+    const char *tape = NULL;
+    const char *trace = NULL;
+    const char *wav = NULL;
+    int seed = 0;
+    int inject = 0;
+    int rewind = 0;
+    int in_ram = 0;
+
+    for (int i=1; i<argc; i++)
+    {
+        if      (!strcmp(argv[i], "-f") && (i+1 < argc)) frames = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-m") && (i+1 < argc)) myConfig.machine = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-r") && (i+1 < argc)) seed = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-t") && (i+1 < argc)) trace = argv[++i];
+        else if (!strcmp(argv[i], "-R")) in_ram = 1;
+        else if (!strcmp(argv[i], "-i")) inject = 1;
+        else if (!strcmp(argv[i], "-w")) rewind = 1;
+        else if (!strcmp(argv[i], "-a") && (i+1 < argc)) myConfig.runAhead = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-x") && (i+1 < argc)) myConfig.hleMath = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-s") && (i+1 < argc)) wav = argv[++i];
+        else if (argv[i][0] == '-') usage();
+        else if (!rom) rom = argv[i];
+        else tape = argv[i];
+    }
+
+    if (rom)
+    {
+        if (!load_rom(rom))
+        {
+            printf("Unable to load an 8K ROM image (16K with -m 2) from %s\n", rom);
+            return 1;
+        }
+
+        if (tape && !load_tape(tape))
+        {
+            printf("Unable to load tape image %s\n", tape);
+            return 1;
+        }
+
+        micro_reset();
+    }
+    else
+    {
+        mem_init();
+
+        if (seed)
+        {
+            random_soup(seed);
+        }
+        else if (in_ram)
+        {
+            memcpy(Memory + BENCH_RAM_ORIGIN, bench_code, sizeof(bench_code));
+            for (int i=0; i<sizeof(bench_code_fixups); i++)
+            {
+                Memory[BENCH_RAM_ORIGIN + bench_code_fixups[i]] = BENCH_RAM_ORIGIN >> 8;
+            }
+            MCXBASIC[0x3FFE] = BENCH_RAM_ORIGIN >> 8;
+            MCXBASIC[0x3FFF] = 0x00;
+        }
+        else
+        {
+            memcpy(MCXBASIC, bench_code, sizeof(bench_code));
+            MCXBASIC[0x3FFE] = 0xC0;
+            MCXBASIC[0x3FFF] = 0x00;
+        }
+
+        // The MCX pages its ROM straight out of MCXBASIC[] - the others run it from Memory[]
+        if (myConfig.machine == MACHINE_MCX)
+        {
+            bMCX_found = true;
+            mem_map_build();
+        }
+        else
+        {
+            mem_load_rom(0xc000, MCXBASIC, sizeof(MCXBASIC));
+        }
+
+        cpu_init();
+        cpu_reset(1);
+        cpu_check_reset();
+    }
+
+    if (wav && !capture_start(wav, NTSC_SCANLINES * 60))
+    {
+        printf("Unable to create audio file %s\n", wav);
+        return 1;
+    }
+
+    if (rewind && !rewind_init(REWIND_DS_MEMORY))
+    {
+        printf("Unable to allocate the rewind memory\n");
+        return 1;
+    }
+
+    if (trace)
+    {
+        trace_fp = fopen(trace, "w");
+        if (!trace_fp)
+        {
+            printf("Unable to create trace file %s\n", trace);
+            return 1;
+        }
+    }
+
+    // -------------------------------------------------------------------
+    // The whole machine runs as micro_run() does on the DS: one scanline
+    // of audio sampling and CPU at a time and the VDG at the end of each
+    // frame. The sampling is interleaved with the CPU so it is counted
+    // there; the audio stage is draining the samples as the stream would.
+    // -------------------------------------------------------------------
+    double cpu_time = 0, render_time = 0, audio_time = 0, rewind_time = 0;
+    static s16 samples[SAMPLES_PER_FRAME*2];
+    uint32_t last_tape_pos = 0;
+    int tape_idle_frames = 0, run_typed = 0, boot_frame = 0;
+
+    double start = now_seconds();
+
+    for (int frame=0; frame<frames; frame++)
+    {
+        double t0 = now_seconds();
+
+        if (rom)
+        {
+            // Give BASIC a couple of seconds to boot before typing at it
+            if (tape && frame == 120 && !(inject && tape_inject()))
+            {
+                typing = (tape_guess_type() == AUTOLOAD_CLOADM) ? "CLOADM:EXEC\n" : "CLOAD\n";
+            }
+            // Once the tape has stopped moving for a second, a BASIC program is loaded and can be RUN
+            if (tape_pos != last_tape_pos) tape_idle_frames = 0;
+            else if (tape_pos && ++tape_idle_frames == 60 && !run_typed && tape_guess_type() == AUTOLOAD_CLOAD)
+            {
+                typing = "RUN\n";
+                run_typed = 1;
+            }
+            last_tape_pos = tape_pos;
+            bench_keyboard();
+            if ((frame % 60) == 59) read_cassette_counter = 0; // Once per second as on the DS
+
+            for (int line=0; line<NTSC_SCANLINES; line++)
+            {
+                processDirectAudio();
+                cpu_run();
+            }
+            cpu_cycle_deficit = 0;
+            audio_frame();
+
+            double t1 = now_seconds();
+            if (myConfig.runAhead && !tape_motor) micro_run_ahead(myConfig.runAhead);
+            else vdg_render();
+            double t2 = now_seconds();
+            audio_fill_stream(samples, SAMPLES_PER_FRAME);
+            capture_flush();
+            double t3 = now_seconds();
+
+            u32 snapshot_crc = boot_snapshot_crc;
+            micro_boot_frame();
+            if (boot_snapshot_crc != snapshot_crc) boot_frame = frame + 1;
+
+            cpu_time    += t1 - t0;
+            render_time += t2 - t1;
+            audio_time  += t3 - t2;
+        }
+        else
+        {
+            if (seed) soup_restart();   // Out of whatever loop it was in
+
+            for (int line=0; line<NTSC_SCANLINES; line++)
+            {
+                cpu_run();
+                if (seed && (cpu.cpu_state == CPU_EXCEPTION)) soup_restart();
+            }
+            cpu_cycle_deficit = 0;
+            cpu_time += now_seconds() - t0;
+        }
+
+        if (rewind)
+        {
+            double t4 = now_seconds();
+            rewind_frame();
+            rewind_time += now_seconds() - t4;
+        }
+    }
+
+    double elapsed = now_seconds() - start;
+
+    if (trace_fp) fclose(trace_fp);
+    capture_stop();
+
+    double cycles  = (double)frames * NTSC_SCANLINES * CYCLES_PER_LINE;
+
+#ifdef CPU_THREADED_DISPATCH
+    const char *dispatch = "threaded";
+#else
+    const char *dispatch = "switch";
+#endif
+#ifdef CPU_LAZY_FLAGS
+    const char *flags = "lazy";
+#else
+    const char *flags = "eager";
+#endif
+    static const char *hle_mode[] = {"off", "strict", "turbo"};
+
+    printf("core     : %s dispatch, %s flags\n", dispatch, flags);
+    if (rom) printf("workload : %s%s%s\n", rom, tape ? " + " : "", tape ? tape : "");
+    else if (seed) printf("workload : random op-codes (%u restarts)\n", soup_restarts);
+    else     printf("workload : %s\n", in_ram ? "built-in (from RAM)" : "built-in");
+    printf("frames   : %d (%.0f cycles)\n", frames, cycles);
+    printf("time     : %.3f sec\n", elapsed);
+    printf("speed    : %.2f Mcycles/sec (%.1fx real time)\n", cycles / elapsed / 1e6, (frames / 60.0) / elapsed);
+    printf("fps      : %.1f frames/sec\n", frames / elapsed);
+    printf("cpu      : %.3f sec (%.1f usec/frame)\n", cpu_time, cpu_time * 1e6 / frames);
+    if (rom)
+    {
+        printf("render   : %.3f sec (%.1f usec/frame)%s\n", render_time, render_time * 1e6 / frames,
+               myConfig.runAhead ? " with run-ahead" : "");
+        printf("audio    : %.3f sec (%.1f usec/frame), %u underruns, %u overruns\n", audio_time, audio_time * 1e6 / frames,
+               audio_underruns, audio_overruns);
+        printf("hle      : %s, %u native calls\n", hle_mode[myConfig.hleMath % 3], hle_calls);
+        if (boot_frame) printf("boot     : at the prompt by frame %d\n", boot_frame);
+        else            printf("boot     : prompt not seen\n");
+    }
+    if (rewind)
+    {
+        printf("rewind   : %.3f sec (%.1f usec/frame, %.1f%% of the cpu time), %u points held\n", rewind_time,
+               rewind_time * 1e6 / frames, rewind_time * 100.0 / cpu_time, rewind_points);
+    }
+    if (trace) printf("trace    : %u instructions\n", traced);
+    printf("state    : %08X (PC=%04X)\n", state_hash(), cpu.pc);
+
+    return (cpu.cpu_state == CPU_EXCEPTION) ? 2 : 0;
+}
+
+// End of file
@@ -0,0 +1,296 @@
+// =====================================================================================
+// Copyright (c) 2025 Dave Bernazzani (wavemotion-dave)
+//
+// Copying and distribution of this emulator, its source code and associated
+// readme files, with or without modification, are permitted in any medium without
+// royalty provided this copyright notice is used and wavemotion-dave and eyalabraham
+// (Dragon 32 emu core) are thanked profusely.
+//
+// The Micro-DS emulator is offered as-is, without any warranty. Please see readme.md
+// =====================================================================================
+
+/********************************************************************
+ * fastload.c
+ *
+ *  Host check of FAST LOAD (hle_block_in() in hle.c). A stand-in ROM
+ *  has a cassette block reader written the way the MC-10's is - it
+ *  times the pulses on the cassette input bit by bit, hunts for the
+ *  sync byte and fills the buffer CBUFAD points at. A test tape is
+ *  read block by block twice: once with FAST LOAD off (the ROM code
+ *  and tape_read() doing it a bit at a time) and once with it on.
+ *  The block type, length, error code, buffer, A, X and flags left by
+ *  each block must come out the same both ways. The tape has a block
+ *  with a bad checksum and one with junk in front of its leader to
+ *  check the hand over between the two readers - the fast path leaves
+ *  the junk to the ROM and takes the block once the ROM's sync hunt
+ *  (which loops back through the entry point) has read past it.
+ *
+ *  Exits non-zero if any check fails.
+ *
+ *******************************************************************/
+#include    <stdio.h>
+#include    <stdlib.h>
+#include    <string.h>
+
+#include    <nds.h>
+
+#include    "cpu.h"
+#include    "mem.h"
+#include    "tape.h"
+#include    "hle.h"
+#include    "MicroDS.h"
+#include    "MicroUtils.h"
+
+#define TAPE_FILE           "fastload-test.c10"
+#define BLOCKS              7           // Namefile, 3 data, bad checksum, junk in front, EOF
+#define DRIVER              0x5000      // JSR BLKIN in RAM (so it works with any ROM)
+#define DRIVER_STOP         (DRIVER + 0x08)
+#define DRIVER_STACK        0x4EFF
+#define BUFFER              0x4000
+#define FLAGS               0xF0        // Where the driver leaves the flags
+
+// ------------------------------------------------------------------------
+// The stand-in ROM at E000 (and mirrored at C000) - a reset that sits
+// still and a cassette block reader with BLKTYP at $E0, BLKLEN at $E1,
+// CBUFAD at $E2-E3 and CSRERR at $E4 (the rest of $E5-E9 is its own).
+// ------------------------------------------------------------------------
+#define STANDIN_BLKIN       0xE062
+#define STANDIN_CODE        0xE040
+
+static const uint8_t standin_reset[] =
+{
+    0x8E, 0x4E, 0xFF,       // E000  LDS  #$4EFF
+    0x0F,                   // E003  SEI
+    0x20, 0xFE,             // E004  BRA  *
+};
+
+static const uint8_t standin_cassette[] =
+{
+    0x5F,                   // E040  RDBIT  CLRB         bit in C - a 1 is a short pulse
+    0x96, 0x03,             // E041  HIGH   LDAA $03
+    0x85, 0x10,             // E043         BITA #$10
+    0x26, 0xFA,             // E045         BNE  HIGH    wait for the input to go low
+    0x5C,                   // E047  LOW    INCB
+    0x96, 0x03,             // E048         LDAA $03
+    0x85, 0x10,             // E04A         BITA #$10
+    0x27, 0xF9,             // E04C         BEQ  LOW     count the reads it stays low
+    0xC1, 0x08,             // E04E         CMPB #8
+    0x39,                   // E050         RTS
+    0x86, 0x08,             // E051  RDBYTE LDAA #8      byte in A - least significant bit first
+    0x97, 0xE7,             // E053         STAA CNT
+    0x8D, 0xE9,             // E055  NEXT   BSR  RDBIT
+    0x76, 0x00, 0xE6,       // E057         ROR  BYTE
+    0x7A, 0x00, 0xE7,       // E05A         DEC  CNT
+    0x26, 0xF6,             // E05D         BNE  NEXT
+    0x96, 0xE6,             // E05F         LDAA BYTE
+    0x39,                   // E061         RTS
+    0x8D, 0xDC,             // E062  BLKIN  BSR  RDBIT   the block reader - hunt for the sync byte
+    0x76, 0x00, 0xE5,       // E064         ROR  SHIFT
+    0x96, 0xE5,             // E067         LDAA SHIFT
+    0x81, 0x3C,             // E069         CMPA #$3C
+    0x26, 0xF5,             // E06B         BNE  BLKIN
+    0x8D, 0xE2,             // E06D         BSR  RDBYTE
+    0x97, 0xE0,             // E06F         STAA BLKTYP
+    0x97, 0xE9,             // E071         STAA SUM
+    0x8D, 0xDC,             // E073         BSR  RDBYTE
+    0x97, 0xE1,             // E075         STAA BLKLEN
+    0x97, 0xE8,             // E077         STAA LEFT
+    0x9B, 0xE9,             // E079         ADDA SUM
+    0x97, 0xE9,             // E07B         STAA SUM
+    0xDE, 0xE2,             // E07D         LDX  CBUFAD
+    0x7D, 0x00, 0xE8,       // E07F         TST  LEFT
+    0x27, 0x0E,             // E082         BEQ  CHECK
+    0x8D, 0xCB,             // E084  DATA   BSR  RDBYTE
+    0xA7, 0x00,             // E086         STAA 0,X
+    0x08,                   // E088         INX
+    0x9B, 0xE9,             // E089         ADDA SUM
+    0x97, 0xE9,             // E08B         STAA SUM
+    0x7A, 0x00, 0xE8,       // E08D         DEC  LEFT
+    0x26, 0xF2,             // E090         BNE  DATA
+    0x8D, 0xBD,             // E092  CHECK  BSR  RDBYTE
+    0x91, 0xE9,             // E094         CMPA SUM
+    0x27, 0x05,             // E096         BEQ  GOOD
+    0x86, 0x01,             // E098         LDAA #1      bad checksum
+    0x97, 0xE4,             // E09A         STAA CSRERR
+    0x39,                   // E09C         RTS
+    0x4F,                   // E09D  GOOD   CLRA
+    0x97, 0xE4,             // E09E         STAA CSRERR
+    0x39,                   // E0A0         RTS
+};
+
+static const hle_trap_t     standin_traps[]  = {{0x0000, 0, NULL}};
+static const hle_cassette_t standin_reader   = {STANDIN_BLKIN, 0xE0, 0xE1, 0xE2, 0xE4};
+static const hle_rom_t      standin_rom      = {0x00000000, 0x00, 0x00, standin_traps, &standin_reader};
+
+static const uint8_t driver[] =
+{
+    0xBD, 0xE0, 0x62,       // 5000  JSR  BLKIN
+    0x36,                   // 5003  PSHA
+    0x07,                   // 5004  TPA
+    0x97, FLAGS,            // 5005  STAA $F0          flags on return
+    0x32,                   // 5007  PULA
+    0x20, 0xFE,             // 5008  BRA  *
+};
+
+typedef struct
+{
+    uint8_t  type;
+    uint8_t  length;
+    uint8_t  error;
+    uint8_t  a;
+    uint16_t x;
+    uint8_t  flags;         // N, Z and V (B and C are the ROM's working values)
+    uint8_t  buffer[256];
+} result_t;
+
+static uint32_t rnd = 12345;
+
+static uint8_t random_byte(void)
+{
+    rnd = rnd * 1103515245 + 12345;
+    return rnd >> 16;
+}
+
+// ------------------------------------------------------------------------
+// Write a block as a .C10 image has it - leader, sync byte, type, length,
+// payload and checksum (off by one for a block that should fail).
+// ------------------------------------------------------------------------
+static void write_block(FILE *fp, uint8_t type, const uint8_t *data, int length, int bad)
+{
+    uint8_t checksum = type + length + bad;
+
+    for (int i=0; i<16; i++) fputc(0x55, fp);
+    fputc(0x3C, fp);
+    fputc(type, fp);
+    fputc(length, fp);
+    for (int i=0; i<length; i++)
+    {
+        fputc(data[i], fp);
+        checksum += data[i];
+    }
+    fputc(checksum, fp);
+}
+
+static void write_tape(void)
+{
+    uint8_t namefile[15] = {'F', 'A', 'S', 'T', 'L', 'O', 'A', 'D', TAPE_FILE_ML, 0x00, 0x00, 0x50, 0x00, 0x50, 0x00};
+    uint8_t data[255];
+
+    FILE *fp = fopen(TAPE_FILE, "wb");
+    if (!fp)
+    {
+        printf("Unable to create %s\n", TAPE_FILE);
+        exit(1);
+    }
+
+    write_block(fp, TAPE_BLOCK_NAMEFILE, namefile, sizeof(namefile), 0);
+    for (int i=0; i < sizeof(data); i++) data[i] = random_byte();
+    write_block(fp, TAPE_BLOCK_DATA, data, 255, 0);
+    for (int i=0; i < sizeof(data); i++) data[i] = random_byte();
+    write_block(fp, TAPE_BLOCK_DATA, data, 255, 0);
+    write_block(fp, TAPE_BLOCK_DATA, data + 55, 100, 0);
+    write_block(fp, TAPE_BLOCK_DATA, data + 5, 50, 1);
+    fputc(0x00, fp);                        // Junk the fast path doesn't take
+    fputc(0x00, fp);
+    write_block(fp, TAPE_BLOCK_DATA, data + 9, 20, 0);
+    write_block(fp, TAPE_BLOCK_EOF, NULL, 0, 0);
+    fclose(fp);
+}
+
+// ------------------------------------------------------------------------
+// Read the whole tape with FAST LOAD on or off - returns the scanlines it
+// took or 0 if a block didn't come back.
+// ------------------------------------------------------------------------
+static int read_tape(int fast, result_t *results)
+{
+    int lines = 0;
+
+    myConfig.fastLoad = fast;
+    tape_open(TAPE_FILE);
+    tape_init();
+    hle_install(&standin_rom);
+    memcpy(Memory + DRIVER, driver, sizeof(driver));
+
+    for (int block=0; block < BLOCKS; block++)
+    {
+        memset(Memory + BUFFER, 0xA5, 256);
+        memset(Memory + 0xE0, 0x00, 5);
+        Memory[0xE2] = BUFFER >> 8;
+        Memory[0xE3] = BUFFER & 0xFF;
+        cpu.ab.ab.a = 0xFF;
+        cpu.x  = 0x0000;
+        cpu.sp = DRIVER_STACK;
+        cpu.pc = DRIVER;
+
+        for (int line=0; (line < 100000) && (cpu.pc != DRIVER_STOP); line++, lines++)
+        {
+            cpu_run();
+        }
+        if (cpu.pc != DRIVER_STOP) return 0;
+
+        result_t *result = &results[block];
+        result->type   = Memory[0xE0];
+        result->length = Memory[0xE1];
+        result->error  = Memory[0xE4];
+        result->a      = cpu.ab.ab.a;
+        result->x      = cpu.x;
+        result->flags  = Memory[FLAGS] & 0x0E;
+        memcpy(result->buffer, Memory + BUFFER, 256);
+    }
+
+    return lines;
+}
+
+int main(int argc, char *argv[])
+{
+    static result_t slow[BLOCKS], fast[BLOCKS];
+    const uint8_t expect_type[BLOCKS]  = {TAPE_BLOCK_NAMEFILE, TAPE_BLOCK_DATA, TAPE_BLOCK_DATA, TAPE_BLOCK_DATA,
+                                          TAPE_BLOCK_DATA, TAPE_BLOCK_DATA, TAPE_BLOCK_EOF};
+    const uint8_t expect_error[BLOCKS] = {0, 0, 0, 0, 1, 0, 0};
+    int failures = 0;
+
+    myConfig.machine = MACHINE_20K;
+    memset(MC10BASIC, 0x00, sizeof(MC10BASIC));
+    memcpy(MC10BASIC, standin_reset, sizeof(standin_reset));
+    memcpy(MC10BASIC + (STANDIN_CODE & 0x1FFF), standin_cassette, sizeof(standin_cassette));
+    MC10BASIC[0x1FFE] = 0xE0;
+    MC10BASIC[0x1FFF] = 0x00;
+
+    write_tape();
+    micro_reset();
+
+    int slow_lines = read_tape(0, slow);
+    uint32_t slow_calls = hle_calls;
+    int fast_lines = read_tape(1, fast);
+    uint32_t fast_calls = hle_calls;
+
+    if (!slow_lines || !fast_lines)
+    {
+        printf("  a block did not come back (%s)\n", slow_lines ? "FAST LOAD" : "bit by bit");
+        return 1;
+    }
+
+    for (int block=0; block < BLOCKS; block++)
+    {
+        int same = !memcmp(&slow[block], &fast[block], sizeof(result_t));
+        int right = (slow[block].type == expect_type[block]) && (slow[block].error == expect_error[block]);
+        printf("  block %d: type %02X, %3d bytes, error %d - %s\n", block, slow[block].type, slow[block].length,
+               slow[block].error, !right ? "FAILED (not the block written)" : same ? "both ways match" : "FAILED (differs)");
+        if (!same || !right) failures++;
+    }
+
+    // Every block should have been taken whole in the end
+    if ((slow_calls != 0) || (fast_calls != BLOCKS))
+    {
+        printf("  %u blocks fast loaded with FAST LOAD off, %u with it on (expected 0 and %d)\n",
+               (unsigned)slow_calls, (unsigned)fast_calls, BLOCKS);
+        failures++;
+    }
+
+    printf("  %d scanlines bit by bit, %d with FAST LOAD\n", slow_lines, fast_lines);
+    printf(failures ? "%d checks failed\n" : "all blocks match\n", failures);
+
+    return failures ? 1 : 0;
+}
+
+// End of file
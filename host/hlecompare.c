@@ -0,0 +1,303 @@
+// =====================================================================================
+// Copyright (c) 2025 Dave Bernazzani (wavemotion-dave)
+//
+// Copying and distribution of this emulator, its source code and associated
+// readme files, with or without modification, are permitted in any medium without
+// royalty provided this copyright notice is used and wavemotion-dave and eyalabraham
+// (Dragon 32 emu core) are thanked profusely.
+//
+// The Micro-DS emulator is offered as-is, without any warranty. Please see readme.md
+// =====================================================================================
+
+/********************************************************************
+ * hlecompare.c
+ *
+ *  Host check of the native ROM routines in hle.c. Every entry point
+ *  in a ROM's table is called over and over with a random direct page
+ *  (the floating point accumulators), random A, B, X and condition
+ *  codes - once running the ROM code (FAST MATH off) and once with
+ *  the native routine (STRICT). The direct page, the registers, the
+ *  flags and the cycles taken (timed with the free-running counter)
+ *  must all come out the same. TURBO must give the same results for
+ *  fewer cycles.
+ *
+ *  With no arguments a stand-in ROM is used which has the 6803 code
+ *  hle_normalize() is a translation of. Given a ROM image the table
+ *  hle_init() picks for it (by CRC) is checked instead - that is the
+ *  test a ROM's entry points must pass before they go in hle_roms[].
+ *
+ *  Exits non-zero if any check fails.
+ *
+ *******************************************************************/
+#include    <stdio.h>
+#include    <stdlib.h>
+#include    <string.h>
+
+#include    <nds.h>
+
+#include    "cpu.h"
+#include    "mem.h"
+#include    "hle.h"
+#include    "MicroDS.h"
+#include    "MicroUtils.h"
+
+#define CASES           20000
+#define DRIVER          0x5000      // The calling code goes in RAM (so it works with any ROM)
+#define DRIVER_CALL     (DRIVER + 0x0B)
+#define DRIVER_STOP     (DRIVER + 0x1D)
+#define DRIVER_STACK    0x4EFF
+#define SCRATCH         0xF0        // F0-FF is the driver's - the rest of the direct page is random
+
+// ------------------------------------------------------------------------
+// The stand-in ROM at E000 (and mirrored at C000) - a reset that sits
+// still and the normalize routine hle_normalize() stands in for with
+// FP0EXP at $C9, the mantissa at $CA-$CD, FP0SGN at $CE and FPSBYT at $D3.
+// ------------------------------------------------------------------------
+#define STANDIN_NORMALIZE   0xE020
+
+static const uint8_t standin_reset[] =
+{
+    0x8E, 0x4E, 0xFF,       // E000  LDS  #$4EFF
+    0x0F,                   // E003  SEI
+    0x20, 0xFE,             // E004  BRA  *
+};
+
+static const uint8_t standin_normalize[] =
+{
+    0x5F,                   // E020  NORM CLRB
+    0x96, 0xCA,             // E021  BYTE LDAA FPA0
+    0x26, 0x1F,             // E023       BNE  BIT
+    0x96, 0xCB,             // E025       LDAA FPA0+1
+    0x97, 0xCA,             // E027       STAA FPA0
+    0x96, 0xCC,             // E029       LDAA FPA0+2
+    0x97, 0xCB,             // E02B       STAA FPA0+1
+    0x96, 0xCD,             // E02D       LDAA FPA0+3
+    0x97, 0xCC,             // E02F       STAA FPA0+2
+    0x96, 0xD3,             // E031       LDAA FPSBYT
+    0x97, 0xCD,             // E033       STAA FPA0+3
+    0x7F, 0x00, 0xD3,       // E035       CLR  FPSBYT
+    0xCB, 0x08,             // E038       ADDB #8
+    0xC1, 0x28,             // E03A       CMPB #40
+    0x2D, 0xE3,             // E03C       BLT  BYTE
+    0x4F,                   // E03E  ZERO CLRA
+    0x97, 0xC9,             // E03F       STAA FP0EXP
+    0x97, 0xCE,             // E041       STAA FP0SGN
+    0x39,                   // E043       RTS
+    0x2B, 0x12,             // E044  BIT  BMI  DONE
+    0x5C,                   // E046  LOOP INCB
+    0x78, 0x00, 0xD3,       // E047       ASL  FPSBYT
+    0x79, 0x00, 0xCD,       // E04A       ROL  FPA0+3
+    0x79, 0x00, 0xCC,       // E04D       ROL  FPA0+2
+    0x79, 0x00, 0xCB,       // E050       ROL  FPA0+1
+    0x79, 0x00, 0xCA,       // E053       ROL  FPA0
+    0x2A, 0xEE,             // E056       BPL  LOOP
+    0x96, 0xC9,             // E058  DONE LDAA FP0EXP
+    0x10,                   // E05A       SBA
+    0x97, 0xC9,             // E05B       STAA FP0EXP
+    0x23, 0xDF,             // E05D       BLS  ZERO
+    0x39,                   // E05F       RTS
+};
+
+static const hle_trap_t standin_traps[] =
+{
+    {STANDIN_NORMALIZE, 20, hle_normalize},
+    {0x0000, 0, NULL}
+};
+
+static const hle_rom_t standin_rom = {0x00000000, 0xC9, 0xD3, standin_traps, NULL};
+
+// ------------------------------------------------------------------------
+// The calling code. The entry A and B are pulled from the stack and the
+// entry flags set with TAP so nothing in between touches them.
+// ------------------------------------------------------------------------
+static uint8_t driver[] =
+{
+    0xDC, 0x09,             // 5000  LDD  $09          counter before
+    0xDD, 0xF0,             // 5002  STD  $F0
+    0xDE, 0xF2,             // 5004  LDX  $F2          entry X
+    0x96, 0xF6,             // 5006  LDAA $F6          entry flags
+    0x06,                   // 5008  TAP
+    0x33,                   // 5009  PULB              entry B
+    0x32,                   // 500A  PULA              entry A
+    0xBD, 0x00, 0x00,       // 500B  JSR  routine
+    0x36,                   // 500E  PSHA
+    0x07,                   // 500F  TPA
+    0x97, 0xF7,             // 5010  STAA $F7          flags on return
+    0x32,                   // 5012  PULA
+    0x97, 0xF8,             // 5013  STAA $F8          A, B and X on return
+    0xD7, 0xF9,             // 5015  STAB $F9
+    0xDF, 0xFA,             // 5017  STX  $FA
+    0xDC, 0x09,             // 5019  LDD  $09          counter after
+    0xDD, 0xF4,             // 501B  STD  $F4
+    0x20, 0xFE,             // 501D  BRA  *
+};
+
+typedef struct
+{
+    uint8_t  page[0x80];    // The direct page on return (less the counter readings)
+    uint16_t cycles;        // Counter after less counter before
+    uint16_t sp;
+} result_t;
+
+static uint32_t rnd = 12345;
+
+static uint8_t random_byte(void)
+{
+    rnd = rnd * 1103515245 + 12345;
+    return rnd >> 16;
+}
+
+// ------------------------------------------------------------------------
+// Call the routine once with the given direct page and registers.
+// ------------------------------------------------------------------------
+static int call(int mode, const uint8_t *page, uint8_t a, uint8_t b, result_t *result)
+{
+    myConfig.hleMath = mode;
+
+    memcpy(Memory + 0x80, page, 0x80);
+    memcpy(Memory + DRIVER, driver, sizeof(driver));
+    Memory[DRIVER_STACK - 1] = b;
+    Memory[DRIVER_STACK]     = a;
+    cpu.sp = DRIVER_STACK - 2;
+    cpu.pc = DRIVER;
+
+    for (int line=0; (line < 1000) && (cpu.pc != DRIVER_STOP); line++)
+    {
+        cpu_run();
+    }
+    if (cpu.pc != DRIVER_STOP) return 0;
+
+    memcpy(result->page, Memory + 0x80, 0x80);
+    result->cycles = ((Memory[0xF4] << 8) | Memory[0xF5]) - ((Memory[0xF0] << 8) | Memory[0xF1]);
+    result->sp = cpu.sp;
+    memset(result->page + (SCRATCH - 0x80), 0x00, 2);
+    memset(result->page + (SCRATCH - 0x80) + 4, 0x00, 2);
+
+    return 1;
+}
+
+// ------------------------------------------------------------------------
+// Check one entry point - the ROM code against the native routine.
+// ------------------------------------------------------------------------
+static int compare(const hle_trap_t *trap)
+{
+    uint8_t page[0x80];
+    result_t rom, native, turbo;
+    uint32_t rom_cycles = 0, turbo_cycles = 0, calls = 0;
+    int bad = 0;
+
+    driver[DRIVER_CALL - DRIVER + 1] = trap->address >> 8;
+    driver[DRIVER_CALL - DRIVER + 2] = trap->address & 0xFF;
+
+    for (int i=0; i < CASES; i++)
+    {
+        // Plenty of zero bytes so that every path through the routine is taken
+        for (int j=0; j < 0x80; j++)
+        {
+            page[j] = (random_byte() & 1) ? random_byte() : 0x00;
+        }
+        page[0xF6 - 0x80] = random_byte() | 0x10;     // No interrupts
+        uint8_t a = random_byte();
+        uint8_t b = random_byte();
+
+        uint32_t before = hle_calls;
+        if (!call(HLE_OFF, page, a, b, &rom) || (hle_calls != before) ||
+            !call(HLE_STRICT, page, a, b, &native) || (hle_calls != before + 1) ||
+            !call(HLE_TURBO, page, a, b, &turbo))
+        {
+            printf("  %04X: case %d did not return\n", trap->address, i);
+            return 0;
+        }
+        calls = hle_calls;
+
+        if (memcmp(&rom, &native, sizeof(rom)))
+        {
+            if (bad++ < 5)
+            {
+                printf("  %04X: case %d differs (cycles %u vs %u)\n", trap->address, i, rom.cycles, native.cycles);
+                for (int j=0; j < 0x80; j++)
+                {
+                    if (rom.page[j] != native.page[j]) printf("    $%02X: %02X vs %02X\n", 0x80+j, rom.page[j], native.page[j]);
+                }
+            }
+            continue;
+        }
+
+        uint16_t cycles = turbo.cycles;
+        turbo.cycles = rom.cycles;
+        if (memcmp(&rom, &turbo, sizeof(rom)))
+        {
+            if (bad++ < 5) printf("  %04X: case %d differs in TURBO mode\n", trap->address, i);
+            continue;
+        }
+
+        rom_cycles += rom.cycles;
+        turbo_cycles += cycles;
+    }
+
+    printf("  %04X: %d cases, %s (%u native calls, %.1f cycles a call with the ROM code, %.1f in TURBO)\n", trap->address, CASES,
+           bad ? "FAILED" : "ROM and native match", calls, (double)rom_cycles / CASES, (double)turbo_cycles / CASES);
+
+    return !bad;
+}
+
+int main(int argc, char *argv[])
+{
+    const hle_rom_t *rom = &standin_rom;
+    int failures = 0;
+
+    myConfig.machine = MACHINE_20K;
+    memset(MC10BASIC, 0x00, sizeof(MC10BASIC));
+
+    if (argc > 1)
+    {
+        FILE *fp = fopen(argv[1], "rb");
+        if (!fp || (fread(MC10BASIC, 1, sizeof(MC10BASIC), fp) != sizeof(MC10BASIC)))
+        {
+            printf("Unable to read an 8K ROM from %s\n", argv[1]);
+            return 1;
+        }
+        fclose(fp);
+    }
+    else
+    {
+        memcpy(MC10BASIC, standin_reset, sizeof(standin_reset));
+        memcpy(MC10BASIC + (STANDIN_NORMALIZE & 0x1FFF), standin_normalize, sizeof(standin_normalize));
+        MC10BASIC[0x1FFE] = 0xE0;
+        MC10BASIC[0x1FFF] = 0x00;
+    }
+
+    micro_reset();
+
+    if (argc > 1)
+    {
+        rom = hle_lookup(boot_rom_crc);
+        printf("ROM %s (CRC %08x)\n", argv[1], (unsigned)boot_rom_crc);
+        if (!rom)
+        {
+            printf("no native routines for this ROM\n");
+            return 1;
+        }
+    }
+    else
+    {
+        printf("stand-in ROM (CRC %08x)\n", (unsigned)boot_rom_crc);
+        if (hle_find(STANDIN_NORMALIZE))
+        {
+            printf("  traps installed for a ROM that isn't in the table\n");
+            failures++;
+        }
+        hle_install(rom);
+    }
+
+    for (int i=0; rom->traps[i].address; i++)
+    {
+        if (!compare(&rom->traps[i])) failures++;
+    }
+
+    printf(failures ? "%d entry points failed\n" : "all entry points match\n", failures);
+
+    return failures ? 1 : 0;
+}
+
+// End of file
@@ -0,0 +1,63 @@
+// =====================================================================================
+// Copyright (c) 2025 Dave Bernazzani (wavemotion-dave)
+//
+// Copying and distribution of this emulator, its source code and associated
+// readme files, with or without modification, are permitted in any medium without
+// royalty provided this copyright notice is used and wavemotion-dave and eyalabraham
+// (Dragon 32 emu core) are thanked profusely.
+//
+// The Micro-DS emulator is offered as-is, without any warranty. Please see readme.md
+// =====================================================================================
+
+/********************************************************************
+ * host.c
+ *
+ *  The handful of globals and hooks that the emulator core expects
+ *  from the DS front end (MicroDS.c / MicroUtils.c) so that the core
+ *  (cpu, mem, vdg, tape, audio, hle, snapshot and mc10.c) can be built and run
+ *  headless on a Linux host.
+ *
+ *******************************************************************/
+#include    <nds.h>
+
+#include    "MicroDS.h"
+#include    "MicroUtils.h"
+#include    "tape.h"
+#include    "audio.h"
+
+struct Config_t       myConfig;
+struct GlobalConfig_t myGlobalConfig;
+
+unsigned int debug[0x10];
+
+u8  kbd_keys_pressed = 0;
+u8  kbd_keys[12];
+u8  shift_key = 0;
+u8  ctrl_key  = 0;
+
+unsigned char MC10BASIC[0x2000];
+unsigned char MCXBASIC[0x4000];
+unsigned char ALICE4K[0x2000];
+u8 bMCX_found = false;
+u8 bALICE_found = false;
+
+u32 file_size = 0;
+
+uint8_t host_frame_buffer[256*192];     // Stands in for the DS top screen bitmap
+
+// There is no maxmod stream on the host - bench.c drains one sample per scanline
+void newStreamSampleRate(void)
+{
+    audio_set_rate(262*60, 262*60);
+}
+
+// Nor an SD card to keep the boot snapshot on (unless saveload.c is built in - see savefile.c)
+__attribute__((weak)) void MicroReadBootSnapshot(void)
+{
+}
+
+__attribute__((weak)) void MicroWriteBootSnapshot(void)
+{
+}
+
+// End of file
@@ -0,0 +1,49 @@
+// =====================================================================================
+// Copyright (c) 2025 Dave Bernazzani (wavemotion-dave)
+//
+// Copying and distribution of this emulator, its source code and associated
+// readme files, with or without modification, are permitted in any medium without
+// royalty provided this copyright notice is used and wavemotion-dave and eyalabraham
+// (Dragon 32 emu core) are thanked profusely.
+//
+// The Micro-DS emulator is offered as-is, without any warranty. Please see readme.md
+// =====================================================================================
+
+/********************************************************************
+ * nds.h
+ *
+ *  Stand-in for the libnds header when the emulator core is built
+ *  headless on a Linux host (see host/Makefile). Only the types and
+ *  attributes the core sources rely upon are provided here.
+ *
+ *******************************************************************/
+#ifndef __HOST_NDS_H__
+#define __HOST_NDS_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <sys/stat.h>     // mkdir() - libnds has it through its own headers
+
+typedef uint8_t     u8;
+typedef uint16_t    u16;
+typedef uint32_t    u32;
+typedef uint64_t    u64;
+typedef int8_t      s8;
+typedef int16_t     s16;
+typedef int32_t     s32;
+typedef int64_t     s64;
+
+// No tightly coupled memory on the host - everything runs from normal RAM
+#define ITCM_CODE
+#define DTCM_DATA
+#define DTCM_BSS
+
+// No VRAM either - the VDG renders into an ordinary 256x192 buffer (host.c)
+extern uint8_t host_frame_buffer[];
+#define VDG_FRAME_BUFFER    host_frame_buffer
+
+// Nothing to wait for - the front end's status messages just go by
+static inline void swiWaitForVBlank(void) {}
+
+#endif // __HOST_NDS_H__
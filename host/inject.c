@@ -0,0 +1,253 @@
+// =====================================================================================
+// Copyright (c) 2025 Dave Bernazzani (wavemotion-dave)
+//
+// Copying and distribution of this emulator, its source code and associated
+// readme files, with or without modification, are permitted in any medium without
+// royalty provided this copyright notice is used and wavemotion-dave and eyalabraham
+// (Dragon 32 emu core) are thanked profusely.
+//
+// The Micro-DS emulator is offered as-is, without any warranty. Please see readme.md
+// =====================================================================================
+
+/********************************************************************
+ * inject.c
+ *
+ *  Host check of tape_inject() (see tape.c). A tiny stand-in ROM does
+ *  what matters to it of a BASIC cold start - it sets up the stack,
+ *  takes a while (reading the keyboard all the while), then sets the
+ *  program pointers for an empty program and sits reading the keyboard
+ *  as BASIC does at its prompt. Once the boot snapshot has been taken
+ *  the machine is knocked about and then:
+ *
+ *    - a BASIC tape (saved from somewhere else so its line links are
+ *      all wrong) must end up at the start of the program text, linked
+ *      for where it is, with the variables straight after and BASIC
+ *      back at its prompt on its own stack
+ *    - a machine language tape must end up at its load address and be
+ *      running from its exec address on BASIC's stack
+ *    - a BASIC program too big to fit must be left to the ROM
+ *
+ *  Each machine type with an 8K ROM is checked. Exits non-zero if any
+ *  check fails.
+ *
+ *******************************************************************/
+#include    <stdio.h>
+#include    <stdlib.h>
+#include    <string.h>
+
+#include    <nds.h>
+
+#include    "cpu.h"
+#include    "mem.h"
+#include    "tape.h"
+#include    "MicroDS.h"
+#include    "MicroUtils.h"
+
+#define PROMPT_ROM_STACK    0x4EFF
+#define PROMPT_ROM_TEXT     0x4346
+#define PROMPT_ROM_LOOP     0xE024
+#define PROMPT_ROM_PTRS     0x93
+#define TAPE_FILE           "inject-test.c10"
+
+// ------------------------------------------------------------------------
+// The stand-in ROM at E000 (and mirrored at C000).
+// ------------------------------------------------------------------------
+static const uint8_t prompt_rom[] =
+{
+    0x8E, 0x4E, 0xFF,       // E000  LDS  #$4EFF
+    0xCE, 0x00, 0x00,       // E003  LDX  #0
+    0xB6, 0xBF, 0xFF,       // E006  LDAA $BFFF        cold start - reads the keyboard too
+    0x09,                   // E009  DEX
+    0x26, 0xFA,             // E00A  BNE  $E006
+    0xCC, 0x43, 0x46,       // E00C  LDD  #$4346       program text
+    0xDD, 0x93,             // E00F  STD  $93
+    0xCC, 0x43, 0x48,       // E011  LDD  #$4348       variables, arrays, end of arrays
+    0xDD, 0x95,             // E014  STD  $95
+    0xDD, 0x97,             // E016  STD  $97
+    0xDD, 0x99,             // E018  STD  $99
+    0x4F,                   // E01A  CLRA
+    0xB7, 0x43, 0x46,       // E01B  STAA $4346        no program
+    0xB7, 0x43, 0x47,       // E01E  STAA $4347
+    0x01,                   // E021  NOP
+    0x01,                   // E022  NOP
+    0x01,                   // E023  NOP
+    0x7F, 0x00, 0x02,       // E024  CLR  $02          the prompt - strobe all the columns
+    0xB6, 0xBF, 0xFF,       // E027  LDAA $BFFF        and read the keyboard
+    0x20, 0xF8,             // E02A  BRA  $E024
+};
+
+// ------------------------------------------------------------------------
+// 10 A=1 / 20 GOTO 10 - links as if it had been saved from 0x5000
+// ------------------------------------------------------------------------
+static const uint8_t basic_program[] =
+{
+    0x50, 0x08, 0x00, 0x0A, 'A', 0xCB, '1', 0x00,
+    0x50, 0x0F, 0x00, 0x14, 0x81, '1', '0', 0x00,
+    0x00, 0x00,
+};
+
+// ------------------------------------------------------------------------
+// LDAA #$42 / STAA $4400 / TSX / STX $4402 / BRA *
+// ------------------------------------------------------------------------
+static const uint8_t ml_program[] =
+{
+    0x86, 0x42, 0xB7, 0x44, 0x00, 0x30, 0xFF, 0x44, 0x02, 0x20, 0xFE,
+};
+
+#define ML_LOAD     0x5000
+
+static int failures = 0;
+
+static void check(int ok, const char *what)
+{
+    printf("  %-60s %s\n", what, ok ? "ok" : "FAILED");
+    if (!ok) failures++;
+}
+
+static uint16_t word_at(uint16_t address)
+{
+    return (Memory[address] << 8) | Memory[address+1];
+}
+
+// ------------------------------------------------------------------------
+// Write a .C10 image with a namefile, the data blocks and an EOF block
+// ------------------------------------------------------------------------
+static void write_block(FILE *fp, uint8_t type, const uint8_t *data, int length)
+{
+    uint8_t checksum = type + length;
+
+    for (int i=0; i<16; i++) fputc(0x55, fp);
+    fputc(0x3C, fp);
+    fputc(type, fp);
+    fputc(length, fp);
+    for (int i=0; i<length; i++)
+    {
+        fputc(data[i], fp);
+        checksum += data[i];
+    }
+    fputc(checksum, fp);
+}
+
+static void write_tape(uint8_t file_type, uint16_t exec, uint16_t load, const uint8_t *data, int length)
+{
+    uint8_t namefile[15] = {'I', 'N', 'J', 'E', 'C', 'T', ' ', ' ', file_type, 0x00, 0x00,
+                            exec >> 8, exec & 0xFF, load >> 8, load & 0xFF};
+
+    FILE *fp = fopen(TAPE_FILE, "wb");
+    if (!fp)
+    {
+        printf("Unable to create %s\n", TAPE_FILE);
+        exit(1);
+    }
+
+    write_block(fp, TAPE_BLOCK_NAMEFILE, namefile, sizeof(namefile));
+    for (int pos=0; pos < length; pos += 255)
+    {
+        write_block(fp, TAPE_BLOCK_DATA, data + pos, (length - pos > 255) ? 255 : length - pos);
+    }
+    write_block(fp, TAPE_BLOCK_EOF, NULL, 0);
+    fclose(fp);
+
+    tape_open(TAPE_FILE);
+    tape_init();
+}
+
+static void run_frames(int frames)
+{
+    for (int frame=0; frame < frames; frame++)
+    {
+        while (!micro_run()) ;
+    }
+}
+
+// ------------------------------------------------------------------------
+// Boot the stand-in ROM and wait for the boot snapshot, then mess up the
+// stack, the registers and BASIC's pointers as a running game would.
+// ------------------------------------------------------------------------
+static int boot(void)
+{
+    boot_snapshot_crc = 0;
+    micro_reset();
+
+    for (int frame=0; (frame < 600) && (boot_snapshot_crc != boot_rom_crc); frame++)
+    {
+        run_frames(1);
+    }
+    if (boot_snapshot_crc != boot_rom_crc) return 0;
+
+    run_frames(5);
+    cpu.sp = 0x4401;
+    cpu.pc = 0x4400;
+    Memory[0x4400] = 0x20;      // BRA * - a game
+    Memory[0x4401] = 0xFE;
+    memset(Memory + PROMPT_ROM_PTRS, 0x77, 8);
+    run_frames(1);
+
+    return 1;
+}
+
+int main(int argc, char *argv[])
+{
+    static uint8_t too_big[0x8000];
+    const int machines[] = {MACHINE_20K, MACHINE_32K, MACHINE_ALICE};
+
+    memset(MC10BASIC, 0x00, sizeof(MC10BASIC));
+    memcpy(MC10BASIC, prompt_rom, sizeof(prompt_rom));
+    MC10BASIC[0x1FFE] = 0xE0;
+    MC10BASIC[0x1FFF] = 0x00;
+    memcpy(ALICE4K, MC10BASIC, sizeof(ALICE4K));
+
+    for (int i=0; i < sizeof(machines)/sizeof(machines[0]); i++)
+    {
+        myConfig.machine = machines[i];
+        bALICE_found = (myConfig.machine == MACHINE_ALICE);
+        printf("machine %d\n", myConfig.machine);
+
+        // A BASIC program goes in at the prompt with its lines linked for where it is
+        write_tape(TAPE_FILE_BASIC, 0, 0, basic_program, sizeof(basic_program));
+        boot_snapshot_crc = 0;
+        micro_reset();
+        check(tape_inject() == 0, "BASIC: left to the ROM without a boot snapshot");
+        check(boot(), "boot snapshot taken at the prompt");
+        check(tape_inject() == 1, "BASIC: injected");
+        check(cpu.sp == PROMPT_ROM_STACK && cpu.pc >= PROMPT_ROM_LOOP, "BASIC: stack and PC back at the prompt");
+        check(word_at(PROMPT_ROM_PTRS) == PROMPT_ROM_TEXT, "BASIC: program text where it was");
+        check(word_at(PROMPT_ROM_TEXT) == PROMPT_ROM_TEXT + 8 && word_at(PROMPT_ROM_TEXT + 8) == PROMPT_ROM_TEXT + 16,
+              "BASIC: line links worked out again");
+        check(!memcmp(Memory + PROMPT_ROM_TEXT + 2, basic_program + 2, 6) &&
+              !memcmp(Memory + PROMPT_ROM_TEXT + 10, basic_program + 10, 8), "BASIC: lines in place");
+        uint16_t vars = PROMPT_ROM_TEXT + sizeof(basic_program);
+        check(word_at(PROMPT_ROM_PTRS+2) == vars && word_at(PROMPT_ROM_PTRS+4) == vars &&
+              word_at(PROMPT_ROM_PTRS+6) == vars, "BASIC: variables and arrays start after it");
+        check(tape_injected && !tape_motor && tape_pos == file_size, "BASIC: tape wound on past it");
+        run_frames(10);
+        check(cpu.pc >= PROMPT_ROM_LOOP && cpu.sp == PROMPT_ROM_STACK, "BASIC: still at the prompt");
+
+        // A machine language program is started on BASIC's stack
+        write_tape(TAPE_FILE_ML, ML_LOAD, ML_LOAD, ml_program, sizeof(ml_program));
+        check(boot(), "boot snapshot taken at the prompt");
+        check(tape_inject() == 1, "ML: injected");
+        check(!memcmp(Memory + ML_LOAD, ml_program, sizeof(ml_program)), "ML: at its load address");
+        check(cpu.pc == ML_LOAD && cpu.sp == PROMPT_ROM_STACK, "ML: starts at exec on BASIC's stack");
+        check(word_at(PROMPT_ROM_PTRS) == PROMPT_ROM_TEXT, "ML: BASIC's pointers back as booted");
+        run_frames(1);
+        check(Memory[0x4400] == 0x42 && word_at(0x4402) == PROMPT_ROM_STACK + 1, "ML: ran with S at the stack top");
+
+        // Too big to fit below the stack - the ROM gets to say so
+        memset(too_big, 0x01, sizeof(too_big));
+        write_tape(TAPE_FILE_BASIC, 0, 0, too_big, 0x1000);
+        check(boot(), "boot snapshot taken at the prompt");
+        check(tape_inject() == 0, "BASIC: too big is left to the ROM");
+        check(cpu.pc >= PROMPT_ROM_LOOP && word_at(PROMPT_ROM_PTRS) == PROMPT_ROM_TEXT && !tape_injected,
+              "BASIC: machine left at the prompt");
+    }
+
+    tape_close();
+    remove(TAPE_FILE);
+
+    printf(failures ? "%d checks failed\n" : "all checks passed\n", failures);
+
+    return failures ? 1 : 0;
+}
+
+// End of file
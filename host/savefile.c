@@ -0,0 +1,368 @@
+// =====================================================================================
+// Copyright (c) 2025 Dave Bernazzani (wavemotion-dave)
+//
+// Copying and distribution of this emulator, its source code and associated
+// readme files, with or without modification, are permitted in any medium without
+// royalty provided this copyright notice is used and wavemotion-dave and eyalabraham
+// (Dragon 32 emu core) are thanked profusely.
+//
+// The Micro-DS emulator is offered as-is, without any warranty. Please see readme.md
+// =====================================================================================
+
+/********************************************************************
+ * savefile.c
+ *
+ *  Host check of the save files (saveload.c) - built with the real
+ *  saveload.c writing to a directory here in place of the SD card.
+ *  For each machine type:
+ *
+ *    - a .sav file, a warm start and a boot snapshot must each come
+ *      back exactly as the machine was when written
+ *    - a warm start that is cut short part way through a chunk or has
+ *      a chunk with a bad CRC must be turned down with the machine
+ *      left as it was
+ *    - chunks it doesn't know must be stepped over, a short STAT chunk
+ *      (an older emulator) must read the rest as zero and a long one
+ *      (a newer emulator) must give just the part we know
+ *
+ *  Then fixed-layout (version 5) .sav files from before the chunks
+ *  are read back: a good one, and ones with a compressed block of a
+ *  negative length, too long for the buffer or not decompressing to
+ *  the size it should - in each of the three blocks on the MCX-128.
+ *
+ *  Exits non-zero if any check fails.
+ *
+ *******************************************************************/
+#include    <stdio.h>
+#include    <stdlib.h>
+#include    <string.h>
+#include    <unistd.h>
+
+#include    <nds.h>
+
+#include    "cpu.h"
+#include    "mem.h"
+#include    "vdg.h"
+#include    "tape.h"
+#include    "snapshot.h"
+#include    "CRC32.h"
+#include    "MicroDS.h"
+#include    "MicroUtils.h"
+
+#include    "lzav.h"
+
+#define SAVE_DIR            "savefile-test"
+#define WARM_STATE_VER      0x0002      // As saveload.c has them
+#define MICRO_SAVE_V5       0x0005
+#define SHORT_STAT          64          // Bytes of the first page an "older emulator" saved
+#define LONG_STAT           64          // Bytes a "newer emulator" added on the end of it
+#define RAM_DATA            (2 + 16 + SNAPSHOT_PAGE + 16)   // Where the RAM chunk's data starts in a written warm start
+
+// ------------------------------------------------------------------------
+// What the front end (MicroDS.c and MicroUtils.c) has for saveload.c.
+// ------------------------------------------------------------------------
+char initial_file[MAX_FILENAME_LEN] = "GAME.C10";
+char initial_path[MAX_FILENAME_LEN] = "";
+char last_path[MAX_FILENAME_LEN]    = "";
+char last_file[MAX_FILENAME_LEN]    = "";
+u32  file_crc                       = 0x5AFE0001;
+u16  emuFps, emuActFrames, timingFrames;
+
+static char status[16];                 // The OK or ERR a load ends with
+
+void DSPrint(int iX, int iY, int iScr, char *szMessage)
+{
+    if (iX == 9) snprintf(status, sizeof(status), "%s", szMessage);
+}
+
+void _putchar(char character) {}
+
+// ------------------------------------------------------------------------
+// A chunk as saveload.c writes it - the id, the size once read back, the
+// bytes stored and their CRC32 - followed by the bytes stored.
+// ------------------------------------------------------------------------
+typedef struct
+{
+    u32 id;
+    u32 size;
+    u32 length;
+    u32 crc;
+} chunk_t;
+
+static u8  saved[SNAPSHOT_MAX_SIZE];    // The machine as written
+static u8  other[SNAPSHOT_MAX_SIZE];    // The machine as it was before reading back
+static u8  now[SNAPSHOT_MAX_SIZE];      // And afterwards
+static u8  packed[SNAPSHOT_COMPRESS_MAX + 64];   // Room for a block longer than the loader takes
+static char warm_file[2*MAX_FILENAME_LEN];
+static char sav_file[2*MAX_FILENAME_LEN];
+static int failures = 0;
+static uint32_t rnd = 12345;
+
+static void check(int ok, const char *what, int machine)
+{
+    printf("  machine %d: %-60s %s\n", machine, what, ok ? "ok" : "FAILED");
+    if (!ok) failures++;
+}
+
+static uint8_t random_byte(void)
+{
+    rnd = rnd * 1103515245 + 12345;
+    return rnd >> 16;
+}
+
+// ------------------------------------------------------------------------
+// Put the machine in some state of its own - RAM half runs (that compress)
+// and half noise (that don't), the registers and the tape position.
+// ------------------------------------------------------------------------
+static void fill_machine(uint8_t seed)
+{
+    for (int i=0x80; i < 0xC000; i++)
+    {
+        Memory[i] = (i & 0x400) ? random_byte() : (uint8_t)((i >> 6) ^ seed);
+    }
+    if (myConfig.machine == MACHINE_MCX)
+    {
+        for (int i=0; i < 0x3F00; i++)  Memory[0xC000 + i] = random_byte();
+        for (int i=0; i < 0x10000; i++) Memory_MCX[i] = (i & 0x800) ? random_byte() : seed;
+    }
+
+    cpu.pc = 0x4000 + seed;
+    cpu.x  = 0x1234 ^ seed;
+    cpu.sp = 0x4EFF - seed;
+    tape_pos = 1000 + seed;
+    read_cassette_counter = 77 + seed;
+}
+
+// Read back and left as it was - the machine now is what 'other' holds
+static int unchanged(void)
+{
+    snapshot_save(now);
+    return !memcmp(now, other, snapshot_size());
+}
+
+// Read back as written
+static int restored(void)
+{
+    snapshot_save(now);
+    return !memcmp(now, saved, snapshot_size());
+}
+
+// ------------------------------------------------------------------------
+// Write a warm start by hand from the 'saved' snapshot - raw chunks, with
+// extras as asked for.
+// ------------------------------------------------------------------------
+#define CRAFT_UNKNOWN   0x01        // A chunk we don't know before and after the machine
+#define CRAFT_SHORT     0x02        // The STAT chunk cut short
+#define CRAFT_LONG      0x04        // The STAT chunk with more on the end
+
+static void write_chunk(FILE *fp, const char *id, const u8 *data, u32 length)
+{
+    chunk_t chunk = {0, length, length, getCRC32((u8 *)data, length)};
+
+    memcpy(&chunk.id, id, sizeof(chunk.id));
+    fwrite(&chunk, sizeof(chunk), 1, fp);
+    if (length) fwrite(data, length, 1, fp);
+}
+
+static void write_warm(int craft)
+{
+    static const u8 extra[100] = {1, 2, 3};
+    u8  page[SNAPSHOT_PAGE + LONG_STAT];
+    u16 ver = WARM_STATE_VER;
+
+    FILE *fp = fopen(warm_file, "wb");
+    fwrite(&ver, sizeof(ver), 1, fp);
+
+    if (craft & CRAFT_UNKNOWN) write_chunk(fp, "XTRA", extra, sizeof(extra));
+
+    memcpy(page, saved, SNAPSHOT_PAGE);
+    memset(page + SNAPSHOT_PAGE, 0xEE, LONG_STAT);
+    write_chunk(fp, "STAT", page, (craft & CRAFT_SHORT) ? SHORT_STAT : (craft & CRAFT_LONG) ? sizeof(page) : SNAPSHOT_PAGE);
+    write_chunk(fp, "RAM ", saved + SNAPSHOT_PAGE, SNAPSHOT_RAM);
+    if (snapshot_size() > SNAPSHOT_PAGE + SNAPSHOT_RAM)
+    {
+        write_chunk(fp, "MCX ", saved + SNAPSHOT_PAGE + SNAPSHOT_RAM, SNAPSHOT_MCX_RAM);
+    }
+
+    if (craft & CRAFT_UNKNOWN) write_chunk(fp, "XTRA", extra, sizeof(extra));
+    write_chunk(fp, "END ", NULL, 0);
+    fclose(fp);
+}
+
+// Flip one byte of the file
+static void damage(const char *file, long offset)
+{
+    FILE *fp = fopen(file, "r+b");
+    fseek(fp, offset, SEEK_SET);
+    int c = fgetc(fp);
+    fseek(fp, offset, SEEK_SET);
+    fputc(c ^ 0x5A, fp);
+    fclose(fp);
+}
+
+// Try a warm start that isn't right - it must be turned down and the machine left alone
+static void reject_warm(const char *what, int machine)
+{
+    fill_machine(0x33);
+    snapshot_save(other);
+    check(!MicroLoadWarmState() && unchanged(), what, machine);
+}
+
+// ------------------------------------------------------------------------
+// The chunked files - written by saveload.c and by hand.
+// ------------------------------------------------------------------------
+static void check_chunks(int machine)
+{
+    fill_machine(0x11);
+    snapshot_save(saved);
+
+    // A .sav file - with the tape that was in the machine
+    strcpy(last_file, "GAME.C10");
+    file_size = 4321;
+    MicroSaveState();
+    fill_machine(0x22);
+    snapshot_save(other);
+    last_file[0] = 0;
+    file_size = 0;
+    status[0] = 0;
+    MicroLoadState();
+    check(!strcmp(status, "OK ") && restored() && !strcmp(last_file, "GAME.C10") && (file_size == 4321),
+          ".sav file read back", machine);
+
+    // A warm start (compressed)
+    MicroSaveWarmState(0);
+    fill_machine(0x22);
+    check(MicroLoadWarmState() && restored(), "warm start read back", machine);
+
+    // The boot snapshot
+    memcpy(boot_snapshot, saved, snapshot_size());
+    boot_snapshot_crc = boot_rom_crc;
+    MicroWriteBootSnapshot();
+    memset(boot_snapshot, 0x00, snapshot_size());
+    boot_snapshot_crc = 0;
+    MicroReadBootSnapshot();
+    check((boot_snapshot_crc == boot_rom_crc) && !memcmp(boot_snapshot, saved, snapshot_size()), "boot snapshot read back", machine);
+
+    // Damaged warm starts
+    write_warm(0);
+    truncate(warm_file, RAM_DATA + 1000);
+    reject_warm("warm start cut short in the RAM chunk turned down", machine);
+
+    write_warm(0);
+    damage(warm_file, RAM_DATA + 500);
+    reject_warm("warm start with a bad CRC turned down", machine);
+
+    // Chunks from other emulators
+    write_warm(CRAFT_UNKNOWN);
+    fill_machine(0x22);
+    check(MicroLoadWarmState() && restored(), "unknown chunks stepped over", machine);
+
+    write_warm(CRAFT_LONG);
+    fill_machine(0x22);
+    check(MicroLoadWarmState() && restored(), "long STAT chunk - just the part we know", machine);
+
+    write_warm(CRAFT_SHORT);
+    fill_machine(0x22);
+    int loaded = MicroLoadWarmState();
+    memset(saved + SHORT_STAT, 0x00, SNAPSHOT_PAGE - SHORT_STAT);
+    check(loaded && restored(), "short STAT chunk - the rest read as zero", machine);
+}
+
+// ------------------------------------------------------------------------
+// A fixed-layout .sav file from before the chunks. All the variables the
+// loader reads before the RAM are written as zero and then the RAM goes
+// in lzav compressed blocks - one or, for the MCX-128, three.
+// ------------------------------------------------------------------------
+#define BLOCK_NEGATIVE  1       // A length less than zero
+#define BLOCK_TOO_LONG  2       // Longer than the buffer (and that many bytes there)
+#define BLOCK_SHORT     3       // Decompresses to less than it should
+
+static void write_block(FILE *fp, const u8 *data, int size, int fault)
+{
+    int comp_len = lzav_compress_hi(data, packed, (fault == BLOCK_SHORT) ? size/2 : size, sizeof(packed));
+
+    if (fault == BLOCK_NEGATIVE) comp_len = -5;
+    if (fault == BLOCK_TOO_LONG) comp_len = SNAPSHOT_COMPRESS(snapshot_size()) + 16;
+
+    fwrite(&comp_len, sizeof(comp_len), 1, fp);
+    fwrite(packed, (comp_len > 0) ? comp_len : 16, 1, fp);
+}
+
+static void write_fixed(int bad_block, int fault)
+{
+    u16 ver = MICRO_SAVE_V5;
+    size_t header = sizeof(last_path) + sizeof(last_file) + sizeof(cpu) + sizeof(current_vdg_mode) +
+                    sizeof(tape_pos) + sizeof(tape_motor) + sizeof(tape_speedup) + sizeof(cas_eof) + sizeof(tape_byte) +
+                    sizeof(bit_index) + sizeof(bit_timing_threshold) + sizeof(bit_timing_count) + sizeof(read_cassette_counter) +
+                    sizeof(micro_line) + sizeof(file_size) + sizeof(emuFps) + sizeof(emuActFrames) + sizeof(timingFrames) +
+                    sizeof(counter_read_latch) + sizeof(mcx_ram_bank0) + sizeof(mcx_ram_bank1) + sizeof(mcx_rom_bank) + 16;
+
+    FILE *fp = fopen(sav_file, "wb");
+    fwrite(&ver, sizeof(ver), 1, fp);
+    for (size_t i=0; i < header; i++) fputc(0x00, fp);
+
+    write_block(fp, saved + SNAPSHOT_PAGE, 0xC000, (bad_block == 0) ? fault : 0);
+    if (myConfig.machine == MACHINE_MCX)
+    {
+        write_block(fp, saved + SNAPSHOT_PAGE + 0xC000, 0x3F00, (bad_block == 1) ? fault : 0);
+        write_block(fp, saved + SNAPSHOT_PAGE + 0xC000 + 0x3F00, 0x10000, (bad_block == 2) ? fault : 0);
+    }
+    fclose(fp);
+}
+
+static void check_fixed(int machine)
+{
+    const char *faults[] = {"", "negative length", "length past the buffer", "decompressing short"};
+    char what[80];
+
+    fill_machine(0x44);
+    snapshot_save(saved);
+
+    write_fixed(0, 0);
+    fill_machine(0x55);
+    status[0] = 0;
+    MicroLoadState();
+    int same = !memcmp(Memory + 0x100, saved + SNAPSHOT_PAGE + 0x100, 0xC000 - 0x100);
+    if (machine == MACHINE_MCX) same = same && !memcmp(Memory_MCX, saved + SNAPSHOT_PAGE + 0xC000 + 0x3F00, 0x10000);
+    check(!strcmp(status, "OK ") && same, "fixed-layout .sav file read back", machine);
+
+    for (int block=0; block < ((machine == MACHINE_MCX) ? 3 : 1); block++)
+    {
+        for (int fault=BLOCK_NEGATIVE; fault <= BLOCK_SHORT; fault++)
+        {
+            write_fixed(block, fault);
+            status[0] = 0;
+            MicroLoadState();
+            snprintf(what, sizeof(what), "fixed-layout block %d %s turned down", block, faults[fault]);
+            check(!strcmp(status, "ERR"), what, machine);
+        }
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    if (!getcwd(initial_path, sizeof(initial_path) - sizeof(SAVE_DIR) - 1)) return 1;
+    strcat(initial_path, "/" SAVE_DIR);
+    mkdir(initial_path, 0777);
+    snprintf(warm_file, sizeof(warm_file), "%s/sav/%08X.wrm", initial_path, (unsigned)file_crc);
+    snprintf(sav_file, sizeof(sav_file), "%s/sav/GAME.sav", initial_path);
+
+    memset(MC10BASIC, 0x00, sizeof(MC10BASIC));
+    MC10BASIC[0x1FFE] = 0xE0;
+    bMCX_found = 0;
+
+    for (int machine=MACHINE_20K; machine <= MACHINE_ALICE; machine++)
+    {
+        myConfig.machine = machine;
+        micro_reset();
+
+        check_chunks(machine);
+        check_fixed(machine);
+    }
+
+    printf(failures ? "%d checks failed\n" : "all checks passed\n", failures);
+
+    return failures ? 1 : 0;
+}
+
+// End of file
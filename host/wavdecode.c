@@ -0,0 +1,316 @@
+// =====================================================================================
+// Copyright (c) 2025 Dave Bernazzani (wavemotion-dave)
+//
+// Copying and distribution of this emulator, its source code and associated
+// readme files, with or without modification, are permitted in any medium without
+// royalty provided this copyright notice is used and wavemotion-dave and eyalabraham
+// (Dragon 32 emu core) are thanked profusely.
+//
+// The Micro-DS emulator is offered as-is, without any warranty. Please see readme.md
+// =====================================================================================
+
+/********************************************************************
+ * wavdecode.c
+ *
+ *  Host check of the .wav tape decoder (tapewav.c). A small .C10
+ *  image - leader, a namefile block, a gap and then data blocks
+ *  longer than the tape window - is recorded the way the MC-10 writes
+ *  it (a cycle of 2400Hz for a 1 and 1200Hz for a 0) as 8 and 16-bit,
+ *  mono and stereo .wav files at a few sample rates. Each recording is
+ *  opened as a tape and must read back byte for byte as the .C10:
+ *
+ *    - straight through from the start, as the tape plays
+ *    - going back to before the window, which must start decoding
+ *      again from the checkpoint just before the byte wanted
+ *    - at random places, back and forth
+ *
+ *  The second channel of a stereo recording is left quiet - only the
+ *  first is decoded.
+ *
+ *  Exits non-zero if any check fails.
+ *
+ *******************************************************************/
+#include    <stdio.h>
+#include    <stdlib.h>
+#include    <string.h>
+#include    <math.h>
+
+#include    <nds.h>
+
+#include    "tape.h"
+#include    "tapewav.h"
+
+#define WAV_FILE            "wavdecode-test.wav"
+#define DATA_BLOCKS         40          // 10K of tape - more than the window holds
+#define LEADER              128
+#define SEEK_BACK           1000        // Goes back to the checkpoint at 512
+#define RANDOM_READS        2000
+
+static uint8_t  image[16*1024];         // The .C10 image
+static uint32_t image_size = 0;
+static uint32_t image_gap  = 0;         // Where the gap after the namefile block goes
+
+static uint32_t rnd = 12345;
+
+static uint8_t random_byte(void)
+{
+    rnd = rnd * 1103515245 + 12345;
+    return rnd >> 16;
+}
+
+// ------------------------------------------------------------------------
+// Add a block as a .C10 image has it - sync byte, type, length, payload
+// and checksum - followed by a byte of leader.
+// ------------------------------------------------------------------------
+static void add_block(uint8_t type, const uint8_t *data, int length)
+{
+    uint8_t checksum = type + length;
+
+    image[image_size++] = 0x3C;
+    image[image_size++] = type;
+    image[image_size++] = length;
+    for (int i=0; i<length; i++)
+    {
+        image[image_size++] = data[i];
+        checksum += data[i];
+    }
+    image[image_size++] = checksum;
+    image[image_size++] = 0x55;
+}
+
+static void make_image(void)
+{
+    uint8_t namefile[15] = {'W', 'A', 'V', 'E', 'T', 'E', 'S', 'T', TAPE_FILE_ML, 0x00, 0x00, 0x50, 0x00, 0x50, 0x00};
+    uint8_t data[255];
+
+    memset(image, 0x55, LEADER);
+    image_size = LEADER;
+    add_block(TAPE_BLOCK_NAMEFILE, namefile, sizeof(namefile));
+    image_gap = image_size;
+
+    memset(image + image_size, 0x55, LEADER);
+    image_size += LEADER;
+    for (int block=0; block < DATA_BLOCKS; block++)
+    {
+        for (int i=0; i < sizeof(data); i++) data[i] = random_byte();
+        add_block(TAPE_BLOCK_DATA, data, (block == DATA_BLOCKS-1) ? 100 : 255);
+    }
+    add_block(TAPE_BLOCK_EOF, NULL, 0);
+}
+
+// ------------------------------------------------------------------------
+// The recording. Each bit is one cycle of a sine - the fraction of a
+// sample left over carries on to the next cycle so the frequencies come
+// out right at any sample rate. Half a second of quiet goes at the start,
+// in the gap and at the end. A bit is timed from one rising edge to the
+// next so, as with a real recorder that runs on until the motor stops,
+// one more cycle goes before the quiet to end the last bit.
+// ------------------------------------------------------------------------
+typedef struct
+{
+    uint32_t    rate;
+    uint8_t     bits;
+    uint8_t     channels;
+    double      level;                  // Peak (1.0 is full scale)
+    double      offset;                 // DC offset
+} recording_t;
+
+static const recording_t recordings[] =
+{
+    {11025,  8, 1, 0.80,  0.00},
+    { 9600,  8, 2, 0.50, -0.10},
+    {22050, 16, 1, 0.60,  0.05},
+    {44100, 16, 2, 0.25,  0.00},
+};
+
+static FILE    *wav_fp;
+static uint32_t wav_samples;
+static double   wav_carry;
+
+static void put_sample(const recording_t *rec, double value)
+{
+    value = value * rec->level + rec->offset;
+
+    for (int channel=0; channel < rec->channels; channel++)
+    {
+        double v = channel ? rec->offset : value;       // The second channel is quiet
+        if (rec->bits == 8)
+        {
+            fputc((int)lrint(128 + v * 127), wav_fp);
+        }
+        else
+        {
+            int16_t s = (int16_t)lrint(v * 32767);
+            fputc(s & 0xFF, wav_fp);
+            fputc((s >> 8) & 0xFF, wav_fp);
+        }
+    }
+    wav_samples++;
+}
+
+static void put_quiet(const recording_t *rec, double seconds)
+{
+    for (int i=0; i < (int)(rec->rate * seconds); i++) put_sample(rec, 0.0);
+}
+
+static void put_bit(const recording_t *rec, uint8_t bit)
+{
+    wav_carry += (double)rec->rate / (bit ? 2400 : 1200);
+    int length = (int)wav_carry;
+    wav_carry -= length;
+
+    for (int i=0; i < length; i++) put_sample(rec, sin(2 * M_PI * i / length));
+}
+
+static void put_byte(const recording_t *rec, uint8_t byte)
+{
+    for (int bit=0; bit < 8; bit++) put_bit(rec, (byte >> bit) & 1);
+}
+
+static void put_u32(uint32_t value)
+{
+    for (int i=0; i<4; i++) fputc((value >> (i*8)) & 0xFF, wav_fp);
+}
+
+static void put_u16(uint16_t value)
+{
+    fputc(value & 0xFF, wav_fp);
+    fputc(value >> 8, wav_fp);
+}
+
+static void write_wav(const recording_t *rec)
+{
+    uint16_t align = rec->channels * rec->bits / 8;
+
+    wav_samples = 0;
+    wav_fp = fopen(WAV_FILE, "wb");
+    if (!wav_fp)
+    {
+        printf("Unable to create %s\n", WAV_FILE);
+        exit(1);
+    }
+
+    // The header is written again once the number of samples is known
+    for (int pass=0; pass < 2; pass++)
+    {
+        fseek(wav_fp, 0, SEEK_SET);
+        fwrite("RIFF", 1, 4, wav_fp);
+        put_u32(36 + wav_samples * align);
+        fwrite("WAVEfmt ", 1, 8, wav_fp);
+        put_u32(16);
+        put_u16(1);                             // PCM
+        put_u16(rec->channels);
+        put_u32(rec->rate);
+        put_u32(rec->rate * align);
+        put_u16(align);
+        put_u16(rec->bits);
+        fwrite("data", 1, 4, wav_fp);
+        put_u32(wav_samples * align);
+
+        if (pass) break;
+
+        wav_carry = 0.0;
+        put_quiet(rec, 0.5);
+        for (uint32_t i=0; i < image_size; i++)
+        {
+            if (i == image_gap)
+            {
+                put_bit(rec, 1);
+                put_quiet(rec, 0.5);
+            }
+            put_byte(rec, image[i]);
+        }
+        put_bit(rec, 1);
+        put_quiet(rec, 0.5);
+    }
+
+    fclose(wav_fp);
+}
+
+// ------------------------------------------------------------------------
+// Read the recording back every which way.
+// ------------------------------------------------------------------------
+static int check_wav(const recording_t *rec)
+{
+    int bad = 0;
+
+    if (!tape_open(WAV_FILE))
+    {
+        printf("  unable to open %s\n", WAV_FILE);
+        return 0;
+    }
+
+    // Straight through - a few bytes a frame as the tape plays
+    uint32_t first_bad = 0xFFFFFFFF;
+    for (uint32_t pos=0; pos < image_size; pos++)
+    {
+        tape_pos = pos;
+        if ((pos % 8) == 0) tape_prefetch();
+        if ((tape_byte_at(pos) != image[pos]) && (bad++ == 0)) first_bad = pos;
+    }
+    tape_pos = image_size;
+    tape_prefetch();
+    if (bad) printf("  straight through: %d bytes differ (the first at %u: %02X vs %02X)\n", bad, first_bad, tape_byte_at(first_bad), image[first_bad]);
+
+    if ((tape_byte_at(image_size) != 0xFF) || (file_size != image_size))
+    {
+        printf("  decoded %u bytes, the .C10 has %u\n", file_size, image_size);
+        bad++;
+    }
+
+    // Back to before the window - decoding starts again from a checkpoint
+    if (tape_window_start <= SEEK_BACK)
+    {
+        printf("  the window never moved past %u\n", SEEK_BACK);
+        bad++;
+    }
+    int seek_bad = 0;
+    for (uint32_t pos=SEEK_BACK; pos < SEEK_BACK + 2*TAPE_SECTOR; pos++)
+    {
+        if (tape_byte_at(pos) != image[pos]) seek_bad++;
+        if ((pos == SEEK_BACK) && (tape_window_start != (SEEK_BACK & ~(TAPE_SECTOR - 1))))
+        {
+            printf("  going back to %u decoded from %u - not the checkpoint before it\n", SEEK_BACK, tape_window_start);
+            bad++;
+        }
+    }
+    if (seek_bad) printf("  after going back: %d bytes differ\n", seek_bad);
+    bad += seek_bad;
+
+    // Anywhere at all
+    int random_bad = 0;
+    for (int i=0; i < RANDOM_READS; i++)
+    {
+        uint32_t pos = ((random_byte() << 8) | random_byte()) % image_size;
+        if (tape_byte_at(pos) != image[pos]) random_bad++;
+    }
+    if (random_bad) printf("  random reads: %d of %d differ\n", random_bad, RANDOM_READS);
+    bad += random_bad;
+
+    tape_close();
+
+    printf("  %5u Hz %2d-bit %s: %s\n", rec->rate, rec->bits, (rec->channels == 1) ? "mono  " : "stereo",
+           bad ? "FAILED" : "decodes as the .C10");
+
+    return !bad;
+}
+
+int main(int argc, char *argv[])
+{
+    int failures = 0;
+
+    make_image();
+    printf(".C10 image of %u bytes\n", image_size);
+
+    for (int i=0; i < sizeof(recordings) / sizeof(recordings[0]); i++)
+    {
+        write_wav(&recordings[i]);
+        if (!check_wav(&recordings[i])) failures++;
+    }
+
+    printf(failures ? "%d recordings failed\n" : "all recordings match\n", failures);
+
+    return failures ? 1 : 0;
+}
+
+// End of file